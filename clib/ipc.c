@@ -20,12 +20,28 @@
 #include "clib/widget.h"
 #include "common/ipc.h"
 #include "widgets/webview.h"
-#include "common/luauniq.h"
 
 #include "common/clib/ipc.h"
 #include "common/luaserialize.h"
 
-#define REG_KEY "luakit.registry.ipc_channel"
+/* Send a signal emission to a single endpoint. The channel and signal names
+ * are replaced with ids interned on that endpoint where possible */
+static void
+ipc_channel_send_to(lua_State *L, ipc_endpoint_t *ipc, const gchar *name, guint64 page_id)
+{
+    /* Stack: channel, signal name, arguments... */
+    gint top = lua_gettop(L);
+    luaL_checkstack(L, top + 2, "too many arguments");
+
+    ipc_channel_push_name(L, ipc, lua_tostring(L, 2));
+    for (gint i = 3; i <= top; i++)
+        lua_pushvalue(L, i);
+    ipc_channel_push_name(L, ipc, name);
+    lua_pushinteger(L, page_id);
+
+    ipc_send_lua(ipc, IPC_TYPE_lua_ipc, L, top + 1, lua_gettop(L));
+    lua_settop(L, top);
+}
 
 gint
 ipc_channel_send(lua_State *L)
@@ -43,35 +59,59 @@ ipc_channel_send(lua_State *L)
     }
 
     luaL_checkstring(L, 2);
-    lua_pushstring(L, ipc_channel->name);
-    lua_pushinteger(L, page_id);
 
     if (ipc)
-        ipc_send_lua(ipc, IPC_TYPE_lua_ipc, L, 2, lua_gettop(L));
+        ipc_channel_send_to(L, ipc, ipc_channel->name, page_id);
     else {
         const GPtrArray *endpoints = ipc_endpoints_get();
         for (unsigned i = 0; i < endpoints->len; i++) {
             ipc_endpoint_t *ipc = g_ptr_array_index(endpoints, i);
-            ipc_send_lua(ipc, IPC_TYPE_lua_ipc, L, 2, lua_gettop(L));
+            ipc_channel_send_to(L, ipc, ipc_channel->name, page_id);
         }
     }
 
     return 0;
 }
 
+gint
+ipc_channel_call(lua_State *L)
+{
+    luaH_check_ipc_channel(L, 1);
+    widget_t *w = luaH_checkwebview(L, 2);
+    guint64 page_id = webkit_web_view_get_page_id(WEBKIT_WEB_VIEW(w->widget));
+    ipc_endpoint_t *ipc = webview_get_endpoint(w);
+    lua_remove(L, 2);
+    return ipc_channel_call_to(L, ipc, page_id);
+}
+
+/* Push the view a call was made from, or nil */
 void
-ipc_channel_recv(lua_State *L, const gchar *arg, guint arglen)
+luaH_ipc_channel_push_page(lua_State *L, guint64 page_id)
+{
+    widget_t *w = page_id ? webview_get_by_id(page_id) : NULL;
+    if (w)
+        luaH_object_push(L, w->ref);
+    else
+        lua_pushnil(L);
+}
+
+void
+ipc_channel_recv(lua_State *L, ipc_endpoint_t *ipc, const gchar *arg, guint arglen)
 {
     gint top = lua_gettop(L);
     int n = lua_deserialize_range(L, (guint8*)arg, arglen);
 
-    const char *signame = lua_tostring(L, -n);
-    luaH_uniq_get(L, REG_KEY, -1);
-    lua_remove(L, -n-1);
-    lua_insert(L, -n);
-    lua_remove(L, -1);
-    if (!lua_isnil(L, -n+1))
-        luaH_object_emit_signal(L, -n+1, signame, n-2, 0);
+    /* Stack: signal name, arguments..., channel name */
+    const gchar *signame = ipc_channel_get_name(L, ipc, top + 1);
+    luaH_ipc_channel_push(L, ipc, -1);
+    lua_replace(L, -2);
+
+    /* Move the channel before the arguments, and emit signal; the signal
+     * name stays on the stack until the emission is done */
+    if (signame && !lua_isnil(L, -1)) {
+        lua_insert(L, top + 2);
+        luaH_object_emit_signal(L, top + 2, signame, n-2, 0);
+    }
     lua_settop(L, top);
 }
 
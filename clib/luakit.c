@@ -25,12 +25,14 @@
 #include "common/ipc.h"
 #include "common/signal.h"
 #include "luah.h"
+#include "memory.h"
 #include "web_context.h"
 #include "globalconf.h"
 
 #include <glib.h>
 #include <gtk/gtk.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/wait.h>
 #include <time.h>
 #include <webkit2/webkit2.h>
@@ -508,17 +510,35 @@ typedef struct _lua_js_registration_t {
     gchar *pattern;
     gchar *name;
     gpointer ref;
+    gboolean all_frames;
 } lua_js_registration_t;
 
 static GArray *registrations;
 
+static void
+register_function_on_endpoint(ipc_endpoint_t *ipc, lua_State *L, lua_js_registration_t *reg)
+{
+    lua_pushstring(L, reg->pattern);
+    lua_pushstring(L, reg->name);
+    lua_pushlightuserdata(L, reg->ref);
+    lua_pushboolean(L, reg->all_frames);
+
+    /* Incref */
+    luaH_object_push(L, reg->ref);
+    luaH_object_ref(L, -1);
+
+    ipc_send_lua(ipc, IPC_TYPE_lua_js_register, L, -4, -1);
+    lua_pop(L, 4);
+}
+
 static gint
 luaH_luakit_register_function(lua_State *L)
 {
     lua_js_registration_t reg = {
         .pattern = (gchar*)luaL_checkstring(L, 1),
         .name = (gchar*)luaL_checkstring(L, 2),
-        .ref = NULL
+        .ref = NULL,
+        .all_frames = FALSE,
     };
 
     if (strlen(reg.pattern) == 0)
@@ -526,6 +546,15 @@ luaH_luakit_register_function(lua_State *L)
     if (strlen(reg.name) == 0)
         return luaL_error(L, "function name cannot be empty");
 
+    /* registration options */
+    if (!lua_isnoneornil(L, 4)) {
+        luaH_checktable(L, 4);
+        if (luaH_rawfield(L, 4, "all_frames")) {
+            reg.all_frames = lua_toboolean(L, -1);
+            lua_pop(L, 1);
+        }
+    }
+
     /* get lua callback function */
     luaH_checkfunction(L, 3);
     reg.ref = luaH_object_ref(L, 3);
@@ -537,27 +566,116 @@ luaH_luakit_register_function(lua_State *L)
     reg.name = g_strdup(reg.name);
     g_array_append_val(registrations, reg);
 
+    /* Web processes that are already running get the function now; later
+     * ones get it when they connect */
+    const GPtrArray *endpoints = ipc_endpoints_get();
+    for (guint i = 0; endpoints && i < endpoints->len; i++) {
+        ipc_endpoint_t *ipc = g_ptr_array_index(endpoints, i);
+        if (ipc->status == IPC_ENDPOINT_CONNECTED)
+            register_function_on_endpoint(ipc, L, &reg);
+    }
+
     return 0;
 }
 
 /** Defined in widgets/webview.c */
-void luakit_uri_scheme_request_cb(WebKitURISchemeRequest *, gpointer);
+void luakit_uri_scheme_request_cb(WebKitURISchemeRequest *, luakit_scheme_t *);
+
+/** Registered URI schemes, by name */
+static GHashTable *schemes;
+
+static void
+scheme_asset_free(luakit_scheme_asset_t *asset)
+{
+    g_bytes_unref(asset->data);
+    g_free(asset->mime);
+    g_slice_free(luakit_scheme_asset_t, asset);
+}
+
+static luakit_scheme_t *
+luaH_checkscheme(lua_State *L, gint idx)
+{
+    const gchar *name = luaL_checkstring(L, idx);
+    luakit_scheme_t *scheme = schemes ? g_hash_table_lookup(schemes, name) : NULL;
+    if (!scheme)
+        luaL_error(L, "scheme '%s' is not registered", name);
+    return scheme;
+}
 
 static gint
 luaH_luakit_register_scheme(lua_State *L)
 {
-    const gchar *scheme = luaL_checkstring(L, 1);
+    const gchar *name = luaL_checkstring(L, 1);
 
-    if (g_str_equal(scheme, ""))
+    if (g_str_equal(name, ""))
         return luaL_error(L, "scheme cannot be empty");
-    if (g_str_equal(scheme, "http") || g_str_equal(scheme, "https"))
+    if (g_str_equal(name, "http") || g_str_equal(name, "https"))
         return luaL_error(L, "scheme cannot be 'http' or 'https'");
-    if (!g_regex_match_simple("^[a-z][a-z0-9\\+\\-\\.]*$", scheme, 0, 0))
+    if (!g_regex_match_simple("^[a-z][a-z0-9\\+\\-\\.]*$", name, 0, 0))
         return luaL_error(L, "scheme must match [a-z][a-z0-9\\+\\-\\.]*");
+    if (!lua_isnoneornil(L, 2))
+        luaH_checkfunction(L, 2);
+
+    if (!schemes)
+        schemes = g_hash_table_new(g_str_hash, g_str_equal);
+
+    luakit_scheme_t *scheme = g_hash_table_lookup(schemes, name);
+    if (!scheme) {
+        scheme = g_slice_new0(luakit_scheme_t);
+        scheme->name = g_strdup(name);
+        scheme->pages = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+        scheme->assets = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+                (GDestroyNotify)scheme_asset_free);
+        g_hash_table_insert(schemes, scheme->name, scheme);
+        webkit_web_context_register_uri_scheme(web_context_get(), name,
+                (WebKitURISchemeRequestCallback) luakit_uri_scheme_request_cb,
+                scheme, NULL);
+    }
+
+    /* Set default page handler */
+    if (scheme->default_ref)
+        luaH_object_unref(L, scheme->default_ref);
+    scheme->default_ref = lua_isfunction(L, 2) ? luaH_object_ref(L, 2) : NULL;
+    return 0;
+}
 
-    webkit_web_context_register_uri_scheme(web_context_get(), scheme,
-            (WebKitURISchemeRequestCallback) luakit_uri_scheme_request_cb,
-            g_strdup(scheme), g_free);
+static gint
+luaH_luakit_register_scheme_page(lua_State *L)
+{
+    luakit_scheme_t *scheme = luaH_checkscheme(L, 1);
+    const gchar *page = luaL_checkstring(L, 2);
+    if (!lua_isnoneornil(L, 3))
+        luaH_checkfunction(L, 3);
+
+    gpointer ref = g_hash_table_lookup(scheme->pages, page);
+    if (ref) {
+        luaH_object_unref(L, ref);
+        g_hash_table_remove(scheme->pages, page);
+    }
+    if (lua_isfunction(L, 3))
+        g_hash_table_insert(scheme->pages, g_strdup(page), luaH_object_ref(L, 3));
+    return 0;
+}
+
+static gint
+luaH_luakit_register_scheme_asset(lua_State *L)
+{
+    luakit_scheme_t *scheme = luaH_checkscheme(L, 1);
+    const gchar *path = luaL_checkstring(L, 2);
+    if (!strchr(path, '/'))
+        return luaL_error(L, "asset path must have the form 'page/path'");
+
+    if (lua_isnoneornil(L, 3)) {
+        g_hash_table_remove(scheme->assets, path);
+        return 0;
+    }
+
+    size_t length;
+    const gchar *data = luaL_checklstring(L, 3, &length);
+    luakit_scheme_asset_t *asset = g_slice_new(luakit_scheme_asset_t);
+    asset->data = g_bytes_new(data, length);
+    asset->mime = g_strdup(luaL_optstring(L, 4, "text/html"));
+    g_hash_table_insert(scheme->assets, g_strdup(path), asset);
     return 0;
 }
 
@@ -567,19 +685,9 @@ luaH_register_functions_on_endpoint(ipc_endpoint_t *ipc, lua_State *L)
     if (!registrations)
         return;
 
-    for (guint i = 0; i < registrations->len; ++i) {
-        lua_js_registration_t reg = g_array_index(registrations, lua_js_registration_t, i);
-        lua_pushstring(L, reg.pattern);
-        lua_pushstring(L, reg.name);
-        lua_pushlightuserdata(L, reg.ref);
-
-        /* Incref */
-        luaH_object_push(L, reg.ref);
-        luaH_object_ref(L, -1);
-
-        ipc_send_lua(ipc, IPC_TYPE_lua_js_register, L, -3, -1);
-        lua_pop(L, 3);
-    }
+    for (guint i = 0; i < registrations->len; ++i)
+        register_function_on_endpoint(ipc, L,
+                &g_array_index(registrations, lua_js_registration_t, i));
 }
 
 gint
@@ -596,6 +704,171 @@ luaH_class_newindex_miss_property(lua_State *L, lua_object_t* UNUSED(obj))
     return 0;
 }
 
+/** A file or directory watched with luakit.watch_file() */
+typedef struct {
+    guint id;
+    GFileMonitor *monitor;
+    gpointer ref;
+} file_watch_t;
+
+/** Active file watches, by id */
+static GHashTable *file_watches;
+
+static const gchar *
+file_monitor_event_name(GFileMonitorEvent event)
+{
+    switch (event) {
+      case G_FILE_MONITOR_EVENT_CHANGED:           return "changed";
+      case G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT: return "changes-done";
+      case G_FILE_MONITOR_EVENT_DELETED:           return "deleted";
+      case G_FILE_MONITOR_EVENT_CREATED:           return "created";
+      case G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED: return "attribute-changed";
+      default:                                     return NULL;
+    }
+}
+
+static void
+file_watch_changed_cb(GFileMonitor *UNUSED(monitor), GFile *file, GFile *other,
+        GFileMonitorEvent event, file_watch_t *watch)
+{
+    const gchar *name = file_monitor_event_name(event);
+    if (!name)
+        return;
+
+    lua_State *L = globalconf.L;
+    gchar *path = g_file_get_path(file);
+    gchar *other_path = other ? g_file_get_path(other) : NULL;
+    lua_pushstring(L, name);
+    lua_pushstring(L, path);
+    lua_pushstring(L, other_path);
+    g_free(path);
+    g_free(other_path);
+
+    /* The callback may remove the watch */
+    luaH_object_push(L, watch->ref);
+    luaH_dofunction(L, 3, 0);
+}
+
+static void
+file_watch_free(file_watch_t *watch)
+{
+    g_signal_handlers_disconnect_by_func(watch->monitor,
+            G_CALLBACK(file_watch_changed_cb), watch);
+    g_file_monitor_cancel(watch->monitor);
+    g_object_unref(watch->monitor);
+    luaH_object_unref(globalconf.L, watch->ref);
+    g_slice_free(file_watch_t, watch);
+}
+
+/** Watch a file or directory for changes.
+ * \param L The Lua VM state.
+ * \return The number of elements pushed on stack.
+ *
+ * \luastack
+ * \lparam path The path of the file or directory to watch.
+ * \lparam callback The function to call with the event name, the path of
+ * the changed file, and the path of the other file for move events.
+ * \lreturn The id of the watch.
+ */
+static gint
+luaH_luakit_watch_file(lua_State *L)
+{
+    static guint next_id;
+    const gchar *path = luaL_checkstring(L, 1);
+    luaH_checkfunction(L, 2);
+
+    GError *err = NULL;
+    GFile *file = g_file_new_for_path(path);
+    GFileMonitor *monitor = g_file_monitor(file, G_FILE_MONITOR_NONE, NULL, &err);
+    g_object_unref(file);
+    if (!monitor) {
+        lua_pushfstring(L, "unable to watch '%s': %s", path, err->message);
+        g_error_free(err);
+        return lua_error(L);
+    }
+
+    if (!file_watches)
+        file_watches = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                NULL, (GDestroyNotify)file_watch_free);
+
+    file_watch_t *watch = g_slice_new0(file_watch_t);
+    watch->id = ++next_id;
+    watch->monitor = monitor;
+    watch->ref = luaH_object_ref(L, 2);
+    g_signal_connect(monitor, "changed", G_CALLBACK(file_watch_changed_cb), watch);
+    g_hash_table_insert(file_watches, GUINT_TO_POINTER(watch->id), watch);
+
+    lua_pushinteger(L, watch->id);
+    return 1;
+}
+
+/** Stop watching a file or directory.
+ * \param L The Lua VM state.
+ * \return The number of elements pushed on stack.
+ *
+ * \luastack
+ * \lparam id The id returned by luakit.watch_file().
+ * \lreturn Whether the watch was found and removed.
+ */
+static gint
+luaH_luakit_unwatch_file(lua_State *L)
+{
+    guint id = luaL_checkinteger(L, 1);
+    lua_pushboolean(L, file_watches &&
+            g_hash_table_remove(file_watches, GUINT_TO_POINTER(id)));
+    return 1;
+}
+
+/** Application-wide theme stylesheet */
+static GtkCssProvider *theme_provider;
+static gchar *theme_css;
+
+/** Replace the application-wide theme stylesheet.
+ * All widgets are restyled at once; nothing is done if the stylesheet is
+ * unchanged.
+ * \param L The Lua VM state.
+ * \return The number of elements pushed on stack.
+ *
+ * \luastack
+ * \lparam css The CSS stylesheet.
+ * \lreturn Whether the stylesheet was changed.
+ */
+static gint
+luaH_luakit_set_theme_css(lua_State *L)
+{
+    const gchar *css = luaL_checkstring(L, 1);
+
+    if (!g_strcmp0(css, theme_css)) {
+        lua_pushboolean(L, FALSE);
+        return 1;
+    }
+
+    GError *err = NULL;
+    GtkCssProvider *provider = theme_provider ? theme_provider : gtk_css_provider_new();
+    if (!gtk_css_provider_load_from_data(provider, css, -1, &err)) {
+        /* Keep the previous stylesheet */
+        if (theme_provider)
+            gtk_css_provider_load_from_data(provider, theme_css, -1, NULL);
+        else
+            g_object_unref(provider);
+        lua_pushstring(L, err->message);
+        g_error_free(err);
+        return lua_error(L);
+    }
+
+    if (!theme_provider) {
+        theme_provider = provider;
+        gtk_style_context_add_provider_for_screen(gdk_screen_get_default(),
+                GTK_STYLE_PROVIDER(theme_provider),
+                GTK_STYLE_PROVIDER_PRIORITY_APPLICATION);
+    }
+
+    g_free(theme_css);
+    theme_css = g_strdup(css);
+    lua_pushboolean(L, TRUE);
+    return 1;
+}
+
 /** Setup luakit module.
  *
  * \param L The Lua VM state.
@@ -610,12 +883,18 @@ luakit_lib_setup(lua_State *L)
         { "__index",           luaH_luakit_index },
         { "__newindex",        luaH_luakit_newindex },
         { "exec",              luaH_luakit_exec },
+        { "memory_stats",      luaH_luakit_memory_stats },
         { "quit",              luaH_luakit_quit },
         { "save_file",         luaH_luakit_save_file },
+        { "set_theme_css",     luaH_luakit_set_theme_css },
         { "spawn",             luaH_luakit_spawn },
         { "spawn_sync",        luaH_luakit_spawn_sync },
+        { "unwatch_file",      luaH_luakit_unwatch_file },
+        { "watch_file",        luaH_luakit_watch_file },
         { "register_function", luaH_luakit_register_function },
         { "register_scheme",   luaH_luakit_register_scheme },
+        { "register_scheme_page",  luaH_luakit_register_scheme_page },
+        { "register_scheme_asset", luaH_luakit_register_scheme_asset },
         { NULL,              NULL }
     };
 
@@ -25,6 +25,24 @@
 #include "common/ipc.h"
 
 #include <lua.h>
+#include <glib.h>
+
+/** A URI scheme registered with luakit.register_scheme() */
+typedef struct _luakit_scheme_t {
+    gchar *name;
+    /** Handler functions, by page name */
+    GHashTable *pages;
+    /** Handler function for pages without their own handler, or NULL */
+    gpointer default_ref;
+    /** Static assets (luakit_scheme_asset_t), by "page/path" */
+    GHashTable *assets;
+} luakit_scheme_t;
+
+/** A static asset served from memory */
+typedef struct _luakit_scheme_asset_t {
+    GBytes *data;
+    gchar *mime;
+} luakit_scheme_asset_t;
 
 void luakit_lib_setup(lua_State *L);
 void luaH_register_functions_on_endpoint(ipc_endpoint_t *ipc, lua_State *L);
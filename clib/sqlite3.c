@@ -48,6 +48,9 @@ typedef struct {
 
 static lua_class_t sqlite3_class, sqlite3_stmt_class;
 
+/** All open database handles; used for memory statistics */
+static GPtrArray *sqlite3_handles;
+
 LUA_OBJECT_FUNCS(sqlite3_class, sqlite3_t, sqlite3)
 
 static inline void
@@ -135,6 +138,7 @@ luaH_sqlite3_close(lua_State *L)
     }
 
     if (sqlite->db) {
+        g_ptr_array_remove_fast(sqlite3_handles, sqlite);
         sqlite3_close(sqlite->db);
         sqlite->db = NULL;
     }
@@ -159,10 +163,12 @@ luaH_sqlite3_set_filename(lua_State *L, sqlite3_t *sqlite)
         lua_pushfstring(L, "sqlite3: failed to open \"%s\" (%s)",
                 filename, sqlite3_errmsg(sqlite->db));
         sqlite3_close(sqlite->db);
+        sqlite->db = NULL;
         lua_error(L);
     }
 
     sqlite->filename = g_strdup(filename);
+    g_ptr_array_add(sqlite3_handles, sqlite);
     return 0;
 }
 
@@ -423,9 +429,44 @@ luaH_sqlite3_new(lua_State *L)
     return 1;
 }
 
+static gint
+sqlite3_db_status_kb(sqlite3 *db, gint op)
+{
+    gint cur = 0, hiwtr = 0;
+    sqlite3_db_status(db, op, &cur, &hiwtr, 0);
+    return cur / 1024;
+}
+
+/* Push memory usage of SQLite and of each open database handle */
+void
+sqlite3_push_memory_stats(lua_State *L)
+{
+    lua_createtable(L, 0, 2);
+    lua_pushinteger(L, sqlite3_memory_used() / 1024);
+    lua_setfield(L, -2, "memory_used_kb");
+
+    lua_createtable(L, sqlite3_handles->len, 0);
+    for (guint i = 0; i < sqlite3_handles->len; i++) {
+        sqlite3_t *sqlite = sqlite3_handles->pdata[i];
+        lua_createtable(L, 0, 4);
+        lua_pushstring(L, sqlite->filename);
+        lua_setfield(L, -2, "filename");
+        lua_pushinteger(L, sqlite3_db_status_kb(sqlite->db, SQLITE_DBSTATUS_CACHE_USED));
+        lua_setfield(L, -2, "cache_kb");
+        lua_pushinteger(L, sqlite3_db_status_kb(sqlite->db, SQLITE_DBSTATUS_SCHEMA_USED));
+        lua_setfield(L, -2, "schema_kb");
+        lua_pushinteger(L, sqlite3_db_status_kb(sqlite->db, SQLITE_DBSTATUS_STMT_USED));
+        lua_setfield(L, -2, "stmt_kb");
+        lua_rawseti(L, -2, i + 1);
+    }
+    lua_setfield(L, -2, "handles");
+}
+
 void
 sqlite3_class_setup(lua_State *L)
 {
+    sqlite3_handles = g_ptr_array_new();
+
     static const struct luaL_reg sqlite3_methods[] =
     {
         LUA_CLASS_METHODS(sqlite3)
@@ -24,6 +24,7 @@
 #include <lua.h>
 
 void sqlite3_class_setup(lua_State*);
+void sqlite3_push_memory_stats(lua_State*);
 
 #endif
 
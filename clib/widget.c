@@ -63,6 +63,14 @@ luaH_widget_gc(lua_State *L)
     if (w->info)
         debug("collecting widget at %p of type '%s'", w, w->info->name);
     g_assert(!w->destructor);
+#if GTK_CHECK_VERSION(3,16,0)
+    if (w->provider)
+        g_object_unref(w->provider);
+    if (w->css_rules)
+        g_ptr_array_unref(w->css_rules);
+    if (w->css_props)
+        g_hash_table_destroy(w->css_props);
+#endif
     return luaH_object_gc(L);
 }
 
@@ -92,41 +100,107 @@ luaH_widget_new(lua_State *L)
 }
 
 #if GTK_CHECK_VERSION(3,16,0)
-static inline void
+/* Reload the widget's CSS provider from its stored CSS rules and properties.
+ * Properties set by widget setters are kept in a separate, final block, so
+ * they take precedence over rules added with the css property. */
+static void
+widget_update_css(widget_t *w)
+{
+    GString *css = g_string_new(NULL);
+    if (w->css_rules) {
+        for (guint i = 0; i < w->css_rules->len; i++)
+            g_string_append_printf(css, "#widget { %s }\n",
+                    (gchar*)g_ptr_array_index(w->css_rules, i));
+    }
+    if (w->css_props) {
+        g_string_append(css, "#widget {");
+        GHashTableIter iter;
+        gpointer prop, value;
+        g_hash_table_iter_init(&iter, w->css_props);
+        while (g_hash_table_iter_next(&iter, &prop, &value))
+            g_string_append_printf(css, " %s: %s;", (gchar*)prop, (gchar*)value);
+        g_string_append(css, " }");
+    }
+    gtk_css_provider_load_from_data(w->provider, css->str, css->len, NULL);
+    g_string_free(css, TRUE);
+}
+
+/* Add a rule with the css property. Rules add up, with later rules taking
+ * precedence; setting the same rule again as the last one does nothing. */
+static void
 widget_set_css(widget_t *w, const gchar *properties)
 {
-    gchar *old_css = gtk_css_provider_to_string(w->provider);
-    gchar *css = g_strdup_printf("%s\n#widget { %s }", old_css, properties);
-    gtk_css_provider_load_from_data(w->provider, css, strlen(css), NULL);
-    g_free(css);
-    g_free(old_css);
+    if (!w->css_rules)
+        w->css_rules = g_ptr_array_new_with_free_func(g_free);
+    else if (w->css_rules->len > 0 && g_str_equal(properties,
+                g_ptr_array_index(w->css_rules, w->css_rules->len - 1)))
+        return;
+    g_ptr_array_add(w->css_rules, g_strdup(properties));
+    widget_update_css(w);
 }
 
+/* Set CSS properties on a widget. The provider is only reloaded, and the
+ * widget's style only invalidated, if any property value changed. */
 void
 widget_set_css_properties(widget_t *w, ...)
 {
     va_list argp;
     va_start(argp, w);
 
-    gchar *css = g_strdup("");
+    if (!w->css_props)
+        w->css_props = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+
+    gboolean changed = FALSE;
     const gchar *prop;
     while ((prop = va_arg(argp, gchar *))) {
         const gchar *value = va_arg(argp, gchar *);
         g_assert(strlen(prop) > 0);
         if (!value || strlen(value) == 0)
             continue;
+        if (!g_strcmp0(g_hash_table_lookup(w->css_props, prop), value))
+            continue;
 
-        gchar *tmp = css;
-        css = g_strdup_printf("%s%s: %s;", css, prop, value);
-        g_free(tmp);
-
+        g_hash_table_insert(w->css_props, g_strdup(prop), g_strdup(value));
+        changed = TRUE;
     }
     va_end(argp);
-    widget_set_css(w, css);
-    g_free(css);
+    if (changed)
+        widget_update_css(w);
 }
 #endif
 
+static gint
+luaH_widget_add_class(lua_State *L)
+{
+    widget_t *w = luaH_checkwidget(L, 1);
+    const gchar *name = luaL_checkstring(L, 2);
+    GtkStyleContext *context = gtk_widget_get_style_context(GTK_WIDGET(w->widget));
+    if (!gtk_style_context_has_class(context, name))
+        gtk_style_context_add_class(context, name);
+    return 0;
+}
+
+static gint
+luaH_widget_remove_class(lua_State *L)
+{
+    widget_t *w = luaH_checkwidget(L, 1);
+    const gchar *name = luaL_checkstring(L, 2);
+    GtkStyleContext *context = gtk_widget_get_style_context(GTK_WIDGET(w->widget));
+    if (gtk_style_context_has_class(context, name))
+        gtk_style_context_remove_class(context, name);
+    return 0;
+}
+
+static gint
+luaH_widget_has_class(lua_State *L)
+{
+    widget_t *w = luaH_checkwidget(L, 1);
+    const gchar *name = luaL_checkstring(L, 2);
+    GtkStyleContext *context = gtk_widget_get_style_context(GTK_WIDGET(w->widget));
+    lua_pushboolean(L, gtk_style_context_has_class(context, name));
+    return 1;
+}
+
 /** Generic widget.
  * \param L The Lua VM state.
  * \return The number of elements pushed on stack.
@@ -155,6 +229,20 @@ luaH_widget_index(lua_State *L)
         return ret;
     }
 
+    switch (token) {
+      case L_TK_ADD_CLASS:
+        lua_pushcfunction(L, luaH_widget_add_class);
+        return 1;
+      case L_TK_REMOVE_CLASS:
+        lua_pushcfunction(L, luaH_widget_remove_class);
+        return 1;
+      case L_TK_HAS_CLASS:
+        lua_pushcfunction(L, luaH_widget_has_class);
+        return 1;
+      default:
+        break;
+    }
+
     return widget->index ? widget->index(L, widget, token) : 0;
 }
 
@@ -80,6 +80,10 @@ struct widget_t
 #if GTK_CHECK_VERSION(3,16,0)
     /* CSS provider for this widget */
     GtkCssProvider *provider;
+    /* Rules added with the css property, in order */
+    GPtrArray *css_rules;
+    /* CSS properties set by widget setters */
+    GHashTable *css_props;
 #endif
     /* Previous width and height, for resize signal */
     gint prev_width, prev_height;
@@ -0,0 +1,342 @@
+/*
+ * common/clib/gc.c - idle-time Lua garbage collection scheduling
+ *
+ * Copyright © 2017 Aidan Holm <aidanholm@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* Lua's incremental collector does its work in proportion to allocation,
+ * so without scheduling most of it lands in input and signal handlers.
+ * The scheduler moves it to idle time instead:
+ *
+ *  - While input events keep arriving (a "burst"), the collector is stopped
+ *    if collection work is due: an idle cycle is unfinished, or the heap has
+ *    grown past the idle threshold. Raising the pause wouldn't do: Lua only
+ *    recomputes the GC threshold from the pause at the end of a cycle. The
+ *    collector is restarted when the burst ends, or once it has been stopped
+ *    for max_stop_ms, so that the heap can't grow without bound; the cycle
+ *    that restarting it starts is run to completion in idle time. The
+ *    collector is left alone while Lua code has stopped it.
+ *  - When the main loop is idle, bounded GC steps are run until the current
+ *    cycle is complete. A cycle is started from idle time once the heap has
+ *    grown enough since the last one, so that the collector rarely needs
+ *    to start one by itself.
+ *  - The heap size is checked periodically, but only while it keeps
+ *    changing; the check is restarted by input events and IPC messages. */
+
+#include "common/clib/gc.h"
+#include "common/luah.h"
+
+#include <glib.h>
+#include <string.h>
+
+static struct {
+    /* Time after the last input event at which a burst ends */
+    gint burst_ms;
+    /* Longest time the collector is stopped for during a burst */
+    gint max_stop_ms;
+    /* Size of each idle GC step, in kilobytes */
+    gint step_kb;
+    /* GC time per idle frame */
+    gint budget_ms;
+    /* Interval between checks whether idle collection is needed */
+    gint interval_ms;
+    /* Heap growth since the last cycle that starts an idle cycle, in percent */
+    gint threshold;
+} gc_options = {
+    .burst_ms = 250,
+    .max_stop_ms = 1000,
+    .step_kb = 64,
+    .budget_ms = 2,
+    .interval_ms = 500,
+    .threshold = 20,
+};
+
+static struct {
+    lua_State *L;
+    gboolean in_burst;
+    gint64 last_input;
+    /* Whether the scheduler has stopped the collector, and when */
+    gboolean stopped;
+    gint64 stop_time;
+    /* Whether the collector was restarted during the current burst */
+    gboolean stop_expired;
+    /* Whether Lua code has stopped the collector */
+    gboolean user_stopped;
+    /* Whether an idle cycle has been started but not completed */
+    gboolean in_cycle;
+    /* Heap size after the last completed idle cycle, in kilobytes */
+    gint last_cycle_kb;
+    /* Heap size at the last periodic check, in kilobytes */
+    gint last_check_kb;
+    guint burst_id, idle_id, check_id;
+
+    /* Statistics; only collection done in idle frames is timed */
+    guint frames, steps, cycles, bursts;
+    gint64 total_us, last_frame_us, max_frame_us;
+} gc;
+
+static gboolean
+gc_idle_step(gpointer UNUSED(data))
+{
+    if (gc.in_burst || gc.user_stopped) {
+        /* Restarted when the burst ends */
+        gc.idle_id = 0;
+        return FALSE;
+    }
+
+    gint64 start = g_get_monotonic_time(), now;
+    gint64 end = start + gc_options.budget_ms * 1000;
+    gboolean done;
+
+    gc.in_cycle = TRUE;
+    do {
+        done = lua_gc(gc.L, LUA_GCSTEP, gc_options.step_kb);
+        gc.steps++;
+        now = g_get_monotonic_time();
+    } while (!done && now < end);
+
+    gc.frames++;
+    gc.last_frame_us = now - start;
+    gc.total_us += gc.last_frame_us;
+    gc.max_frame_us = MAX(gc.max_frame_us, gc.last_frame_us);
+
+    if (!done)
+        return TRUE;
+
+    gc.cycles++;
+    gc.in_cycle = FALSE;
+    gc.last_cycle_kb = lua_gc(gc.L, LUA_GCCOUNT, 0);
+    gc.idle_id = 0;
+    return FALSE;
+}
+
+/* Whether a cycle is unfinished or the heap has grown enough to start one */
+static gboolean
+gc_work_due(void)
+{
+    if (gc.in_cycle)
+        return TRUE;
+    gint kb = lua_gc(gc.L, LUA_GCCOUNT, 0);
+    return kb * 100 >= gc.last_cycle_kb * (100 + gc_options.threshold);
+}
+
+/* Start idle collection if there is work to do */
+static void
+gc_idle_arm(void)
+{
+    if (gc.idle_id || gc.in_burst || gc.user_stopped || !gc_work_due())
+        return;
+    gc.idle_id = g_idle_add_full(G_PRIORITY_LOW, gc_idle_step, NULL, NULL);
+}
+
+/* Restart the collector, if the scheduler stopped it. This starts a new
+ * cycle if none was in progress; its work is done in idle time */
+static void
+gc_restart(void)
+{
+    if (!gc.stopped)
+        return;
+    gc.stopped = FALSE;
+    if (gc.user_stopped)
+        return;
+    lua_gc(gc.L, LUA_GCRESTART, 0);
+    gc.in_cycle = TRUE;
+}
+
+static gboolean
+gc_check(gpointer UNUSED(data))
+{
+    gc_idle_arm();
+
+    /* Stop checking while nothing is being allocated */
+    gint kb = lua_gc(gc.L, LUA_GCCOUNT, 0);
+    if (kb == gc.last_check_kb && !gc.idle_id) {
+        gc.check_id = 0;
+        return FALSE;
+    }
+    gc.last_check_kb = kb;
+    return TRUE;
+}
+
+/* Restart the periodic check, if it was stopped */
+void
+gc_scheduler_wake(void)
+{
+    if (!gc.L || gc.check_id)
+        return;
+    gc.last_check_kb = lua_gc(gc.L, LUA_GCCOUNT, 0);
+    gc.check_id = g_timeout_add(gc_options.interval_ms, gc_check, NULL);
+}
+
+static gboolean
+gc_burst_check(gpointer UNUSED(data))
+{
+    gint64 idle = g_get_monotonic_time() - gc.last_input;
+    if (idle < gc_options.burst_ms * 1000)
+        return TRUE;
+
+    gc.in_burst = FALSE;
+    gc.burst_id = 0;
+    gc.stop_expired = FALSE;
+    gc_restart();
+    gc_idle_arm();
+    return FALSE;
+}
+
+/* Called for every user input event */
+void
+gc_scheduler_input(void)
+{
+    if (!gc.L)
+        return;
+    gint64 now = g_get_monotonic_time();
+    gc.last_input = now;
+    gc_scheduler_wake();
+    if (!gc.in_burst) {
+        gc.in_burst = TRUE;
+        gc.bursts++;
+        gc.burst_id = g_timeout_add(gc_options.burst_ms, gc_burst_check, NULL);
+    }
+
+    if (gc.stopped) {
+        /* Don't let the heap grow for the whole of a long burst */
+        if (now - gc.stop_time >= gc_options.max_stop_ms * 1000) {
+            gc_restart();
+            gc.stop_expired = TRUE;
+        }
+    } else if (!gc.user_stopped && !gc.stop_expired && gc_work_due()) {
+        lua_gc(gc.L, LUA_GCSTOP, 0);
+        gc.stopped = TRUE;
+        gc.stop_time = now;
+    }
+}
+
+/* Wrapper around collectgarbage(), which notes whether Lua code has stopped
+ * the collector, so that the scheduler doesn't restart it */
+static gint
+luaH_collectgarbage(lua_State *L)
+{
+    const gchar *opt = luaL_optstring(L, 1, "collect");
+    if (!strcmp(opt, "stop"))
+        gc.user_stopped = TRUE;
+    else if (!strcmp(opt, "restart")) {
+        gc.user_stopped = FALSE;
+        gc.stopped = FALSE;
+    }
+
+    lua_pushvalue(L, lua_upvalueindex(1));
+    lua_insert(L, 1);
+    lua_call(L, lua_gettop(L) - 1, LUA_MULTRET);
+    return lua_gettop(L);
+}
+
+void
+gc_scheduler_setup(lua_State *L)
+{
+    gc.L = L;
+    gc.last_cycle_kb = lua_gc(L, LUA_GCCOUNT, 0);
+    gc_scheduler_wake();
+
+    lua_getglobal(L, "collectgarbage");
+    lua_pushcclosure(L, luaH_collectgarbage, 1);
+    lua_setglobal(L, "collectgarbage");
+}
+
+static void
+gc_option_field(lua_State *L, const gchar *name, gint *value, gint min)
+{
+    if (!luaH_rawfield(L, 1, name))
+        return;
+    gint v = luaL_checkint(L, -1);
+    if (v < min)
+        luaL_error(L, "gc option '%s' must be at least %d", name, min);
+    *value = v;
+    lua_pop(L, 1);
+}
+
+/** Get or set the GC scheduler options.
+ *
+ * \param L The Lua VM state.
+ * \return  The number of elements pushed on the stack (1).
+ *
+ * \luastack
+ * \lparam options Optional table of options to change.
+ * \lreturn        A table of all current options.
+ */
+gint
+luaH_luakit_gc_options(lua_State *L)
+{
+    if (!lua_isnoneornil(L, 1)) {
+        luaH_checktable(L, 1);
+        gint interval_ms = gc_options.interval_ms;
+        gc_option_field(L, "burst_ms", &gc_options.burst_ms, 1);
+        gc_option_field(L, "max_stop_ms", &gc_options.max_stop_ms, 1);
+        gc_option_field(L, "step_kb", &gc_options.step_kb, 1);
+        gc_option_field(L, "budget_ms", &gc_options.budget_ms, 1);
+        gc_option_field(L, "interval_ms", &gc_options.interval_ms, 1);
+        gc_option_field(L, "threshold", &gc_options.threshold, 0);
+
+        if (gc.check_id && interval_ms != gc_options.interval_ms) {
+            g_source_remove(gc.check_id);
+            gc.check_id = g_timeout_add(gc_options.interval_ms, gc_check, NULL);
+        }
+    }
+
+    lua_createtable(L, 0, 6);
+#define OPTION(name) \
+    lua_pushinteger(L, gc_options.name); \
+    lua_setfield(L, -2, #name);
+    OPTION(burst_ms)
+    OPTION(max_stop_ms)
+    OPTION(step_kb)
+    OPTION(budget_ms)
+    OPTION(interval_ms)
+    OPTION(threshold)
+#undef OPTION
+    return 1;
+}
+
+/** Get statistics about idle garbage collection.
+ *
+ * \param L The Lua VM state.
+ * \return  The number of elements pushed on the stack (1).
+ */
+gint
+luaH_luakit_gc_stats(lua_State *L)
+{
+    lua_createtable(L, 0, 10);
+#define STAT(name, value) \
+    lua_pushnumber(L, value); \
+    lua_setfield(L, -2, name);
+    STAT("frames", gc.frames)
+    STAT("steps", gc.steps)
+    STAT("cycles", gc.cycles)
+    STAT("bursts", gc.bursts)
+    STAT("total_ms", gc.total_us / 1000.0)
+    STAT("last_frame_ms", gc.last_frame_us / 1000.0)
+    STAT("max_frame_ms", gc.max_frame_us / 1000.0)
+    STAT("avg_frame_ms", gc.frames ? gc.total_us / 1000.0 / gc.frames : 0)
+    STAT("heap_kb", lua_gc(L, LUA_GCCOUNT, 0))
+#undef STAT
+    lua_pushboolean(L, gc.in_burst);
+    lua_setfield(L, -2, "in_burst");
+    lua_pushboolean(L, gc.stopped);
+    lua_setfield(L, -2, "stopped");
+    return 1;
+}
+
+// vim: ft=c:et:sw=4:ts=8:sts=4:tw=80
@@ -0,0 +1,35 @@
+/*
+ * common/clib/gc.h - idle-time Lua garbage collection scheduling
+ *
+ * Copyright © 2017 Aidan Holm <aidanholm@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef LUAKIT_COMMON_CLIB_GC_H
+#define LUAKIT_COMMON_CLIB_GC_H
+
+#include <lua.h>
+#include <glib.h>
+
+void gc_scheduler_setup(lua_State *L);
+void gc_scheduler_input(void);
+void gc_scheduler_wake(void);
+gint luaH_luakit_gc_options(lua_State *L);
+gint luaH_luakit_gc_stats(lua_State *L);
+
+#endif
+
+// vim: ft=c:et:sw=4:ts=8:sts=4:tw=80
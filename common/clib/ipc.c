@@ -17,6 +17,7 @@
  */
 
 #include <assert.h>
+#include <string.h>
 
 #include "common/clib/ipc.h"
 #include "common/ipc.h"
@@ -24,11 +25,34 @@
 #include "common/tokenize.h"
 #include "common/luaserialize.h"
 #include "common/luauniq.h"
+#include "common/trace.h"
 
 #define REG_KEY "luakit.registry.ipc_channel"
 
+/** A call waiting for its reply */
+typedef struct _ipc_call_t {
+    guint id;
+    /** Endpoint the call was sent to; not referenced */
+    ipc_endpoint_t *ipc;
+    /** Page the call was made for */
+    guint64 page_id;
+    /** Reference to the callback function */
+    gpointer callback;
+    /** Timeout source, or 0 if the call has no deadline */
+    guint timeout_id;
+    /** Start time and name of the round-trip span, if tracing */
+    gint64 trace_start;
+    gchar *trace_name;
+} ipc_call_t;
+
 static lua_class_t ipc_channel_class;
 
+/** Pending calls, keyed by call id */
+static GHashTable *calls;
+static guint last_call_id;
+/** Batched call frames waiting to be sent, keyed by endpoint */
+static GHashTable *batches;
+
 LUA_OBJECT_FUNCS(ipc_channel_class, ipc_channel_t, ipc_channel);
 
 ipc_channel_t *
@@ -52,9 +76,392 @@ luaH_ipc_channel_new(lua_State *L)
     ipc_channel->name = g_strdup(name);
 
     luaH_uniq_add(L, REG_KEY, -2, -1);
+
+    /* Channels are never collected; reference them so that received
+     * messages can find them by pointer */
+    lua_pushvalue(L, -1);
+    luaH_object_ref(L, -1);
+    return 1;
+}
+
+/* Push a channel or signal name for sending on an endpoint: its interned id
+ * if possible, otherwise the name itself */
+void
+ipc_channel_push_name(lua_State *L, ipc_endpoint_t *ipc, const gchar *name)
+{
+    guint id = ipc_intern(ipc, name);
+    if (id)
+        lua_pushinteger(L, id);
+    else
+        lua_pushstring(L, name);
+}
+
+/* Get a channel or signal name from a received message; the value at `idx`
+ * is either the name or its interned id. Returns NULL if the id is unknown */
+const gchar *
+ipc_channel_get_name(lua_State *L, ipc_endpoint_t *ipc, gint idx)
+{
+    if (lua_type(L, idx) == LUA_TNUMBER) {
+        ipc_interned_t *interned = ipc_interned_get(ipc, lua_tointeger(L, idx));
+        return interned ? interned->name : NULL;
+    }
+    return lua_tostring(L, idx);
+}
+
+/* Push the channel named by the value at `idx` of a received message, or
+ * nil if there is no such channel. Channels are cached by interned id, so
+ * repeated messages don't need a registry lookup */
+void
+luaH_ipc_channel_push(lua_State *L, ipc_endpoint_t *ipc, gint idx)
+{
+    ipc_interned_t *interned = NULL;
+
+    if (lua_type(L, idx) == LUA_TNUMBER) {
+        interned = ipc_interned_get(ipc, lua_tointeger(L, idx));
+        if (!interned) {
+            lua_pushnil(L);
+            return;
+        }
+        if (interned->data) {
+            luaH_object_push(L, interned->data);
+            return;
+        }
+        lua_pushstring(L, interned->name);
+    } else
+        lua_pushvalue(L, idx);
+
+    if (!luaH_uniq_get(L, REG_KEY, -1))
+        lua_pushnil(L);
+    lua_remove(L, -2);
+
+    /* The channel may not exist yet; if so, look it up again next time */
+    if (interned && !lua_isnil(L, -1))
+        interned->data = lua_touserdata(L, -1);
+}
+
+/* Append the values in a stack range to a buffer as a single frame, prefixed
+ * with its length; call and reply messages consist of one or more frames */
+static void
+ipc_frame_append(lua_State *L, GByteArray *buf, gint start, gint end)
+{
+    guint offset = buf->len;
+    guint32 len = 0;
+    g_byte_array_append(buf, (guint8*)&len, sizeof(len));
+    lua_serialize_range(L, buf, start, end);
+    len = buf->len - offset - sizeof(len);
+    memcpy(buf->data + offset, &len, sizeof(len));
+}
+
+static void
+ipc_frames_send(ipc_endpoint_t *ipc, ipc_type_t type, GByteArray *buf)
+{
+    ipc_header_t header = { .type = type, .length = buf->len };
+    ipc_send(ipc, &header, buf->data);
+}
+
+static void
+ipc_call_free(lua_State *L, ipc_call_t *call)
+{
+    if (call->timeout_id)
+        g_source_remove(call->timeout_id);
+    luaH_object_unref(L, call->callback);
+    g_free(call->trace_name);
+    g_slice_free(ipc_call_t, call);
+}
+
+/* Call the callback of a finished call with the `nargs` values on top of
+ * the stack, and free the call */
+static void
+ipc_call_finish(lua_State *L, ipc_call_t *call, gint nargs)
+{
+    g_hash_table_remove(calls, GUINT_TO_POINTER(call->id));
+    trace_end(call->trace_start, "ipc", call->trace_name);
+    luaH_object_push(L, call->callback);
+    luaH_dofunction(L, nargs, 0);
+    ipc_call_free(L, call);
+}
+
+static gboolean
+ipc_call_timeout_cb(ipc_call_t *call)
+{
+    lua_State *L = common.L;
+    gint top = lua_gettop(L);
+    call->timeout_id = 0;
+    lua_pushboolean(L, FALSE);
+    lua_pushliteral(L, "timed out");
+    ipc_call_finish(L, call, 2);
+    lua_settop(L, top);
+    return FALSE;
+}
+
+/* Finish a call that can't be answered, as its endpoint has closed */
+static void
+ipc_call_fail_closed(lua_State *L, ipc_call_t *call)
+{
+    gint top = lua_gettop(L);
+    lua_pushboolean(L, FALSE);
+    lua_pushliteral(L, "endpoint closed");
+    ipc_call_finish(L, call, 2);
+    lua_settop(L, top);
+}
+
+static gboolean
+ipc_call_closed_cb(ipc_call_t *call)
+{
+    call->timeout_id = 0;
+    ipc_call_fail_closed(common.L, call);
+    return FALSE;
+}
+
+/* Finish all pending calls to an endpoint that has closed */
+void
+ipc_channel_fail_calls(ipc_endpoint_t *ipc)
+{
+    if (!calls)
+        return;
+
+    /* Callbacks may cancel other calls, so look each one up again */
+    GArray *ids = g_array_new(FALSE, FALSE, sizeof(guint));
+    GHashTableIter iter;
+    ipc_call_t *call;
+    g_hash_table_iter_init(&iter, calls);
+    while (g_hash_table_iter_next(&iter, NULL, (gpointer*)&call))
+        if (call->ipc == ipc)
+            g_array_append_val(ids, call->id);
+
+    for (guint i = 0; i < ids->len; i++) {
+        guint id = g_array_index(ids, guint, i);
+        if ((call = g_hash_table_lookup(calls, GUINT_TO_POINTER(id))))
+            ipc_call_fail_closed(common.L, call);
+    }
+    g_array_free(ids, TRUE);
+}
+
+static gboolean
+ipc_call_flush_batches(gpointer UNUSED(user_data))
+{
+    GHashTableIter iter;
+    gpointer ipc, buf;
+    g_hash_table_iter_init(&iter, batches);
+    while (g_hash_table_iter_next(&iter, &ipc, &buf)) {
+        ipc_frames_send(ipc, IPC_TYPE_lua_ipc_call, buf);
+        ipc_endpoint_decref(ipc);
+        g_byte_array_unref(buf);
+        g_hash_table_iter_remove(&iter);
+    }
+    return FALSE;
+}
+
+/* Get the batch of calls to be sent to an endpoint at the next main loop
+ * iteration; returns NULL if the endpoint is being freed */
+static GByteArray *
+ipc_call_batch(ipc_endpoint_t *ipc)
+{
+    if (!batches)
+        batches = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+    GByteArray *buf = g_hash_table_lookup(batches, ipc);
+    if (buf)
+        return buf;
+
+    /* Keep the endpoint alive until the batch is sent */
+    if (!ipc_endpoint_incref(ipc))
+        return NULL;
+    if (g_hash_table_size(batches) == 0)
+        g_idle_add_full(G_PRIORITY_HIGH_IDLE, ipc_call_flush_batches, NULL, NULL);
+    buf = g_byte_array_new();
+    g_hash_table_insert(batches, ipc, buf);
+    return buf;
+}
+
+/* Make a call on the channel at index 1 to the given endpoint and page.
+ * Stack: channel, signal name, arguments..., options, callback */
+gint
+ipc_channel_call_to(lua_State *L, ipc_endpoint_t *ipc, guint64 page_id)
+{
+    ipc_channel_t *ipc_channel = luaH_check_ipc_channel(L, 1);
+    const gchar *signame = luaL_checkstring(L, 2);
+    gint top = lua_gettop(L);
+    luaL_checktype(L, top, LUA_TFUNCTION);
+    if (top < 4 || !(lua_istable(L, top - 1) || lua_isnil(L, top - 1)))
+        luaL_typerror(L, top - 1, "table");
+    gint nargs = top - 4;
+    gint timeout = 0;
+    gboolean batch = FALSE;
+
+    if (lua_istable(L, top - 1)) {
+        lua_getfield(L, top - 1, "timeout");
+        if (!lua_isnil(L, -1) && !lua_isnumber(L, -1))
+            luaL_error(L, "call timeout must be a number");
+        timeout = lua_tonumber(L, -1);
+        lua_getfield(L, top - 1, "batch");
+        batch = lua_toboolean(L, -1);
+        lua_pop(L, 2);
+    }
+
+    if (!calls)
+        calls = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+    ipc_call_t *call = g_slice_new0(ipc_call_t);
+    if (++last_call_id == 0)
+        last_call_id++;
+    call->id = last_call_id;
+    call->ipc = ipc;
+    call->page_id = page_id;
+    if ((call->trace_start = trace_begin()))
+        call->trace_name = g_strdup_printf("call %s:%s", ipc_channel->name, signame);
+    lua_pushvalue(L, top);
+    call->callback = luaH_object_ref(L, -1);
+    if (timeout > 0)
+        call->timeout_id = g_timeout_add(timeout, (GSourceFunc)ipc_call_timeout_cb, call);
+    g_hash_table_insert(calls, GUINT_TO_POINTER(call->id), call);
+    guint id = call->id;
+
+    /* Frame: call id, signal name, channel name, page id, arguments... */
+    luaL_checkstack(L, nargs + 4, "too many arguments");
+    lua_pushinteger(L, call->id);
+    ipc_channel_push_name(L, ipc, signame);
+    ipc_channel_push_name(L, ipc, ipc_channel->name);
+    lua_pushinteger(L, page_id);
+    for (gint i = 3; i < 3 + nargs; i++)
+        lua_pushvalue(L, i);
+
+    if (batch) {
+        GByteArray *buf = ipc_call_batch(ipc);
+        if (buf)
+            ipc_frame_append(L, buf, top + 1, lua_gettop(L));
+        else {
+            /* The endpoint is being freed, so the call can't be sent; fail
+             * it once this function has returned */
+            if (call->timeout_id)
+                g_source_remove(call->timeout_id);
+            call->timeout_id = g_idle_add((GSourceFunc)ipc_call_closed_cb, call);
+        }
+    } else {
+        GByteArray *buf = g_byte_array_new();
+        ipc_frame_append(L, buf, top + 1, lua_gettop(L));
+        ipc_frames_send(ipc, IPC_TYPE_lua_ipc_call, buf);
+        g_byte_array_unref(buf);
+    }
+
+    lua_settop(L, top);
+    lua_pushinteger(L, id);
     return 1;
 }
 
+static gint
+luaH_ipc_channel_cancel(lua_State *L)
+{
+    luaH_check_ipc_channel(L, 1);
+    guint id = luaL_checkinteger(L, 2);
+    ipc_call_t *call = calls ? g_hash_table_lookup(calls, GUINT_TO_POINTER(id)) : NULL;
+    if (call) {
+        g_hash_table_remove(calls, GUINT_TO_POINTER(id));
+        ipc_call_free(L, call);
+    }
+    lua_pushboolean(L, call != NULL);
+    return 1;
+}
+
+/* Drop all pending calls made for a page, without calling their callbacks */
+void
+ipc_channel_cancel_calls(guint64 page_id)
+{
+    if (!calls)
+        return;
+
+    GHashTableIter iter;
+    ipc_call_t *call;
+    g_hash_table_iter_init(&iter, calls);
+    while (g_hash_table_iter_next(&iter, NULL, (gpointer*)&call)) {
+        if (call->page_id != page_id)
+            continue;
+        g_hash_table_iter_remove(&iter);
+        ipc_call_free(common.L, call);
+    }
+}
+
+/* Handle a single call frame, and append its reply to `replies`.
+ * Stack: call id, signal name, channel name, page id, arguments... */
+static void
+ipc_call_dispatch(lua_State *L, ipc_endpoint_t *ipc, gint top, gint n, GByteArray *replies)
+{
+    const gchar *signame = ipc_channel_get_name(L, ipc, top + 2);
+    luaH_ipc_channel_push(L, ipc, top + 3);
+    lua_replace(L, top + 3);
+    luaH_ipc_channel_push_page(L, lua_tointeger(L, top + 4));
+    lua_replace(L, top + 4);
+
+    lua_object_t *obj = lua_touserdata(L, top + 3);
+    if (!signame || !obj || !signal_lookup(obj->signals, signame)) {
+        lua_pushfstring(L, "no handler for call '%s'", signame ?: "<unknown>");
+        lua_replace(L, top + 2);
+        lua_settop(L, top + 2);
+        lua_pushboolean(L, FALSE);
+        lua_insert(L, top + 2);
+    } else {
+        /* The first handler to return a value provides the results */
+        luaH_object_emit_signal(L, top + 3, signame, n - 3, LUA_MULTRET);
+        lua_remove(L, top + 3);
+        lua_pushboolean(L, TRUE);
+        lua_replace(L, top + 2);
+    }
+
+    /* Stack: call id, ok, results... */
+    ipc_frame_append(L, replies, top + 1, lua_gettop(L));
+}
+
+void
+ipc_channel_recv_call(lua_State *L, ipc_endpoint_t *ipc, const gchar *arg, guint arglen)
+{
+    GByteArray *replies = g_byte_array_new();
+    const gchar *end = arg + arglen;
+
+    while (arg < end) {
+        guint32 len;
+        memcpy(&len, arg, sizeof(len));
+        arg += sizeof(len);
+        g_assert(arg + len <= end);
+
+        gint top = lua_gettop(L);
+        gint n = lua_deserialize_range(L, (guint8*)arg, len);
+        ipc_call_dispatch(L, ipc, top, n, replies);
+        lua_settop(L, top);
+        arg += len;
+    }
+
+    /* Replies to a batch of calls are sent together */
+    ipc_frames_send(ipc, IPC_TYPE_lua_ipc_reply, replies);
+    g_byte_array_unref(replies);
+}
+
+void
+ipc_channel_recv_reply(lua_State *L, ipc_endpoint_t *UNUSED(ipc), const gchar *arg, guint arglen)
+{
+    const gchar *end = arg + arglen;
+
+    while (arg < end) {
+        guint32 len;
+        memcpy(&len, arg, sizeof(len));
+        arg += sizeof(len);
+        g_assert(arg + len <= end);
+
+        /* Stack: call id, ok, results... */
+        gint top = lua_gettop(L);
+        gint n = lua_deserialize_range(L, (guint8*)arg, len);
+        guint id = lua_tointeger(L, top + 1);
+        ipc_call_t *call = calls ? g_hash_table_lookup(calls, GUINT_TO_POINTER(id)) : NULL;
+
+        /* Ignore replies to calls that timed out or were cancelled */
+        if (call) {
+            lua_remove(L, top + 1);
+            ipc_call_finish(L, call, n - 1);
+        }
+        lua_settop(L, top);
+        arg += len;
+    }
+}
+
 static gint
 luaH_ipc_channel_gc(lua_State *L)
 {
@@ -77,6 +484,8 @@ ipc_channel_class_setup(lua_State *L)
     {
         LUA_OBJECT_META(ipc_channel)
         { "emit_signal", ipc_channel_send },
+        { "call", ipc_channel_call },
+        { "cancel", luaH_ipc_channel_cancel },
         { "__gc", luaH_ipc_channel_gc },
         { NULL, NULL }
     };
@@ -23,6 +23,7 @@
 #include <glib.h>
 
 #include "common/util.h"
+#include "common/ipc.h"
 #include "common/luaclass.h"
 #include "common/luaobject.h"
 
@@ -34,7 +35,17 @@ typedef struct _ipc_channel_t {
 ipc_channel_t *luaH_check_ipc_channel(lua_State *L, gint idx);
 gint luaH_ipc_channel_new(lua_State *L);
 gint ipc_channel_send(lua_State *L);
-void ipc_channel_recv(lua_State *L, const gchar *arg, guint arglen);
+void ipc_channel_recv(lua_State *L, ipc_endpoint_t *ipc, const gchar *arg, guint arglen);
+gint ipc_channel_call(lua_State *L);
+gint ipc_channel_call_to(lua_State *L, ipc_endpoint_t *ipc, guint64 page_id);
+void ipc_channel_cancel_calls(guint64 page_id);
+void ipc_channel_fail_calls(ipc_endpoint_t *ipc);
+void ipc_channel_recv_call(lua_State *L, ipc_endpoint_t *ipc, const gchar *arg, guint arglen);
+void ipc_channel_recv_reply(lua_State *L, ipc_endpoint_t *ipc, const gchar *arg, guint arglen);
+void luaH_ipc_channel_push_page(lua_State *L, guint64 page_id);
+void ipc_channel_push_name(lua_State *L, ipc_endpoint_t *ipc, const gchar *name);
+const gchar *ipc_channel_get_name(lua_State *L, ipc_endpoint_t *ipc, gint idx);
+void luaH_ipc_channel_push(lua_State *L, ipc_endpoint_t *ipc, gint idx);
 void ipc_channel_set_module(lua_State *L, const gchar *module_name);
 void ipc_channel_class_setup(lua_State *);
 
@@ -25,12 +25,18 @@
 #include <lua.h>
 #include <glib.h>
 
+#include "common/clib/gc.h"
+#include "common/clib/task.h"
+
 #define LUAKIT_LIB_COMMON_METHODS \
     { "time",        luaH_luakit_time        }, \
     { "uri_encode",  luaH_luakit_uri_encode  }, \
     { "uri_decode",  luaH_luakit_uri_decode  }, \
     { "idle_add",    luaH_luakit_idle_add    }, \
     { "idle_remove", luaH_luakit_idle_remove }, \
+    { "task",        luaH_luakit_task        }, \
+    { "gc_options",  luaH_luakit_gc_options  }, \
+    { "gc_stats",    luaH_luakit_gc_stats    }, \
 
 gint luaH_luakit_time(lua_State *L);
 gint luaH_luakit_uri_encode(lua_State *L);
@@ -30,6 +30,13 @@ typedef struct {
     gchar *pattern;
     GRegexCompileFlags compile_options;
     GRegexMatchFlags match_options;
+
+    /* State of the last match, reused when the next search in the same
+     * subject resumes where it ended */
+    GMatchInfo *match_info;
+    const gchar *match_subject;
+    gssize match_len;
+    gint match_start, match_end;
 } lregex_t;
 
 static lua_class_t regex_class;
@@ -39,10 +46,21 @@ LUA_OBJECT_FUNCS(regex_class, lregex_t, regex)
 
 #define luaH_checkregex(L, idx) luaH_checkudata(L, idx, &(regex_class))
 
+static void
+regex_reset_match(lregex_t *regex)
+{
+    if (regex->match_info)
+        g_match_info_free(regex->match_info);
+    regex->match_info = NULL;
+    regex->match_subject = NULL;
+    regex->match_start = regex->match_end = -1;
+}
+
 static gint
 luaH_regex_gc(lua_State *L)
 {
     lregex_t *regex = luaH_checkregex(L, 1);
+    regex_reset_match(regex);
     if (regex->reg)
         g_regex_unref(regex->reg);
     g_free(regex->pattern);
@@ -54,6 +72,7 @@ luaH_regenerate_regex(lua_State *L, lregex_t *regex)
 {
     g_assert(regex->pattern);
 
+    regex_reset_match(regex);
     if (regex->reg)
         g_regex_unref(regex->reg);
 
@@ -79,15 +98,312 @@ luaH_regex_new(lua_State *L)
     return 1;
 }
 
+/* Convert a Lua string start index (1-based, negative counts from the end)
+ * into a byte offset */
+static gint
+regex_start_offset(lua_State *L, gint idx, gssize len)
+{
+    gint init = luaL_optint(L, idx, 1);
+    if (init < 0)
+        init += len + 1;
+    if (init < 1)
+        init = 1;
+    if (init > len + 1)
+        init = len + 1;
+    return init - 1;
+}
+
+/* Get the subject length, optionally limited to a number of bytes */
+static gssize
+regex_subject_len(lua_State *L, gint sidx, gint limit_idx)
+{
+    size_t len;
+    luaL_checklstring(L, sidx, &len);
+    gint limit = limit_idx ? luaL_optint(L, limit_idx, -1) : -1;
+    if (limit >= 0 && (size_t)limit < len)
+        len = limit;
+    return len;
+}
+
+/* Search for the next match at or after byte offset start.
+ *
+ * The match state is kept in the regex object. When a search resumes in the
+ * same subject at the end of the previous non-empty match, it is continued
+ * with g_match_info_next() rather than starting a new match, so iterating
+ * over all matches does not allocate. */
+static gboolean
+regex_find(lua_State *L, gint oud, lregex_t *regex, gint sidx, gssize len, gint start)
+{
+    const gchar *subject = lua_tostring(L, sidx);
+    GError *error = NULL;
+    gboolean matched;
+
+    g_assert(regex->reg);
+
+    if (regex->match_info && regex->match_subject == subject
+            && regex->match_len == len && regex->match_end == start
+            && regex->match_start != regex->match_end) {
+        matched = g_match_info_next(regex->match_info, &error);
+    } else {
+        regex_reset_match(regex);
+        matched = g_regex_match_full(regex->reg, subject, len, start, 0,
+                &regex->match_info, &error);
+        regex->match_subject = subject;
+        regex->match_len = len;
+        /* The match state refers to the subject; keep it alive */
+        lua_getfenv(L, oud);
+        lua_pushvalue(L, sidx);
+        lua_setfield(L, -2, "subject");
+        lua_pop(L, 1);
+    }
+
+    if (error) {
+        regex_reset_match(regex);
+        lua_pushstring(L, error->message);
+        g_error_free(error);
+        lua_error(L);
+    }
+
+    if (!matched) {
+        regex->match_start = regex->match_end = -1;
+        return FALSE;
+    }
+
+    g_match_info_fetch_pos(regex->match_info, 0,
+            &regex->match_start, &regex->match_end);
+    return TRUE;
+}
+
+/* Push a capture group of the last match, or false if it did not match */
+static void
+regex_push_capture(lua_State *L, lregex_t *regex, gint n)
+{
+    gint start, end;
+    if (g_match_info_fetch_pos(regex->match_info, n, &start, &end) && start >= 0)
+        lua_pushlstring(L, regex->match_subject + start, end - start);
+    else
+        lua_pushboolean(L, FALSE);
+}
+
+/* Push all capture groups of the last match, or the whole match if the
+ * pattern has no capture groups */
+static gint
+regex_push_captures(lua_State *L, lregex_t *regex)
+{
+    gint n = g_regex_get_capture_count(regex->reg);
+    if (n == 0) {
+        regex_push_capture(L, regex, 0);
+        return 1;
+    }
+    luaL_checkstack(L, n, "too many captures");
+    for (gint i = 1; i <= n; i++)
+        regex_push_capture(L, regex, i);
+    return n;
+}
+
+/* Offset to continue searching from after a match, stepping over empty
+ * matches so that iteration always makes progress. Returns an offset past
+ * the end of the subject once there is nothing left to search. */
+static gint
+regex_next_start(lregex_t *regex, gssize len)
+{
+    if (regex->match_end != regex->match_start)
+        return regex->match_end;
+    if (regex->match_end >= len)
+        return len + 1;
+    return g_utf8_next_char(regex->match_subject + regex->match_end)
+        - regex->match_subject;
+}
+
 static int
 luaH_regex_match(lua_State *L)
 {
     lregex_t *regex = luaH_checkregex(L, 1);
-    const gchar *haystack = luaL_checkstring(L, 2);
+    gssize len = regex_subject_len(L, 2, 4);
+    gint start = regex_start_offset(L, 3, len);
 
-    g_assert(regex->reg);
-    gboolean matched = g_regex_match(regex->reg, haystack, 0, NULL);
-    lua_pushboolean(L, matched);
+    lua_pushboolean(L, regex_find(L, 1, regex, 2, len, start));
+    return 1;
+}
+
+static int
+luaH_regex_exec(lua_State *L)
+{
+    lregex_t *regex = luaH_checkregex(L, 1);
+    gssize len = regex_subject_len(L, 2, 4);
+    gint start = regex_start_offset(L, 3, len);
+
+    if (!regex_find(L, 1, regex, 2, len, start))
+        return 0;
+
+    lua_pushnumber(L, regex->match_start + 1);
+    lua_pushnumber(L, regex->match_end);
+    gint n = g_regex_get_capture_count(regex->reg);
+    luaL_checkstack(L, n, "too many captures");
+    for (gint i = 1; i <= n; i++)
+        regex_push_capture(L, regex, i);
+    return n + 2;
+}
+
+static int
+regex_gmatch_iter(lua_State *L)
+{
+    lua_pushvalue(L, lua_upvalueindex(1));
+    lregex_t *regex = lua_touserdata(L, -1);
+    gint oud = lua_gettop(L);
+    gssize len = lua_tointeger(L, lua_upvalueindex(4));
+    gint start = lua_tointeger(L, lua_upvalueindex(3));
+
+    if (start > len || !regex_find(L, oud, regex, lua_upvalueindex(2), len, start))
+        return 0;
+
+    lua_pushinteger(L, regex_next_start(regex, len));
+    lua_replace(L, lua_upvalueindex(3));
+    return regex_push_captures(L, regex);
+}
+
+static int
+luaH_regex_gmatch(lua_State *L)
+{
+    luaH_checkregex(L, 1);
+    gssize len = regex_subject_len(L, 2, 4);
+    gint start = regex_start_offset(L, 3, len);
+
+    lua_settop(L, 2);
+    lua_pushinteger(L, start);
+    lua_pushinteger(L, len);
+    lua_pushcclosure(L, regex_gmatch_iter, 4);
+    return 1;
+}
+
+/* Append a replacement string for the current match to the buffer,
+ * expanding %0-%9 to capture groups and %% to % */
+static void
+regex_add_replacement_string(lua_State *L, lregex_t *regex, luaL_Buffer *b, gint ridx)
+{
+    size_t rlen;
+    const gchar *r = lua_tolstring(L, ridx, &rlen);
+    gint ncaptures = g_regex_get_capture_count(regex->reg);
+
+    for (size_t i = 0; i < rlen; i++) {
+        if (r[i] != '%') {
+            luaL_addchar(b, r[i]);
+            continue;
+        }
+        if (++i < rlen && r[i] == '%') {
+            luaL_addchar(b, '%');
+            continue;
+        }
+        if (i >= rlen || !g_ascii_isdigit(r[i]))
+            luaL_error(L, "invalid use of '%%' in replacement string");
+
+        gint n = r[i] - '0';
+        /* As with string.gsub, %1 is the whole match if there are no captures */
+        if (n == 1 && ncaptures == 0)
+            n = 0;
+        if (n > ncaptures)
+            luaL_error(L, "invalid capture index %%%d in replacement string", n);
+        regex_push_capture(L, regex, n);
+        if (lua_isstring(L, -1))
+            luaL_addvalue(b);
+        else
+            lua_pop(L, 1);
+    }
+}
+
+/* Append the replacement for the current match to the buffer; match is the
+ * matched text, which is kept if a function or table replacement returns false
+ * or nil. It's copied from the subject beforehand, as the callback may run
+ * this regex again. */
+static void
+regex_add_replacement(lua_State *L, lregex_t *regex, luaL_Buffer *b, gint ridx,
+        const gchar *match, gsize match_len)
+{
+    if (lua_type(L, ridx) == LUA_TSTRING || lua_type(L, ridx) == LUA_TNUMBER) {
+        regex_add_replacement_string(L, regex, b, ridx);
+        return;
+    }
+
+    if (lua_type(L, ridx) == LUA_TTABLE) {
+        gint n = regex_push_captures(L, regex);
+        lua_pop(L, n - 1);
+        lua_gettable(L, ridx);
+    } else {
+        lua_pushvalue(L, ridx);
+        gint n = regex_push_captures(L, regex);
+        lua_call(L, n, 1);
+    }
+
+    /* Keep the original match if the replacement is false or nil */
+    if (!lua_toboolean(L, -1)) {
+        lua_pop(L, 1);
+        lua_pushlstring(L, match, match_len);
+    } else if (!lua_isstring(L, -1))
+        luaL_error(L, "invalid replacement value (a %s)", luaL_typename(L, -1));
+    luaL_addvalue(b);
+}
+
+static int
+luaH_regex_gsub(lua_State *L)
+{
+    lregex_t *regex = luaH_checkregex(L, 1);
+    gssize len = regex_subject_len(L, 2, 5);
+    gint rtype = lua_type(L, 3);
+    luaL_argcheck(L, rtype == LUA_TNUMBER || rtype == LUA_TSTRING
+            || rtype == LUA_TTABLE || rtype == LUA_TFUNCTION, 3,
+            "string/function/table expected");
+    gint max = luaL_optint(L, 4, -1);
+    lua_settop(L, 3);
+
+    const gchar *subject = lua_tostring(L, 2);
+    gint last = 0, start = 0, count = 0;
+    luaL_Buffer b;
+    luaL_buffinit(L, &b);
+
+    while ((max < 0 || count < max) && start <= len
+            && regex_find(L, 1, regex, 2, len, start)) {
+        /* The replacement may run this regex again, so save the match */
+        gint match_start = regex->match_start, match_end = regex->match_end;
+        start = regex_next_start(regex, len);
+
+        luaL_addlstring(&b, subject + last, match_start - last);
+        regex_add_replacement(L, regex, &b, 3,
+                subject + match_start, match_end - match_start);
+        last = match_end;
+        count++;
+    }
+    luaL_addlstring(&b, subject + last, lua_objlen(L, 2) - last);
+    luaL_pushresult(&b);
+    lua_pushinteger(L, count);
+    return 2;
+}
+
+static int
+luaH_regex_split(lua_State *L)
+{
+    lregex_t *regex = luaH_checkregex(L, 1);
+    gssize len = regex_subject_len(L, 2, 4);
+    gint max = luaL_optint(L, 3, -1);
+    const gchar *subject = lua_tostring(L, 2);
+    gint last = 0, start = 0, n = 0;
+
+    lua_newtable(L);
+    while ((max <= 0 || n < max - 1) && start <= len
+            && regex_find(L, 1, regex, 2, len, start)) {
+        gint match_start = regex->match_start, match_end = regex->match_end;
+        start = regex_next_start(regex, len);
+
+        /* Don't split on empty matches at either end of a field */
+        if (match_start == match_end && (match_start == last || match_start >= len))
+            continue;
+
+        lua_pushlstring(L, subject + last, match_start - last);
+        lua_rawseti(L, -2, ++n);
+        last = match_end;
+    }
+    /* Bytes past the limit are kept in the last field */
+    lua_pushlstring(L, subject + last, lua_objlen(L, 2) - last);
+    lua_rawseti(L, -2, ++n);
     return 1;
 }
 
@@ -123,6 +439,10 @@ regex_class_setup(lua_State *L)
         LUA_OBJECT_META(regex)
         LUA_CLASS_META
         { "match", luaH_regex_match },
+        { "exec", luaH_regex_exec },
+        { "gmatch", luaH_regex_gmatch },
+        { "gsub", luaH_regex_gsub },
+        { "split", luaH_regex_split },
         { "__gc", luaH_regex_gc },
         { NULL, NULL },
     };
@@ -0,0 +1,424 @@
+/*
+ * common/clib/task.c - time-sliced Lua coroutine tasks
+ *
+ * Copyright © 2017 Aidan Holm <aidanholm@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* Tasks are Lua coroutines run by a single scheduler source at idle
+ * priority. Each time the source is dispatched (a "frame"), runnable tasks
+ * are resumed in priority order, each for at most its own budget, until
+ * the frame budget is spent; the main loop then handles pending input and
+ * drawing before the next frame. Tasks call task.yield() regularly; it
+ * only actually yields once the task's budget for the frame is spent. */
+
+#include "common/clib/task.h"
+#include "common/luaobject.h"
+#include "common/common.h"
+#include "luah.h"
+
+#include <glib.h>
+
+/* Time spent running tasks per frame, in microseconds */
+#define TASK_FRAME_BUDGET_US 8000
+/* Default time a single task may run per frame, in milliseconds */
+#define TASK_DEFAULT_BUDGET_MS 8
+
+typedef enum {
+    TASK_PRIORITY_HIGH,
+    TASK_PRIORITY_DEFAULT,
+    TASK_PRIORITY_LOW,
+    TASK_PRIORITY_COUNT,
+} task_priority_t;
+
+static const gchar *task_priority_names[] = { "high", "default", "low", NULL };
+
+typedef enum {
+    TASK_PENDING,
+    TASK_RUNNING,
+    TASK_SLEEPING,
+    TASK_FINISHED,
+    TASK_FAILED,
+    TASK_CANCELLED,
+} task_status_t;
+
+static const gchar *task_status_names[] = {
+    "pending", "running", "sleeping", "finished", "failed", "cancelled",
+};
+
+typedef struct {
+    LUA_OBJECT_HEADER
+    /* Keeps the task alive while it is scheduled */
+    gpointer ref;
+    /* The coroutine running the task, and a reference to it */
+    lua_State *thread;
+    gpointer thread_ref;
+    task_priority_t priority;
+    task_status_t status;
+    /* Run time per frame, in microseconds */
+    gint64 budget;
+    /* Monotonic time at which the current slice ends */
+    gint64 slice_end;
+    /* Monotonic time at which a sleeping task becomes runnable */
+    gint64 wake_time;
+} task_t;
+
+static lua_class_t task_class;
+LUA_OBJECT_FUNCS(task_class, task_t, task)
+
+#define luaH_checktask(L, idx) luaH_checkudata(L, idx, &(task_class))
+
+static struct {
+    GSource *source;
+    /* Runnable tasks, by priority */
+    GQueue runnable[TASK_PRIORITY_COUNT];
+    /* Tasks that already ran this frame, by priority */
+    GQueue deferred[TASK_PRIORITY_COUNT];
+    /* Sleeping tasks, in no particular order */
+    GList *sleeping;
+    /* The task currently being resumed */
+    task_t *current;
+} scheduler;
+
+/* Move sleeping tasks that are due to the runnable queues. Returns the wake
+ * time of the earliest remaining sleeper, or 0 if there are none. */
+static gint64
+task_wake_sleepers(gint64 now)
+{
+    gint64 next = 0;
+    GList *l = scheduler.sleeping;
+    while (l) {
+        GList *next_l = l->next;
+        task_t *t = l->data;
+        if (t->wake_time <= now) {
+            t->status = TASK_PENDING;
+            g_queue_push_tail(&scheduler.runnable[t->priority], t);
+            scheduler.sleeping = g_list_delete_link(scheduler.sleeping, l);
+        } else if (!next || t->wake_time < next)
+            next = t->wake_time;
+        l = next_l;
+    }
+    return next;
+}
+
+static gboolean
+task_any_runnable(void)
+{
+    for (gint p = 0; p < TASK_PRIORITY_COUNT; p++)
+        if (!g_queue_is_empty(&scheduler.runnable[p]))
+            return TRUE;
+    return FALSE;
+}
+
+static gboolean
+task_source_prepare(GSource *UNUSED(source), gint *timeout)
+{
+    /* Tasks aren't run from a main loop nested inside a task, so don't wake
+     * it up for them */
+    if (scheduler.current) {
+        *timeout = -1;
+        return FALSE;
+    }
+
+    gint64 now = g_get_monotonic_time();
+    gint64 next = task_wake_sleepers(now);
+    if (task_any_runnable()) {
+        *timeout = 0;
+        return TRUE;
+    }
+    *timeout = next ? (gint)((next - now + 999) / 1000) : -1;
+    return FALSE;
+}
+
+static gboolean
+task_source_check(GSource *UNUSED(source))
+{
+    if (scheduler.current)
+        return FALSE;
+    task_wake_sleepers(g_get_monotonic_time());
+    return task_any_runnable();
+}
+
+/* Release a task that will not run again, and emit its "finished" signal
+ * with the given number of values from the top of the stack */
+static void
+task_release(lua_State *L, task_t *t, gint nargs)
+{
+    luaH_object_push(L, t->ref);
+    lua_insert(L, -nargs - 1);
+    luaH_object_emit_signal(L, -nargs - 1, "finished", nargs, 0);
+    lua_pop(L, 1);
+
+    luaH_object_unref(L, t->thread_ref);
+    t->thread_ref = NULL;
+    t->thread = NULL;
+    luaH_object_unref(L, t->ref);
+    t->ref = NULL;
+}
+
+/* Resume a task, then requeue or release it */
+static void
+task_resume(lua_State *L, task_t *t, gint64 slice_end)
+{
+    lua_State *co = t->thread;
+    t->status = TASK_RUNNING;
+    t->slice_end = slice_end;
+    scheduler.current = t;
+    /* The first resume starts the function, which was pushed with the task
+     * object as its argument; later ones return from yield() */
+    gint ret = lua_resume(co, lua_status(co) == LUA_YIELD ? 0 : 1);
+    scheduler.current = NULL;
+
+    if (ret == LUA_YIELD) {
+        lua_settop(co, 0);
+        if (t->status == TASK_CANCELLED)
+            task_release(L, t, 0);
+        else if (t->status == TASK_SLEEPING)
+            scheduler.sleeping = g_list_prepend(scheduler.sleeping, t);
+        else {
+            t->status = TASK_PENDING;
+            g_queue_push_tail(&scheduler.deferred[t->priority], t);
+        }
+        return;
+    }
+
+    if (ret == 0) {
+        gint n = lua_gettop(co);
+        if (t->status != TASK_CANCELLED)
+            t->status = TASK_FINISHED;
+        lua_xmove(co, L, n);
+        task_release(L, t, n);
+        return;
+    }
+
+    /* Report the error with a traceback of the coroutine */
+    t->status = TASK_FAILED;
+    lua_getglobal(L, "debug");
+    lua_getfield(L, -1, "traceback");
+    lua_remove(L, -2);
+    lua_pushthread(co);
+    lua_xmove(co, L, 1);
+    lua_xmove(co, L, 1);
+    lua_pcall(L, 2, 1, 0);
+    error("task failed: %s", lua_tostring(L, -1));
+    task_release(L, t, 1);
+}
+
+static gboolean
+task_source_dispatch(GSource *UNUSED(source), GSourceFunc UNUSED(cb), gpointer UNUSED(data))
+{
+    /* Don't run tasks from a main loop nested inside a task */
+    if (scheduler.current)
+        return G_SOURCE_CONTINUE;
+
+    lua_State *L = common.L;
+    gint top = lua_gettop(L);
+    gint64 frame_end = g_get_monotonic_time() + TASK_FRAME_BUDGET_US;
+
+    /* Tasks run at most once per frame; yielded ones are requeued after */
+    for (gint p = 0; p < TASK_PRIORITY_COUNT; p++) {
+        task_t *t;
+        while ((t = g_queue_pop_head(&scheduler.runnable[p]))) {
+            gint64 now = g_get_monotonic_time();
+            if (now >= frame_end) {
+                g_queue_push_head(&scheduler.runnable[p], t);
+                break;
+            }
+            task_resume(L, t, MIN(frame_end, now + t->budget));
+        }
+    }
+
+    for (gint p = 0; p < TASK_PRIORITY_COUNT; p++) {
+        task_t *t;
+        while ((t = g_queue_pop_head(&scheduler.deferred[p])))
+            g_queue_push_tail(&scheduler.runnable[p], t);
+    }
+
+    lua_settop(L, top);
+    return G_SOURCE_CONTINUE;
+}
+
+static GSourceFuncs task_source_funcs = {
+    .prepare = task_source_prepare,
+    .check = task_source_check,
+    .dispatch = task_source_dispatch,
+};
+
+/** Start a task.
+ *
+ * \param L The Lua VM state.
+ * \return  The number of elements pushed on the stack (1).
+ *
+ * \luastack
+ * \lparam func    The function to run as a task; it is called with the task.
+ * \lparam options Optional table with the fields \c priority ("high",
+ *                 "default" or "low") and \c budget_ms.
+ * \lreturn        The task object.
+ */
+gint
+luaH_luakit_task(lua_State *L)
+{
+    luaH_checkfunction(L, 1);
+    task_priority_t priority = TASK_PRIORITY_DEFAULT;
+    gdouble budget_ms = TASK_DEFAULT_BUDGET_MS;
+
+    if (!lua_isnoneornil(L, 2)) {
+        luaH_checktable(L, 2);
+        if (luaH_rawfield(L, 2, "priority")) {
+            priority = luaL_checkoption(L, -1, NULL, task_priority_names);
+            lua_pop(L, 1);
+        }
+        if (luaH_rawfield(L, 2, "budget_ms")) {
+            budget_ms = luaL_checknumber(L, -1);
+            lua_pop(L, 1);
+            if (budget_ms <= 0)
+                return luaL_error(L, "budget_ms must be positive");
+        }
+    }
+    lua_settop(L, 1);
+
+    if (!scheduler.source) {
+        scheduler.source = g_source_new(&task_source_funcs, sizeof(GSource));
+        g_source_set_priority(scheduler.source, G_PRIORITY_DEFAULT_IDLE);
+        g_source_attach(scheduler.source, NULL);
+    }
+
+    task_t *t = task_new(L);
+    t->priority = priority;
+    t->budget = budget_ms * 1000;
+    t->status = TASK_PENDING;
+
+    /* The coroutine starts with the function and the task object */
+    t->thread = lua_newthread(L);
+    lua_pushvalue(L, 1);
+    lua_pushvalue(L, 2);
+    lua_xmove(L, t->thread, 2);
+    t->thread_ref = luaH_object_ref(L, -1);
+
+    /* Keep the task alive while it is scheduled */
+    lua_pushvalue(L, 2);
+    t->ref = luaH_object_ref(L, -1);
+
+    g_queue_push_tail(&scheduler.runnable[priority], t);
+    return 1;
+}
+
+/* Get the running task, checking that it is called from its coroutine */
+static task_t *
+task_check_current(lua_State *L, const gchar *func)
+{
+    task_t *t = scheduler.current;
+    if (!t || t->thread != L)
+        luaL_error(L, "task.%s() must be called from a running task", func);
+    return t;
+}
+
+static gint
+luaH_task_yield(lua_State *L)
+{
+    task_t *t = task_check_current(L, "yield");
+    if (t->status != TASK_CANCELLED && g_get_monotonic_time() < t->slice_end)
+        return 0;
+    return lua_yield(L, 0);
+}
+
+static gint
+luaH_task_sleep(lua_State *L)
+{
+    luaH_checktask(L, 1);
+    gdouble ms = luaL_checknumber(L, 2);
+    task_t *t = task_check_current(L, "sleep");
+    if (t->status != TASK_CANCELLED) {
+        t->status = TASK_SLEEPING;
+        t->wake_time = g_get_monotonic_time() + MAX(ms, 0) * 1000;
+    }
+    return lua_yield(L, 0);
+}
+
+static gint
+luaH_task_cancel(lua_State *L)
+{
+    task_t *t = luaH_checktask(L, 1);
+    switch (t->status) {
+        case TASK_PENDING:
+            if (!g_queue_remove(&scheduler.runnable[t->priority], t))
+                g_queue_remove(&scheduler.deferred[t->priority], t);
+            t->status = TASK_CANCELLED;
+            task_release(L, t, 0);
+            break;
+        case TASK_SLEEPING:
+            scheduler.sleeping = g_list_remove(scheduler.sleeping, t);
+            t->status = TASK_CANCELLED;
+            task_release(L, t, 0);
+            break;
+        case TASK_RUNNING:
+            /* Released when it next yields */
+            t->status = TASK_CANCELLED;
+            break;
+        default:
+            return 0;
+    }
+    lua_pushboolean(L, TRUE);
+    return 1;
+}
+
+static gint
+luaH_task_get_status(lua_State *L, task_t *t)
+{
+    lua_pushstring(L, task_status_names[t->status]);
+    return 1;
+}
+
+static gint
+luaH_task_get_priority(lua_State *L, task_t *t)
+{
+    lua_pushstring(L, task_priority_names[t->priority]);
+    return 1;
+}
+
+void
+task_class_setup(lua_State *L)
+{
+    static const struct luaL_reg task_meta[] =
+    {
+        LUA_OBJECT_META(task)
+        LUA_CLASS_META
+        { "yield", luaH_task_yield },
+        { "sleep", luaH_task_sleep },
+        { "cancel", luaH_task_cancel },
+        { "__gc", luaH_object_gc },
+        { NULL, NULL },
+    };
+
+    luaH_class_setup(L, &task_class, "task",
+            (lua_class_allocator_t) task_new,
+            NULL, NULL,
+            NULL, task_meta);
+
+    luaH_class_add_property(&task_class, L_TK_STATUS,
+            NULL,
+            (lua_class_propfunc_t) luaH_task_get_status,
+            NULL);
+
+    luaH_class_add_property(&task_class, L_TK_PRIORITY,
+            NULL,
+            (lua_class_propfunc_t) luaH_task_get_priority,
+            NULL);
+}
+
+#undef luaH_checktask
+
+// vim: ft=c:et:sw=4:ts=8:sts=4:tw=80
@@ -21,6 +21,9 @@
 #include "common/lualib.h"
 #include "common/luaserialize.h"
 #include "common/ipc.h"
+#include "common/trace.h"
+#include "common/clib/gc.h"
+#include "common/clib/ipc.h"
 
 /* Prototypes for ipc_recv_... functions */
 #define X(name) void ipc_recv_##name(ipc_endpoint_t *ipc, const void *msg, guint length);
@@ -57,6 +60,7 @@ ipc_dispatch(ipc_endpoint_t *ipc, ipc_header_t header, gpointer payload)
     if (header.type != IPC_TYPE_log)
         debug("Process '%s': recv " ANSI_COLOR_BLUE "%s" ANSI_COLOR_RESET " message",
                 ipc->name, ipc_type_name(header.type));
+    gint64 start = trace_begin();
     switch (header.type) {
 #define X(name) case IPC_TYPE_##name: ipc_recv_##name(ipc, payload, header.length); break;
         IPC_TYPES
@@ -64,6 +68,8 @@ ipc_dispatch(ipc_endpoint_t *ipc, ipc_header_t header, gpointer payload)
         default:
             fatal("Received message with invalid type 0x%x", header.type);
     }
+    trace_end(start, "ipc", ipc_type_name(header.type));
+    gc_scheduler_wake();
 }
 
 static gboolean
@@ -155,6 +161,8 @@ ipc_hup(GIOChannel *UNUSED(channel), GIOCondition UNUSED(cond), ipc_endpoint_t *
 
     gboolean should_exit = !strcmp(ipc->name, "Web");
 
+    /* Calls to the other process will never be answered */
+    ipc_channel_fail_calls(ipc);
     ipc_endpoint_decref(ipc);
 
     if (should_exit)
@@ -221,8 +229,9 @@ ipc_recv_and_dispatch_or_enqueue(ipc_endpoint_t *ipc, int type_mask)
     state->bytes_read = 0;
     state->hdr_done = FALSE;
 
-    /* Otherwise, we finished downloading the message */
-    if (header.type & type_mask) {
+    /* Otherwise, we finished downloading the message. Interned names are
+     * always dispatched immediately, since queued messages may use them */
+    if (header.type & (type_mask | IPC_TYPE_lua_ipc_intern)) {
         ipc_dispatch(ipc, header, payload+sizeof(queued_ipc_t));
         g_slice_free1(sizeof(queued_ipc_t) + header.length, payload);
     } else {
@@ -248,6 +257,118 @@ ipc_send_lua(ipc_endpoint_t *ipc, ipc_type_t type, lua_State *L, gint start, gin
     g_byte_array_unref(buf);
 }
 
+/* Maximum number of names interned on a single endpoint */
+#define IPC_INTERN_MAX 1024
+
+/* Get the id of a channel or signal name on an endpoint, interning it with
+ * the other end if necessary.
+ * Returns 0 if the name cannot be interned and must be sent as a string */
+guint
+ipc_intern(ipc_endpoint_t *ipc, const gchar *name)
+{
+    /* Messages sent before the endpoint is connected may be forwarded to a
+     * replacement endpoint, which won't know about any ids */
+    if (ipc->status != IPC_ENDPOINT_CONNECTED)
+        return 0;
+
+    if (!ipc->send_ids)
+        ipc->send_ids = g_hash_table_new(g_str_hash, g_str_equal);
+
+    guint id = GPOINTER_TO_UINT(g_hash_table_lookup(ipc->send_ids, name));
+    if (id)
+        return id;
+
+    guint count = g_hash_table_size(ipc->send_ids);
+    if (count >= IPC_INTERN_MAX)
+        return 0;
+
+    id = count + 1;
+    name = g_intern_string(name);
+    g_hash_table_insert(ipc->send_ids, (gpointer)name, GUINT_TO_POINTER(id));
+
+    /* Send the id before any message that uses it */
+    gsize len = sizeof(ipc_lua_ipc_intern_t) + strlen(name) + 1;
+    ipc_lua_ipc_intern_t *msg = g_malloc(len);
+    msg->id = id;
+    strcpy(msg->name, name);
+    ipc_header_t header = { .type = IPC_TYPE_lua_ipc_intern, .length = len };
+    ipc_send(ipc, &header, msg);
+    g_free(msg);
+
+    return id;
+}
+
+/* Look up a name interned by the other end of an endpoint */
+ipc_interned_t *
+ipc_interned_get(ipc_endpoint_t *ipc, guint id)
+{
+    if (!ipc->recv_names || id == 0 || id > ipc->recv_names->len)
+        return NULL;
+    return g_ptr_array_index(ipc->recv_names, id - 1);
+}
+
+/* Maximum number of scripts registered on a single endpoint */
+#define IPC_SCRIPT_MAX 256
+
+/* Register a script with the other end of an endpoint by its content hash,
+ * sending the source if it has not been sent before. Returns FALSE if the
+ * script cannot be registered and must be sent in full */
+gboolean
+ipc_send_script(ipc_endpoint_t *ipc, const gchar *hash, const gchar *source, gsize len)
+{
+    g_assert(strlen(hash) == IPC_SCRIPT_HASH_LEN);
+
+    /* As with interned names, a replacement endpoint won't have the script */
+    if (ipc->status != IPC_ENDPOINT_CONNECTED)
+        return FALSE;
+
+    if (!ipc->sent_scripts)
+        ipc->sent_scripts = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+    if (g_hash_table_contains(ipc->sent_scripts, hash))
+        return TRUE;
+    if (g_hash_table_size(ipc->sent_scripts) >= IPC_SCRIPT_MAX)
+        return FALSE;
+
+    g_hash_table_add(ipc->sent_scripts, g_strdup(hash));
+
+    gsize msg_len = sizeof(ipc_script_t) + len + 1;
+    ipc_script_t *msg = g_malloc(msg_len);
+    memcpy(msg->hash, hash, sizeof(msg->hash));
+    memcpy(msg->source, source, len);
+    msg->source[len] = '\0';
+    ipc_header_t header = { .type = IPC_TYPE_script, .length = msg_len };
+    ipc_send(ipc, &header, msg);
+    g_free(msg);
+
+    return TRUE;
+}
+
+static void
+ipc_interned_free(ipc_interned_t *interned)
+{
+    g_slice_free(ipc_interned_t, interned);
+}
+
+/* Interned names are handled identically by both processes */
+void
+ipc_recv_lua_ipc_intern(ipc_endpoint_t *ipc, const void *data, guint length)
+{
+    const ipc_lua_ipc_intern_t *msg = data;
+    g_assert(length > sizeof(*msg));
+
+    if (!ipc->recv_names)
+        ipc->recv_names = g_ptr_array_new_with_free_func(
+                (GDestroyNotify)ipc_interned_free);
+
+    /* Ids are allocated sequentially, and messages are never reordered */
+    g_assert(msg->id == ipc->recv_names->len + 1);
+
+    ipc_interned_t *interned = g_slice_new0(ipc_interned_t);
+    interned->name = g_intern_string(msg->name);
+    g_ptr_array_add(ipc->recv_names, interned);
+}
+
 ipc_endpoint_t *
 ipc_endpoint_new(const gchar *name)
 {
@@ -289,6 +410,12 @@ ipc_endpoint_decref(ipc_endpoint_t *ipc)
     if (ipc->status == IPC_ENDPOINT_CONNECTED)
         ipc_endpoint_disconnect(ipc);
     ipc->status = IPC_ENDPOINT_FREED;
+    if (ipc->send_ids)
+        g_hash_table_unref(ipc->send_ids);
+    if (ipc->recv_names)
+        g_ptr_array_unref(ipc->recv_names);
+    if (ipc->sent_scripts)
+        g_hash_table_unref(ipc->sent_scripts);
     g_slice_free(ipc_endpoint_t, ipc);
 }
 
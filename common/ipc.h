@@ -34,6 +34,12 @@
     X(log) \
     X(page_created) \
     X(crash) \
+    X(lua_ipc_intern) \
+    X(lua_ipc_call) \
+    X(lua_ipc_reply) \
+    X(trace) \
+    X(memory) \
+    X(script) \
 
 #define X(name) IPC_TYPE_EXPONENT_##name,
 typedef enum { IPC_TYPES } _ipc_type_exponent_t;
@@ -64,6 +70,23 @@ typedef struct _ipc_lua_ipc_t {
     gchar arg[0];
 } ipc_lua_ipc_t;
 
+/** Defines an id for a channel or signal name; sent once per endpoint, before
+ * the first lua_ipc message that uses the id */
+typedef struct _ipc_lua_ipc_intern_t {
+    guint id;
+    gchar name[0];
+} ipc_lua_ipc_intern_t;
+
+/** Length of a script content hash, as a hex string */
+#define IPC_SCRIPT_HASH_LEN 64
+
+/** Registers a script with the other end by content hash; sent once per
+ * endpoint, before the first eval_js message that refers to it */
+typedef struct _ipc_script_t {
+    gchar hash[IPC_SCRIPT_HASH_LEN + 1];
+    gchar source[0];
+} ipc_script_t;
+
 typedef enum {
     IPC_SCROLL_TYPE_docresize,
     IPC_SCROLL_TYPE_winresize,
@@ -76,6 +99,11 @@ typedef struct _ipc_scroll_t {
     ipc_scroll_subtype_t subtype;
 } ipc_scroll_t;
 
+typedef struct _ipc_memory_t {
+    pid_t pid;
+    gint lua_kb;
+} ipc_memory_t;
+
 typedef struct _ipc_page_created_t {
     guint64 page_id;
     pid_t pid;
@@ -104,6 +132,14 @@ typedef struct _ipc_recv_state_t {
     gboolean hdr_done;
 } ipc_recv_state_t;
 
+/** A name interned by the other end of an endpoint */
+typedef struct _ipc_interned_t {
+    /** The name, as returned by g_intern_string() */
+    const gchar *name;
+    /** Object resolved from the name by the receiver, or NULL */
+    gpointer data;
+} ipc_interned_t;
+
 typedef enum {
     IPC_ENDPOINT_DISCONNECTED,
     IPC_ENDPOINT_CONNECTED,
@@ -125,6 +161,12 @@ typedef struct _ipc_endpoint_t {
     gint refcount;
     /** Whether the endpoint creation signal has been emitted */
     gboolean creation_notified;
+    /** Ids of names interned for sending on this endpoint */
+    GHashTable *send_ids;
+    /** Names interned by the other end, indexed by id - 1 */
+    GPtrArray *recv_names;
+    /** Hashes of scripts registered with the other end */
+    GHashTable *sent_scripts;
 } ipc_endpoint_t;
 
 ipc_endpoint_t *ipc_endpoint_new(const gchar *name);
@@ -140,6 +182,9 @@ const GPtrArray *ipc_endpoints_get(void);
 gboolean ipc_recv_and_dispatch_or_enqueue(ipc_endpoint_t *ipc, int type_mask);
 void ipc_send_lua(ipc_endpoint_t *ipc, ipc_type_t type, lua_State *L, gint start, gint end);
 void ipc_send(ipc_endpoint_t *ipc, const ipc_header_t *header, const void *data);
+guint ipc_intern(ipc_endpoint_t *ipc, const gchar *name);
+ipc_interned_t *ipc_interned_get(ipc_endpoint_t *ipc, guint id);
+gboolean ipc_send_script(ipc_endpoint_t *ipc, const gchar *hash, const gchar *source, gsize len);
 
 #endif
 
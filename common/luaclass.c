@@ -33,7 +33,11 @@ struct lua_class_property {
     lua_class_propfunc_t newindex;
 };
 
-static GPtrArray *luaH_classes = NULL;
+/* Maps each class metatable to its class */
+static GHashTable *luaH_classes = NULL;
+
+/* Interned "property::<name>" signal names, indexed by token */
+static GPtrArray *property_signal_names = NULL;
 
 /** Convert an object to a userdata if possible.
  *
@@ -48,11 +52,9 @@ luaH_toudata(lua_State *L, gint ud, lua_class_t *class) {
     if(p) /* value is a userdata? */
         if(lua_getmetatable(L, ud)) /* does it have a metatable? */
         {
-            lua_pushlightuserdata(L, class);
-            lua_rawget(L, LUA_REGISTRYINDEX);
-            if(!lua_rawequal(L, -1, -2)) /* does it have the correct mt? */
+            if(lua_topointer(L, -1) != class->metatable) /* correct mt? */
                 p = NULL;
-            lua_pop(L, 2); /* remove both metatables */
+            lua_pop(L, 1); /* remove metatable */
         }
     return p;
 }
@@ -81,17 +83,38 @@ luaH_checkudata(lua_State *L, gint ud, lua_class_t *class) {
  */
 lua_class_t *
 luaH_class_get(lua_State *L, gint idx) {
-    gint type = lua_type(L, idx);
-    lua_class_t *class;
+    lua_class_t *class = NULL;
 
-    if(type == LUA_TUSERDATA && luaH_classes)
-        for (guint i = 0; i < luaH_classes->len; i++) {
-            class = luaH_classes->pdata[i];
-            if(luaH_toudata(L, idx, class))
-                return class;
-        }
+    if(lua_type(L, idx) == LUA_TUSERDATA && luaH_classes
+            && lua_getmetatable(L, idx)) {
+        class = g_hash_table_lookup(luaH_classes, lua_topointer(L, -1));
+        lua_pop(L, 1);
+    }
 
-    return NULL;
+    return class;
+}
+
+/** Get the \ref lua_class_t of the object whose metamethod is being run.
+ * Uses the class pointer stored in the object header, so this must only be
+ * used from metamethods of classes created with \ref luaH_class_setup.
+ *
+ * \param L The Lua VM state.
+ * \param idx The index of the object on the stack.
+ * \return The \ref lua_class_t of the object, or \c NULL.
+ */
+static lua_class_t *
+luaH_object_class(lua_State *L, gint idx) {
+    if(lua_type(L, idx) != LUA_TUSERDATA
+            || lua_objlen(L, idx) < sizeof(lua_object_t))
+        return NULL;
+
+    lua_class_t *class = ((lua_object_t *) lua_touserdata(L, idx))->class;
+    if(!class || !lua_getmetatable(L, idx))
+        return NULL;
+    if(lua_topointer(L, -1) != class->metatable)
+        class = NULL;
+    lua_pop(L, 1);
+    return class;
 }
 
 /** Enhanced version of lua_typename that recognizes setup Lua classes.
@@ -161,6 +184,9 @@ luaH_class_add_property(lua_class_t *lua_class, luakit_token_t token,
     /* add property to class properties tree */
     g_hash_table_insert((GHashTable*) lua_class->properties,
             (gpointer) token, prop);
+
+    /* precompute the property change signal name */
+    luaH_property_signal_name(token);
 }
 
 /** Creates a new Lua class.
@@ -186,6 +212,7 @@ luaH_class_setup(lua_State *L, lua_class_t *class,
         const struct luaL_reg meta[]) {
     /* Create the metatable */
     lua_newtable(L);
+    class->metatable = lua_topointer(L, -1);
     /* Register it with class pointer as key in the registry */
     lua_pushlightuserdata(L, class);
     /* Duplicate the metatable */
@@ -215,8 +242,8 @@ luaH_class_setup(lua_State *L, lua_class_t *class,
             g_direct_hash, g_direct_equal);
 
     if (!luaH_classes)
-        luaH_classes = g_ptr_array_new();
-    g_ptr_array_add(luaH_classes, class);
+        luaH_classes = g_hash_table_new(g_direct_hash, g_direct_equal);
+    g_hash_table_insert(luaH_classes, (gpointer) class->metatable, class);
 }
 
 /** Generic wrapper around GTK's \c signal_add.
@@ -274,13 +301,35 @@ luaH_class_emit_signal(lua_State *L, lua_class_t *lua_class,
     return signal_object_emit(L, lua_class->signals, name, nargs, nret);
 }
 
+/** Get the name of the signal emitted when a property changes.
+ *
+ * \param tok The token of the property name.
+ * \return The interned \c "property::<name>" signal name.
+ */
+const gchar *
+luaH_property_signal_name(luakit_token_t tok)
+{
+    if (!property_signal_names)
+        property_signal_names = g_ptr_array_new();
+    if (tok >= property_signal_names->len)
+        g_ptr_array_set_size(property_signal_names, tok + 1);
+
+    const gchar *signame = g_ptr_array_index(property_signal_names, tok);
+    if (!signame) {
+        gchar *s = g_strdup_printf("property::%s", token_tostring(tok));
+        signame = g_intern_string(s);
+        g_free(s);
+        g_ptr_array_index(property_signal_names, tok) = (gpointer) signame;
+    }
+    return signame;
+}
+
 gint
 luaH_class_property_signal(lua_State *L, lua_class_t *lua_class,
         luakit_token_t tok)
 {
-    gchar *signame = g_strdup_printf("property::%s", token_tostring(tok));
-    signal_object_emit(L, lua_class->signals, signame, 0, 0);
-    g_free(signame);
+    signal_object_emit(L, lua_class->signals,
+            luaH_property_signal_name(tok), 0, 0);
     return 0;
 }
 
@@ -341,17 +390,20 @@ luaH_class_index(lua_State *L) {
     if(luaH_usemetatable(L, 1, 2))
         return 1;
 
-    lua_class_t *class = luaH_class_get(L, 1);
+    lua_class_t *class = luaH_object_class(L, 1);
+    if(!class)
+        luaL_typerror(L, 1, "object");
+    lua_object_t *object = lua_touserdata(L, 1);
 
     lua_class_property_t *prop = luaH_class_property_get(L, class, 2);
 
     /* Property does exist and has an index callback */
     if(prop) {
         if(prop->index)
-            return prop->index(L, luaH_checkudata(L, 1, class));
+            return prop->index(L, object);
     } else {
         if(class->index_miss_property)
-            return class->index_miss_property(L, luaH_checkudata(L, 1, class));
+            return class->index_miss_property(L, object);
     }
 
     return 0;
@@ -373,17 +425,20 @@ luaH_class_newindex(lua_State *L) {
     if(luaH_usemetatable(L, 1, 2))
         return 1;
 
-    lua_class_t *class = luaH_class_get(L, 1);
+    lua_class_t *class = luaH_object_class(L, 1);
+    if(!class)
+        luaL_typerror(L, 1, "object");
+    lua_object_t *object = lua_touserdata(L, 1);
 
     lua_class_property_t *prop = luaH_class_property_get(L, class, 2);
 
     /* Property does exist and has a newindex callback */
     if(prop) {
         if(prop->newindex)
-            return prop->newindex(L, luaH_checkudata(L, 1, class));
+            return prop->newindex(L, object);
     } else {
         if(class->newindex_miss_property)
-            return class->newindex_miss_property(L, luaH_checkudata(L, 1, class));
+            return class->newindex_miss_property(L, object);
     }
 
     return 0;
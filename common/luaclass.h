@@ -30,9 +30,11 @@
 
 typedef struct     lua_class_property lua_class_property_t;
 typedef GHashTable lua_class_property_array_t;
+typedef struct     lua_class lua_class_t;
 
 #define LUA_OBJECT_HEADER \
-        signal_t *signals;
+        signal_t *signals; \
+        lua_class_t *class;
 
 /* Generic type for all objects. All Lua objects can be casted
  * to this type. */
@@ -44,9 +46,11 @@ typedef lua_object_t *(*lua_class_allocator_t)(lua_State *);
 
 typedef gint (*lua_class_propfunc_t)(lua_State *, lua_object_t *);
 
-typedef struct {
+struct lua_class {
     /** Class name */
     const gchar *name;
+    /** Class metatable, used to identify objects of this class */
+    gconstpointer metatable;
     /** Class signals */
     signal_t *signals;
     /** Allocator for creating new objects of that class */
@@ -57,7 +61,7 @@ typedef struct {
     lua_class_propfunc_t index_miss_property;
     /** Function to call when a indexing an unknown property */
     lua_class_propfunc_t newindex_miss_property;
-} lua_class_t;
+};
 
 const gchar *luaH_typename(lua_State *, gint);
 lua_class_t *luaH_class_get(lua_State *, gint);
@@ -70,6 +74,7 @@ gint luaH_class_emit_signal(lua_State *, lua_class_t *, const gchar *name,
         gint nargs, gint nret);
 
 gint luaH_class_property_signal(lua_State *, lua_class_t *, luakit_token_t);
+const gchar *luaH_property_signal_name(luakit_token_t);
 
 void luaH_openlib(lua_State *, const gchar *, const struct luaL_reg[],
         const struct luaL_reg[]);
@@ -243,22 +243,22 @@ luaJS_make_exception(JSContextRef context, const gchar *error)
     return JSValueToObject(context, exception, NULL);
 }
 
+/* Evaluate an already converted script; the script string can be kept and
+ * evaluated repeatedly */
 gint
-luaJS_eval_js(lua_State *L, JSContextRef context, const gchar *script, const gchar *source, bool no_return)
+luaJS_eval_jsstring(lua_State *L, JSContextRef context, JSStringRef js_script, const gchar *source, bool no_return)
 {
-
-    JSStringRef js_source, js_script;
+    JSStringRef js_source;
     JSValueRef result, exception = NULL;
 
     /* evaluate the script and get return value*/
-    js_script = JSStringCreateWithUTF8CString(script);
-    js_source = JSStringCreateWithUTF8CString(source);
+    js_source = source ? JSStringCreateWithUTF8CString(source) : NULL;
 
     result = JSEvaluateScript(context, js_script, NULL, js_source, 0, &exception);
 
     /* cleanup */
-    JSStringRelease(js_script);
-    JSStringRelease(js_source);
+    if (js_source)
+        JSStringRelease(js_source);
 
     /* handle javascript exceptions while running script */
     if (exception) {
@@ -284,4 +284,13 @@ luaJS_eval_js(lua_State *L, JSContextRef context, const gchar *script, const gch
     return 2;
 }
 
+gint
+luaJS_eval_js(lua_State *L, JSContextRef context, const gchar *script, const gchar *source, bool no_return)
+{
+    JSStringRef js_script = JSStringCreateWithUTF8CString(script);
+    gint n = luaJS_eval_jsstring(L, context, js_script, source, no_return);
+    JSStringRelease(js_script);
+    return n;
+}
+
 // vim: ft=c:et:sw=4:ts=8:sts=4:tw=80
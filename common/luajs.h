@@ -33,6 +33,7 @@ JSValueRef luaJS_tovalue(lua_State *L, JSContextRef context, gint idx, gchar **e
 JSValueRef luaJS_make_exception(JSContextRef context, const gchar *error);
 
 gint luaJS_eval_js(lua_State *L, JSContextRef context, const gchar *script, const gchar *source, bool no_return);
+gint luaJS_eval_jsstring(lua_State *L, JSContextRef context, JSStringRef script, const gchar *source, bool no_return);
 
 #endif /* end of include guard: LUAKIT_COMMON_LUAJS_H */
 
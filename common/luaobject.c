@@ -363,9 +363,7 @@ luaH_object_emit_signal(lua_State *L, gint oud,
 gint
 luaH_object_property_signal(lua_State *L, gint oud, luakit_token_t tok)
 {
-    gchar *signame = g_strdup_printf("property::%s", token_tostring(tok));
-    luaH_object_emit_signal(L, oud, signame, 0, 0);
-    g_free(signame);
+    luaH_object_emit_signal(L, oud, luaH_property_signal_name(tok), 0, 0);
     return 0;
 }
 
@@ -177,6 +177,7 @@ gint luaH_object_property_signal(lua_State *, gint, luakit_token_t);
         type *p = lua_newuserdata(L, sizeof(type));           \
         p_clear(p, 1);                                        \
         p->signals = signal_new();                            \
+        p->class = &(lua_class);                              \
         luaH_settype(L, &(lua_class));                        \
         lua_newtable(L);                                      \
         lua_newtable(L);                                      \
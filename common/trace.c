@@ -0,0 +1,215 @@
+/*
+ * common/trace.c - startup tracing
+ *
+ * Copyright © 2017 Aidan Holm <aidanholm@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "common/trace.h"
+#include "common/lualib.h"
+#include "common/util.h"
+
+#include <lauxlib.h>
+#include <unistd.h>
+
+static gboolean enabled;
+static gchar *trace_file;
+/* Comma-separated trace events recorded so far */
+static GString *events;
+static GMutex lock;
+
+static void
+trace_append_escaped(GString *str, const gchar *s)
+{
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\')
+            g_string_append_c(str, '\\');
+        if ((guchar)*s < 0x20)
+            g_string_append_printf(str, "\\u%04x", (guchar)*s);
+        else
+            g_string_append_c(str, *s);
+    }
+}
+
+static void
+trace_event(const gchar *ph, gint64 ts, gint64 dur, const gchar *cat, const gchar *name)
+{
+    g_mutex_lock(&lock);
+    if (!events) {
+        g_mutex_unlock(&lock);
+        return;
+    }
+    if (events->len)
+        g_string_append_c(events, ',');
+    g_string_append_printf(events, "{\"ph\":\"%s\",\"pid\":%d,\"tid\":1,"
+            "\"ts\":%" G_GINT64_FORMAT, ph, getpid(), ts);
+    if (dur >= 0)
+        g_string_append_printf(events, ",\"dur\":%" G_GINT64_FORMAT, dur);
+    g_string_append(events, ",\"cat\":\"");
+    trace_append_escaped(events, cat);
+    g_string_append(events, "\",\"name\":\"");
+    trace_append_escaped(events, name);
+    g_string_append(events, "\"}");
+    g_mutex_unlock(&lock);
+}
+
+void
+trace_init(const gchar *process_name, const gchar *file)
+{
+    enabled = TRUE;
+    trace_file = g_strdup(file);
+    events = g_string_new(NULL);
+
+    /* Name the process in the timeline */
+    g_string_append_printf(events, "{\"ph\":\"M\",\"pid\":%d,\"tid\":1,"
+            "\"name\":\"process_name\",\"args\":{\"name\":\"", getpid());
+    trace_append_escaped(events, process_name);
+    g_string_append(events, "\"}}");
+}
+
+gboolean
+trace_enabled(void)
+{
+    return enabled;
+}
+
+gint64
+trace_begin(void)
+{
+    return enabled ? g_get_monotonic_time() : 0;
+}
+
+void
+trace_end(gint64 start, const gchar *cat, const gchar *name)
+{
+    if (!enabled || !start)
+        return;
+    trace_event("X", start, g_get_monotonic_time() - start, cat, name);
+}
+
+void
+trace_instant(const gchar *cat, const gchar *name)
+{
+    if (!enabled)
+        return;
+    trace_event("i", g_get_monotonic_time(), -1, cat, name);
+}
+
+/* Run a module chunk, recording a span for it */
+static gint
+trace_lua_chunk(lua_State *L)
+{
+    gint nargs = lua_gettop(L);
+    gint64 start = trace_begin();
+    lua_pushvalue(L, lua_upvalueindex(1));
+    lua_insert(L, 1);
+    lua_call(L, nargs, LUA_MULTRET);
+    trace_end(start, "require", lua_tostring(L, lua_upvalueindex(2)));
+    return lua_gettop(L);
+}
+
+/* Call the wrapped package loader, and wrap the chunk it finds */
+static gint
+trace_lua_loader(lua_State *L)
+{
+    lua_settop(L, 1);
+    lua_pushvalue(L, lua_upvalueindex(1));
+    lua_pushvalue(L, 1);
+    lua_call(L, 1, 1);
+    if (enabled && lua_isfunction(L, -1)) {
+        lua_pushvalue(L, 1);
+        lua_pushcclosure(L, trace_lua_chunk, 2);
+    }
+    return 1;
+}
+
+void
+trace_lua_setup(lua_State *L)
+{
+    if (!enabled)
+        return;
+
+    lua_getglobal(L, "package");
+    lua_getfield(L, -1, "loaders");
+    gint n = lua_objlen(L, -1);
+    for (gint i = 1; i <= n; i++) {
+        lua_rawgeti(L, -1, i);
+        lua_pushcclosure(L, trace_lua_loader, 1);
+        lua_rawseti(L, -2, i);
+    }
+    lua_pop(L, 2);
+}
+
+void
+trace_send(ipc_endpoint_t *ipc)
+{
+    g_mutex_lock(&lock);
+    if (!enabled) {
+        g_mutex_unlock(&lock);
+        return;
+    }
+    enabled = FALSE;
+    ipc_header_t header = { .type = IPC_TYPE_trace, .length = events->len };
+    ipc_send(ipc, &header, events->str);
+    g_string_free(events, TRUE);
+    events = NULL;
+    g_mutex_unlock(&lock);
+}
+
+void
+trace_add_events(const gchar *data, gsize length)
+{
+    if (!length)
+        return;
+
+    g_mutex_lock(&lock);
+    if (!enabled) {
+        g_mutex_unlock(&lock);
+        return;
+    }
+    if (events->len)
+        g_string_append_c(events, ',');
+    g_string_append_len(events, data, length);
+    g_mutex_unlock(&lock);
+}
+
+void
+trace_finish(void)
+{
+    trace_instant("startup", "finished");
+
+    g_mutex_lock(&lock);
+    if (!enabled) {
+        g_mutex_unlock(&lock);
+        return;
+    }
+    enabled = FALSE;
+    gchar *json = g_strdup_printf("{\"traceEvents\":[%s]}\n", events->str);
+    g_string_free(events, TRUE);
+    events = NULL;
+    g_mutex_unlock(&lock);
+
+    GError *err = NULL;
+    if (trace_file && !g_file_set_contents(trace_file, json, -1, &err)) {
+        warn("unable to write trace file '%s': %s", trace_file, err->message);
+        g_error_free(err);
+    }
+    g_free(json);
+    g_free(trace_file);
+    trace_file = NULL;
+}
+
+// vim: ft=c:et:sw=4:ts=8:sts=4:tw=80
@@ -0,0 +1,61 @@
+/*
+ * common/trace.h - startup tracing
+ *
+ * Copyright © 2017 Aidan Holm <aidanholm@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef LUAKIT_COMMON_TRACE_H
+#define LUAKIT_COMMON_TRACE_H
+
+#include <glib.h>
+#include <lua.h>
+
+#include "common/ipc.h"
+
+/* Startup tracing.
+ *
+ * When luakit is started with --trace, both processes record spans of the
+ * startup critical path against the monotonic clock. Web processes are told
+ * to trace in their initialization payload, and send their events to the UI
+ * process, which writes all of them to the trace file as Chrome trace-event
+ * JSON once the first page has finished loading, or at exit. Tracing is then
+ * switched off.
+ */
+
+/* Start tracing. The UI process passes the file to write the trace to; web
+ * processes pass NULL */
+void trace_init(const gchar *process_name, const gchar *file);
+gboolean trace_enabled(void);
+
+/* Returns the start time of a span, or 0 if tracing is disabled */
+gint64 trace_begin(void);
+void trace_end(gint64 start, const gchar *cat, const gchar *name);
+void trace_instant(const gchar *cat, const gchar *name);
+
+/* Trace each Lua module load */
+void trace_lua_setup(lua_State *L);
+
+/* Web process: send recorded events to the UI process, and stop tracing */
+void trace_send(ipc_endpoint_t *ipc);
+/* UI process: add events received from a web process */
+void trace_add_events(const gchar *events, gsize length);
+/* UI process: write the trace file, and stop tracing */
+void trace_finish(void);
+
+#endif /* end of include guard: LUAKIT_COMMON_TRACE_H */
+
+// vim: ft=c:et:sw=4:ts=8:sts=4:tw=80
@@ -677,6 +677,15 @@ add_cmds({
     cmd("tabp[revious]", "Switch to the previous tab.",
         function (w) w:prev_tab() end),
 
+    cmd("tabo[nly]", "Close all tabs except the current one.",
+        function (w)
+            local others = {}
+            for _, view in ipairs(w.tabs.children) do
+                if view ~= w.view then others[#others+1] = view end
+            end
+            w:close_tabs(others)
+        end),
+
     cmd("tabde[tach]", "Move the current tab tab into a new window",
         function (w) window.new({w.view}) end),
 
@@ -59,6 +59,10 @@ require "modes"
 -- ("$XDG_CONFIG_HOME/luakit/binds.lua" or "/etc/xdg/luakit/binds.lua")
 require "binds"
 
+-- Modules added with lazy.require() are loaded the first time one of their
+-- chrome pages, bindings or commands is used
+local lazy = require "lazy"
+
 ----------------------------------
 -- Optional user script loading --
 ----------------------------------
@@ -93,11 +97,11 @@ require "userscripts"
 
 -- Add bookmarks support
 require "bookmarks"
-require "bookmarks_chrome"
+lazy.require "bookmarks_chrome"
 
 -- Add download support
 local downloads = require "downloads"
-require "downloads_chrome"
+lazy.require "downloads_chrome"
 
 -- Add automatic PDF downloading and opening
 require "viewpdf"
@@ -132,9 +136,11 @@ require "taborder"
 
 -- Save web history
 require "history"
-require "history_chrome"
+lazy.require "history_chrome"
+
+lazy.require "help_chrome"
 
-require "help_chrome"
+lazy.require "memory_chrome"
 
 -- Add command completion
 require "completion"
@@ -159,8 +165,8 @@ require "go_up"
 -- for the current tab.
 require "mixed_content"
 
--- Filter Referer HTTP header if page domain does not match Referer domain
-require_web_module("referer_control_wm")
+-- Only send the Referer HTTP header to the origin of the current page
+require "referer_control"
 
 require "error_page"
 
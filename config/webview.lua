@@ -61,13 +61,13 @@ local init_funcs = {
         end)
         view:add_signal("form-active", function (v)
             local w = webview.window(v)
-            if not w.mode.passthrough then
+            if w and not w.mode.passthrough then
                 w:set_mode("insert")
             end
         end)
         view:add_signal("root-active", function (v)
             local w = webview.window(v)
-            if w.mode.reset_on_focus ~= false then
+            if w and w.mode.reset_on_focus ~= false then
                 w:set_mode()
             end
         end)
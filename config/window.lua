@@ -537,6 +537,59 @@ window.methods = {
         view:destroy()
     end,
 
+    -- Close several tabs at once. A single "close-tabs" signal is emitted
+    -- instead of a "close-tab" signal per tab, and the tablist is updated
+    -- once. The notebook still emits "page-removed" for each tab; its
+    -- handlers only do per-tab bookkeeping while the tablist is frozen.
+    close_tabs = function (w, views, blank_last)
+        local children = w.tabs.children
+        local index = {}
+        for i, v in ipairs(children) do index[v] = i end
+
+        local closing, list = {}, {}
+        for _, view in ipairs(views) do
+            if index[view] and not closing[view] then
+                closing[view] = true
+                list[#list+1] = view
+            end
+        end
+        if #list == 0 then return end
+
+        -- Right to left; undoing the closes then restores them left to right
+        table.sort(list, function (a, b) return index[a] > index[b] end)
+        w:emit_signal("close-tabs", list)
+
+        -- Switch to a remaining tab first, and remove the current tab last,
+        -- so that the notebook switches page at most once
+        local current = w.view
+        if closing[current] then
+            local cur = index[current]
+            for i = cur + 1, #children do
+                if not closing[children[i]] then w.tabs:switch(i) break end
+            end
+            if w.view == current then
+                for i = cur - 1, 1, -1 do
+                    if not closing[children[i]] then w.tabs:switch(i) break end
+                end
+            end
+        end
+
+        w.tablist:freeze()
+        for _, view in ipairs(list) do
+            if view ~= current then w.tabs:remove(view) end
+        end
+        if closing[current] then w.tabs:remove(current) end
+        w.tablist:thaw()
+
+        -- Destroy the closed views straight away, so that their pages stop,
+        -- and no signals are emitted on views outside of a window
+        for _, view in ipairs(list) do view:destroy() end
+
+        if blank_last ~= false and w.tabs:count() == 0 then
+            w:new_tab("luakit://newtab/", false)
+        end
+    end,
+
     attach_tab = function (w, view, switch, order)
         local taborder = package.loaded.taborder
         -- Get tab order function
@@ -578,9 +631,7 @@ window.methods = {
         w:emit_signal("close")
 
         -- Close all tabs
-        while w.tabs:count() ~= 0 do
-            w:close_tab(nil, false)
-        end
+        w:close_tabs(w.tabs.children, false)
 
         -- Destroy tablist
         w.tablist:destroy()
@@ -19,6 +19,25 @@
 --     local ui = ipc_channel("test_wm")
 --     ui:emit_signal("test", "hello")
 --
+-- #### Calls
+--
+-- Where a reply is needed, `ipc_channel:call()` sends a request and passes
+-- the reply to a callback. The request is handled by the signal handlers
+-- for its name on the other side, which receive the view (in the UI
+-- process) or page (in the web process) the call was made for, followed by
+-- the call arguments. The values returned by the first handler that
+-- returns any are the reply.
+--
+--     -- In UI process
+--     wm:call(view, "count_links", {}, function (ok, n)
+--         if ok then msg.info("%d links", n) end
+--     end)
+--
+--     -- In test_wm web module
+--     ui:add_signal("count_links", function (_, page)
+--         return #dom_document(page.id).body:query("a")
+--     end)
+--
 -- @module ipc
 -- @author Aidan Holm
 -- @copyright 2016 Aidan Holm
@@ -34,6 +53,38 @@
 -- @treturn ipc_channel An IPC channel endpoint object.
 
 
+--- @method call
+-- Call a function on the other side of the channel.
+--
+-- The callback is called with `true` followed by the reply values, or with
+-- `false` and an error message if the call timed out or there is no handler
+-- for it.
+--
+-- Pending calls are cancelled without calling the callback when their view
+-- or page is destroyed, or with `ipc_channel:cancel()`.
+--
+-- #### Call options
+--
+-- - `timeout`: Number of milliseconds to wait for the reply; by default,
+--   calls wait indefinitely.
+-- - `batch`: If `true`, the call is sent together with the other batched
+--   calls made in the same main loop iteration. Batched calls may arrive
+--   after messages sent later.
+--
+-- @tparam widget|page target The view (in the UI process) or page (in the
+-- web process) to make the call for.
+-- @tparam string name The name of the call.
+-- @param ... The call arguments.
+-- @tparam table|nil options The call options.
+-- @tparam function callback The function to call with the reply.
+-- @treturn number The call id.
+
+--- @method cancel
+-- Cancel a pending call.
+--
+-- @tparam number id The call id returned by `ipc_channel:call()`.
+-- @treturn boolean `true` if the call was still pending.
+
 ---
 -- Require a Lua module on the web process.
 --
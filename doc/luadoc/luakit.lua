@@ -126,7 +126,163 @@
 -- a webview in response to a `foo://` load attempt, and should be handled to
 -- provide contentt.
 --
+-- If a default handler function is given, requests for pages without their
+-- own handler (see `luakit.register_scheme_page`) are passed to it instead of
+-- emitting the signal. Handler functions are called with the webview, the
+-- URI, the request, the page name (the part of the URI after `scheme://` and
+-- before the next `/`), and the rest of the path. Registering a scheme again
+-- replaces its default handler.
+--
 -- @function luakit.register_scheme
 -- @tparam string scheme The network scheme to register.
+-- @tparam[opt] function func The default handler function.
+
+--- Register a handler function for a page of a custom URI scheme.
+--
+-- Requests are routed to page handlers natively, without calling into Lua
+-- for other pages.
+--
+-- @function luakit.register_scheme_page
+-- @tparam string scheme The registered network scheme.
+-- @tparam string page The page name.
+-- @tparam function func The handler function, or `nil` to remove the
+-- page handler.
+
+--- Serve a static asset on a custom URI scheme from memory.
+--
+-- Requests for `scheme://path` are answered with the asset without calling
+-- into Lua; any query string or fragment is ignored. Where supported, the
+-- response allows the web process to cache the asset.
+--
+-- @function luakit.register_scheme_asset
+-- @tparam string scheme The registered network scheme.
+-- @tparam string path The asset path, of the form `"page/file"`.
+-- @tparam string data The asset contents, or `nil` to remove the asset.
+-- @tparam[opt] string mime The asset MIME type. Default: `text/html`.
+
+--- Replace the application-wide theme stylesheet.
+--
+-- The stylesheet applies to all widgets, which select styles with style
+-- classes (see the `add_class` and `remove_class` widget methods). Changing
+-- it restyles every widget at once; if it is unchanged, nothing is done.
+-- Styles set on individual widgets, such as `fg`, `bg` and `font`, take
+-- precedence. The `lousy.theme` module compiles the theme into this
+-- stylesheet.
+--
+-- This function is not available on the web process.
+--
+-- @function luakit.set_theme_css
+-- @tparam string css The CSS stylesheet.
+-- @treturn boolean Whether the stylesheet was changed.
+
+--- Watch a file or directory for changes.
+--
+-- The callback is called with the name of the event (one of `"changed"`,
+-- `"changes-done"`, `"created"`, `"deleted"` or `"attribute-changed"`), the
+-- path of the file that changed, and, for some events, the path of another
+-- file involved. When watching a directory, events for the files it
+-- contains are reported.
+--
+-- This function is not available on the web process.
+--
+-- @function luakit.watch_file
+-- @tparam string path The path of the file or directory to watch.
+-- @tparam function callback The function to call when the file changes.
+-- @treturn number The id of the watch.
+
+--- Stop watching a file or directory.
+--
+-- This function is not available on the web process.
+--
+-- @function luakit.unwatch_file
+-- @tparam number id The id returned by `luakit.watch_file`.
+-- @treturn boolean `true` if the watch was found and removed.
+
+--- Register a Lua function to be exported to JavaScript.
+--
+-- The function is installed as a global JavaScript function on every page
+-- whose URI matches the given Lua pattern. Functions registered while web
+-- processes are running are sent to them straight away; pages that are
+-- already loaded only get the function once they are reloaded.
+--
+-- Patterns that start with `^` followed by a literal scheme and host are
+-- matched without calling into Lua, and are only tested against pages on
+-- that scheme and host.
+--
+-- By default, functions are only installed in the main frame of a page.
+--
+-- @function luakit.register_function
+-- @tparam string pattern The Lua pattern that page URIs must match.
+-- @tparam string name The name of the JavaScript function.
+-- @tparam function func The Lua function to call.
+-- @tparam[opt] table options Registration options. If `all_frames` is
+-- `true`, the function is installed in subframes as well.
+
+--- Get or set the options of the garbage collection scheduler.
+--
+-- Lua garbage collection work is moved out of input handling into idle time.
+-- When the main loop is idle, collection proceeds in bounded steps; a new
+-- cycle is started from idle time once the heap has grown by `threshold`
+-- percent since the last one. If collection work is due while input events
+-- keep arriving, the collector is stopped until they stop, or for at most
+-- `max_stop_ms`. The collector is never restarted while it has been stopped
+-- with `collectgarbage("stop")`.
+--
+-- The following options are available:
+--
+-- - `burst_ms`: the time after the last input event at which a burst ends.
+--   Default: `250`.
+-- - `max_stop_ms`: the longest time the collector is stopped for during a
+--   burst. Default: `1000`.
+-- - `step_kb`: the size of each collection step, in kilobytes. Default: `64`.
+-- - `budget_ms`: the collection time per idle frame. Default: `2`.
+-- - `interval_ms`: how often to check whether idle collection is needed.
+--   Default: `500`.
+-- - `threshold`: the heap growth that starts an idle cycle, in percent.
+--   Default: `20`.
+--
+-- @function luakit.gc_options
+-- @tparam[opt] table options The options to change.
+-- @treturn table All current options.
+
+--- Get statistics about idle garbage collection.
+--
+-- The returned table has the fields `frames`, `steps`, `cycles` and `bursts`
+-- (counts), `total_ms`, `last_frame_ms`, `max_frame_ms` and `avg_frame_ms`,
+-- `heap_kb` (the current heap size), `in_burst`, and `stopped` (whether the
+-- collector is stopped for a burst).
+--
+-- The times only cover collection run by the scheduler in idle frames;
+-- collection that Lua does by itself as memory is allocated isn't counted.
+--
+-- @function luakit.gc_stats
+-- @treturn table Garbage collection statistics.
+
+--- Collect memory usage statistics.
+--
+-- The returned table has the following fields:
+--
+-- - `ui`: the UI process.
+-- - `web_processes`: a list of web processes; each also has a `views`
+--   field, listing the webviews it hosts.
+-- - `sqlite`: `memory_used_kb`, the total memory used by SQLite, and
+--   `handles`, a list of open databases with their `filename`, `cache_kb`,
+--   `schema_kb` and `stmt_kb`.
+-- - `tables`: the number of entries in the Lua `registry`, `objects`
+--   (the luakit object registry), `globals` and `modules` tables, and in
+--   `registry_tables`, the number of entries in each table stored in the
+--   registry under a name. Lua doesn't expose the memory used by a single
+--   table, so table sizes are given as numbers of entries.
+--
+-- Process entries have the fields `pid`, `rss_kb`, `pss_kb` (if the kernel
+-- provides `smaps_rollup`) and `lua_kb`. The Lua heap size of a web process
+-- is reported asynchronously: each call requests new sizes, and returns
+-- those reported since the previous call, so it is missing on the first
+-- call. Collection is cheap enough to be repeated every few seconds.
+--
+-- This function is not available on the web process.
+--
+-- @function luakit.memory_stats
+-- @treturn table Memory usage statistics.
 
 -- vim: et:sw=4:ts=8:sts=4:tw=80
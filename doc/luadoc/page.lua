@@ -74,4 +74,23 @@
 -- @tparam[opt] table options Additional arguments.
 -- @default `{}`
 
+--- Set the policy used to filter the `Referer` header of outgoing requests.
+--
+-- The policy is applied natively before the `send-request` signal is
+-- emitted, and is one of:
+--
+-- - `"default"`: leave the `Referer` header alone.
+-- - `"same-origin"`: only send the `Referer` header to the page's origin.
+-- - `"strict-origin"`: send only the page's origin, and nothing when
+--   navigating from HTTPS to HTTP.
+-- - `"origin-only"`: send only the page's origin.
+-- - `"none"`: never send the `Referer` header.
+--
+-- If `domain` is given, the policy applies only to pages on that domain and
+-- its subdomains; a `nil` policy removes such an override.
+--
+-- @function set_referer_policy
+-- @tparam string|nil policy The policy name.
+-- @tparam[opt] string domain The page domain the policy applies to.
+
 -- vim: et:sw=4:ts=8:sts=4:tw=80
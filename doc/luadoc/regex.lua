@@ -14,6 +14,68 @@
 --- @method match
 -- Scan a given string for a match.
 -- @tparam string string The string to scan for a match
+-- @tparam[opt] integer init The byte index to start searching at; negative
+-- values count from the end of the string.
+-- @tparam[opt] integer limit Only search the first `limit` bytes.
 -- @treturn boolean `true` if a match was found, `false` otherwise.
 
+--- @method exec
+-- Find the first match in a given string.
+--
+-- Like `string.find`, this returns the start and end indices of the match,
+-- followed by its capture groups. Capture groups that did not take part in
+-- the match are returned as `false`.
+--
+-- Searching again from the end of the previous match reuses the match state,
+-- so iterating over the matches in a string with `exec` does not allocate.
+--
+--     local reg = regex{ pattern = "(\\w+)=(\\w+)" }
+--     local s, e, key, value = reg:exec("a=b c=d", 4)
+--     assert(s == 5 and e == 7 and key == "c" and value == "d")
+--
+-- @tparam string string The string to scan for a match.
+-- @tparam[opt] integer init The byte index to start searching at; negative
+-- values count from the end of the string.
+-- @tparam[opt] integer limit Only search the first `limit` bytes.
+-- @treturn integer|nil The start index of the match, or `nil` if there was
+-- no match.
+-- @treturn integer The end index of the match.
+-- @treturn string... The capture groups of the match.
+
+--- @method gmatch
+-- Iterate over all matches in a given string, like `string.gmatch`.
+--
+-- Each iteration returns the capture groups of the match, or the whole match
+-- if the pattern has no capture groups.
+-- @tparam string string The string to scan for matches.
+-- @tparam[opt] integer init The byte index to start searching at.
+-- @tparam[opt] integer limit Only search the first `limit` bytes.
+-- @treturn function An iterator function.
+
+--- @method gsub
+-- Replace matches in a given string, like `string.gsub`.
+--
+-- If `repl` is a string, `%0` to `%9` are replaced with the whole match and
+-- its capture groups, and `%%` with a single `%`. If `repl` is a table, it
+-- is indexed with the first capture group; if it is a function, it is called
+-- with all capture groups. In both cases the whole match is used if the
+-- pattern has no capture groups, and a `false` or `nil` result keeps the
+-- original match.
+-- @tparam string string The string to replace matches in.
+-- @tparam string|table|function repl The replacement.
+-- @tparam[opt] integer n The maximum number of replacements.
+-- @tparam[opt] integer limit Only replace matches within the first `limit`
+-- bytes; the rest of the string is copied unchanged.
+-- @treturn string The resulting string.
+-- @treturn integer The number of replacements made.
+
+--- @method split
+-- Split a given string at each match.
+-- Empty matches at the start or end of a field do not split it.
+-- @tparam string string The string to split.
+-- @tparam[opt] integer max The maximum number of fields to return.
+-- @tparam[opt] integer limit Only split at matches within the first `limit`
+-- bytes; the rest of the string is part of the last field.
+-- @treturn table The list of fields.
+
 -- vim: et:sw=4:ts=8:sts=4:tw=80
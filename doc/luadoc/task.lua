@@ -0,0 +1,72 @@
+--- Time-sliced background tasks for Luakit.
+--
+-- DOCMACRO(available:both)
+--
+-- A task runs a Lua function as a coroutine, in small slices between the
+-- handling of input events and drawing. Use tasks for long jobs, such as
+-- parsing large files or cleaning up databases, that would otherwise block
+-- the user interface.
+--
+-- All tasks are run by a single scheduler. Each time the main loop is idle,
+-- runnable tasks are resumed in priority order for a few milliseconds in
+-- total; each task runs for at most its own budget per frame. Tasks are
+-- cooperative: they must call `task.yield()` regularly. It is cheap to
+-- call, and only yields once the task's budget for the frame is spent.
+--
+-- ### Example usage:
+--
+--     local t = luakit.task(function (task)
+--         for i, line in ipairs(lines) do
+--             parse(line)
+--             task.yield()
+--         end
+--         return #lines
+--     end, { priority = "low" })
+--
+--     t:add_signal("finished", function (_, count)
+--         print("parsed " .. count .. " lines")
+--     end)
+--
+-- @class task
+-- @copyright 2017 Aidan Holm
+
+--- @function luakit.task
+-- Start a new task.
+-- @tparam function func The function to run. It is called with the task as
+-- its only argument.
+-- @tparam[opt] table options The priority (`"high"`, `"default"` or `"low"`)
+-- and the `budget_ms` of the task.
+-- @treturn task The new task.
+
+--- @method yield
+-- Yield to the main loop if the task's budget for the frame is spent.
+-- Must be called from the task itself.
+
+--- @method sleep
+-- Suspend the task for at least the given time.
+-- Must be called from the task itself.
+-- @tparam number ms The time to sleep, in milliseconds.
+
+--- @method cancel
+-- Cancel the task. A running task is stopped the next time it yields or
+-- sleeps.
+-- @treturn boolean `true` if the task had not already ended.
+
+--- @property status
+-- The status of the task: `"pending"`, `"running"`, `"sleeping"`,
+-- `"finished"`, `"failed"` or `"cancelled"`.
+-- @type string
+-- @readonly
+
+--- @property priority
+-- The priority of the task.
+-- @type string
+-- @readonly
+
+--- @signal finished
+-- Emitted when the task ends, including when it fails or is cancelled.
+-- @tparam task task The task.
+-- @param ... The values returned by the task function, or the error
+-- message if it failed.
+
+-- vim: et:sw=4:ts=8:sts=4:tw=80
@@ -74,6 +74,11 @@
 -- 	    msg.info("The document height is %d pixels", ret)
 -- 	end })
 --
+-- Long scripts, such as libraries injected into many pages, are sent to
+-- each web process only once and are then referred to by content hash. The
+-- web process keeps them, so repeated evaluations of the same script don't
+-- need to copy or convert it again.
+--
 -- #### Calling options
 --
 -- The following keys can be set in the `options` argument:
@@ -120,6 +125,16 @@
 -- @treturn boolean? `false` if any problems have been found, `true` if no problems
 -- were found, and `nil` if the contents of the webview were not loaded over HTTPS.
 
+--- @method set_properties
+-- Set several webview properties at once.
+--
+-- Properties whose current value already equals the given value are skipped,
+-- and no `property::*` signal is emitted for them. This is cheaper than
+-- setting each property individually when most of them are unchanged.
+--
+-- @tparam table props A table of property names and values.
+-- @treturn number The number of properties that were changed.
+
 --- @method show_inspector
 -- Show the web inspector for the webview.
 
@@ -176,6 +191,41 @@
 -- @type string
 -- @readonly
 
+--- @signal load-status
+--
+-- Emitted when the load status of the webview changes.
+--
+-- For the `"provisional"`, `"redirected"`, `"committed"` and `"finished"`
+-- statuses, the second argument is a snapshot of the load state that is
+-- shared by all handlers of the transition. Reading from it is cheaper than
+-- reading the same webview properties in every handler. It has the
+-- following fields:
+--
+-- - `view`, `status`, `uri`, `title`: set when the snapshot is created.
+-- - `history`, `history_index`, `can_go_back`, `can_go_forward`,
+--   `certificate`, `ssl_trusted`, `tls_errors`: computed on first access,
+--   then cached in the snapshot.
+--
+-- The `"failed"` status instead passes the failing URI, an error message,
+-- and, for TLS errors, a list of certificate errors.
+--
+-- @tparam string status The new load status.
+-- @tparam table load The load snapshot.
+
+--- @signal key-press
+--
+-- Emitted when a key is pressed while the webview has focus.
+--
+-- The modifier table is cached and shared with every other key and button
+-- event that has the same modifiers, so handlers must not modify it; copy it
+-- first if a modified table is needed. The same applies to the modifier
+-- tables passed by the `button-press`, `button-release` and
+-- `button-double-click` signals, and by the input signals of other widgets.
+--
+-- @tparam table modifiers The active modifier keys.
+-- @tparam string key The name of the key.
+-- @treturn boolean `true` if the key press was handled.
+
 --- @signal scheme-request
 --
 -- Emitted when the webview attempts to load a URI on a custom URI scheme.
@@ -25,9 +25,53 @@
 #include "common/tokenize.h"
 #include "common/luauniq.h"
 
+#include <string.h>
+
 #define REG_KEY "luakit.uniq.registry.dom_document"
 
-static lua_class_t dom_document_class;
+/* Mutations are delivered in batches, at most once per animation frame */
+#define MUTATION_BATCH_INTERVAL 16
+
+typedef struct _mutation_watcher_t {
+    gchar *selector;
+    /* Watcher function, referenced in the document environment */
+    gpointer func;
+} mutation_watcher_t;
+
+
+/* A string in a template: literal parts, and ${name} parameters that are
+ * looked up in the parameter table when the template is built */
+typedef struct _template_part_t {
+    gchar *str;
+    gboolean param;
+} template_part_t;
+
+typedef struct _template_str_t {
+    guint n_parts;
+    template_part_t parts[0];
+} template_str_t;
+
+typedef struct _template_attr_t {
+    gchar *name;
+    template_str_t *value;
+} template_attr_t;
+
+typedef struct _template_node_t {
+    /* Tag name, or NULL for a text node */
+    gchar *tag;
+    /* Text content, or NULL */
+    template_str_t *text;
+    GArray *attrs;
+    GPtrArray *children;
+    /* Key under which the built element is returned, or NULL */
+    gchar *ref;
+} template_node_t;
+
+typedef struct _dom_template_t {
+    GPtrArray *roots;
+} dom_template_t;
+
+static lua_class_t dom_document_class, dom_template_class;
 
 LUA_OBJECT_FUNCS(dom_document_class, dom_document_t, dom_document);
 
@@ -40,11 +84,39 @@ luaH_check_dom_document(lua_State *L, gint udx)
     return document;
 }
 
+static void mutations_stop(dom_document_t *document);
+static gboolean mutations_flush(dom_document_t *document);
+
+static void
+mutation_watcher_free(mutation_watcher_t *watcher)
+{
+    g_free(watcher->selector);
+    g_slice_free(mutation_watcher_t, watcher);
+}
+
 static void
 webkit_dom_document_destroy_cb(dom_document_t *document, GObject *doc)
 {
+    lua_State *L = extension.WL;
+
+    /* The document is being finalized; don't remove its listeners */
     document->document = NULL;
-    luaH_uniq_del_ptr(extension.WL, REG_KEY, doc);
+    mutations_stop(document);
+
+    /* Release the watchers, which can never be called again */
+    if (document->watchers) {
+        if (luaH_uniq_get_ptr(L, REG_KEY, doc)) {
+            for (guint i = 0; i < document->watchers->len; i++) {
+                mutation_watcher_t *watcher = g_ptr_array_index(document->watchers, i);
+                luaH_object_unref_item(L, -1, watcher->func);
+            }
+            lua_pop(L, 1);
+        }
+        g_ptr_array_free(document->watchers, TRUE);
+        document->watchers = NULL;
+    }
+
+    luaH_uniq_del_ptr(L, REG_KEY, doc);
 }
 
 gint
@@ -90,6 +162,13 @@ luaH_dom_document_push_body(lua_State *L, dom_document_t *document)
     return luaH_dom_element_from_node(L, WEBKIT_DOM_ELEMENT(node));
 }
 
+static gint
+luaH_dom_document_push_active_element(lua_State *L, dom_document_t *document)
+{
+    WebKitDOMElement* node = webkit_dom_document_get_active_element(document->document);
+    return luaH_dom_element_from_node(L, node);
+}
+
 static gint
 luaH_dom_document_window_index(lua_State *L)
 {
@@ -172,6 +251,551 @@ luaH_dom_document_element_from_point(lua_State *L)
     return luaH_dom_element_from_node(L, elem);
 }
 
+/* Record an element in a mutation set. An element that is added and then
+ * removed within a batch is dropped, and one that is removed and added
+ * back is only reported as added */
+static void
+mutations_record(dom_document_t *document, GHashTable *set, WebKitDOMNode *node)
+{
+    if (!WEBKIT_DOM_IS_ELEMENT(node))
+        return;
+    if (set == document->removed && g_hash_table_remove(document->added, node))
+        return;
+    if (set == document->added)
+        g_hash_table_remove(document->removed, node);
+    if (!g_hash_table_contains(set, node))
+        g_hash_table_add(set, g_object_ref(node));
+    if (!document->flush_id)
+        document->flush_id = g_timeout_add(MUTATION_BATCH_INTERVAL,
+                (GSourceFunc)mutations_flush, document);
+}
+
+/* The parent of an inserted or removed node also gets a DOMSubtreeModified
+ * event, which isn't an attribute change */
+static void
+node_inserted_cb(WebKitDOMEventTarget *UNUSED(target), WebKitDOMEvent *event,
+        dom_document_t *document)
+{
+    WebKitDOMNode *node = WEBKIT_DOM_NODE(webkit_dom_event_get_target(event));
+    document->mutated_parent = webkit_dom_node_get_parent_node(node);
+    mutations_record(document, document->added, node);
+}
+
+static void
+node_removed_cb(WebKitDOMEventTarget *UNUSED(target), WebKitDOMEvent *event,
+        dom_document_t *document)
+{
+    WebKitDOMNode *node = WEBKIT_DOM_NODE(webkit_dom_event_get_target(event));
+    document->mutated_parent = webkit_dom_node_get_parent_node(node);
+    mutations_record(document, document->removed, node);
+}
+
+static void
+subtree_modified_cb(WebKitDOMEventTarget *UNUSED(target), WebKitDOMEvent *event,
+        dom_document_t *document)
+{
+    WebKitDOMNode *node = WEBKIT_DOM_NODE(webkit_dom_event_get_target(event));
+    if (node == document->mutated_parent)
+        document->mutated_parent = NULL;
+    else
+        mutations_record(document, document->changed, node);
+}
+
+static const struct {
+    const gchar *name;
+    GCallback cb;
+} mutation_events[] = {
+    { "DOMNodeInserted", G_CALLBACK(node_inserted_cb) },
+    { "DOMNodeRemoved", G_CALLBACK(node_removed_cb) },
+    { "DOMSubtreeModified", G_CALLBACK(subtree_modified_cb) },
+};
+
+static void
+mutations_start(dom_document_t *document)
+{
+    WebKitDOMEventTarget *target = WEBKIT_DOM_EVENT_TARGET(document->document);
+    for (guint i = 0; i < LENGTH(mutation_events); i++)
+        webkit_dom_event_target_add_event_listener(target, mutation_events[i].name,
+                mutation_events[i].cb, FALSE, document);
+
+    document->added = g_hash_table_new_full(g_direct_hash, g_direct_equal, g_object_unref, NULL);
+    document->removed = g_hash_table_new_full(g_direct_hash, g_direct_equal, g_object_unref, NULL);
+    document->changed = g_hash_table_new_full(g_direct_hash, g_direct_equal, g_object_unref, NULL);
+}
+
+/* Stop listening for mutation events, and drop any pending mutations */
+static void
+mutations_stop(dom_document_t *document)
+{
+    if (!document->added)
+        return;
+
+    if (document->document) {
+        WebKitDOMEventTarget *target = WEBKIT_DOM_EVENT_TARGET(document->document);
+        for (guint i = 0; i < LENGTH(mutation_events); i++)
+            webkit_dom_event_target_remove_event_listener(target, mutation_events[i].name,
+                    mutation_events[i].cb, FALSE);
+    }
+    if (document->flush_id)
+        g_source_remove(document->flush_id);
+    document->flush_id = 0;
+
+    g_hash_table_unref(document->added);
+    g_hash_table_unref(document->removed);
+    g_hash_table_unref(document->changed);
+    document->added = document->removed = document->changed = NULL;
+    document->mutated_parent = NULL;
+}
+
+static void
+mutations_add_element(lua_State *L, GHashTable *seen, WebKitDOMElement *elem)
+{
+    if (!g_hash_table_add(seen, elem))
+        return;
+    luaH_dom_element_from_node(L, elem);
+    lua_rawseti(L, -2, g_hash_table_size(seen));
+}
+
+/* Push an array of the elements in a mutation set matching a selector; if
+ * `descend` is true, matching descendants of the elements are included */
+static void
+mutations_push(lua_State *L, GHashTable *set, const gchar *selector, gboolean descend)
+{
+    GHashTable *seen = g_hash_table_new(g_direct_hash, g_direct_equal);
+    GHashTableIter iter;
+    WebKitDOMElement *elem;
+
+    lua_newtable(L);
+    g_hash_table_iter_init(&iter, set);
+    while (g_hash_table_iter_next(&iter, (gpointer*)&elem, NULL)) {
+        if (webkit_dom_element_webkit_matches_selector(elem, selector, NULL))
+            mutations_add_element(L, seen, elem);
+        if (!descend)
+            continue;
+        WebKitDOMNodeList *nodes = webkit_dom_element_query_selector_all(elem, selector, NULL);
+        if (!nodes)
+            continue;
+        gulong n = webkit_dom_node_list_get_length(nodes);
+        for (gulong i = 0; i < n; i++)
+            mutations_add_element(L, seen, WEBKIT_DOM_ELEMENT(webkit_dom_node_list_item(nodes, i)));
+        g_object_unref(nodes);
+    }
+    g_hash_table_unref(seen);
+}
+
+static gboolean
+mutations_flush(dom_document_t *document)
+{
+    lua_State *L = extension.WL;
+    gint top = lua_gettop(L);
+    document->flush_id = 0;
+
+    /* Take the current batch; watchers may cause further mutations */
+    GHashTable *added = document->added,
+               *removed = document->removed,
+               *changed = document->changed;
+    document->added = g_hash_table_new_full(g_direct_hash, g_direct_equal, g_object_unref, NULL);
+    document->removed = g_hash_table_new_full(g_direct_hash, g_direct_equal, g_object_unref, NULL);
+    document->changed = g_hash_table_new_full(g_direct_hash, g_direct_equal, g_object_unref, NULL);
+    document->mutated_parent = NULL;
+
+    /* Push all watchers first, since the list may change during the calls */
+    luaH_dom_document_from_webkit_dom_document(L, document->document);
+    guint n = document->watchers->len;
+    luaL_checkstack(L, 2*n + 5, "too many mutation watchers");
+    for (guint i = 0; i < n; i++) {
+        mutation_watcher_t *watcher = g_ptr_array_index(document->watchers, i);
+        luaH_object_push_item(L, top + 1, watcher->func);
+        lua_pushstring(L, watcher->selector);
+    }
+
+    for (guint i = 0; i < n; i++) {
+        const gchar *selector = lua_tostring(L, top + 3 + 2*i);
+        mutations_push(L, added, selector, TRUE);
+        mutations_push(L, removed, selector, TRUE);
+        mutations_push(L, changed, selector, FALSE);
+        if (lua_objlen(L, -3) || lua_objlen(L, -2) || lua_objlen(L, -1)) {
+            lua_pushvalue(L, top + 2 + 2*i);
+            luaH_dofunction(L, 3, 0);
+        } else
+            lua_pop(L, 3);
+    }
+
+    lua_settop(L, top);
+    g_hash_table_unref(added);
+    g_hash_table_unref(removed);
+    g_hash_table_unref(changed);
+    return FALSE;
+}
+
+static gint
+luaH_dom_document_watch_mutations(lua_State *L)
+{
+    dom_document_t *document = luaH_check_dom_document(L, 1);
+    const gchar *selector = luaL_checkstring(L, 2);
+    luaH_checkfunction(L, 3);
+
+    /* Validate the selector */
+    GError *error = NULL;
+    WebKitDOMElement *root = webkit_dom_document_get_document_element(document->document);
+    if (root) {
+        webkit_dom_element_webkit_matches_selector(root, selector, &error);
+        if (error) {
+            lua_pushfstring(L, "watch_mutations error: %s", error->message);
+            g_error_free(error);
+            return lua_error(L);
+        }
+    }
+
+    if (!document->watchers)
+        document->watchers = g_ptr_array_new_with_free_func((GDestroyNotify)mutation_watcher_free);
+    if (document->watchers->len == 0)
+        mutations_start(document);
+
+    mutation_watcher_t *watcher = g_slice_new(mutation_watcher_t);
+    watcher->selector = g_strdup(selector);
+    watcher->func = luaH_object_ref_item(L, 1, 3);
+    g_ptr_array_add(document->watchers, watcher);
+    return 0;
+}
+
+static gint
+luaH_dom_document_unwatch_mutations(lua_State *L)
+{
+    dom_document_t *document = luaH_check_dom_document(L, 1);
+    luaH_checkfunction(L, 2);
+    gpointer func = (gpointer)lua_topointer(L, 2);
+
+    for (guint i = 0; document->watchers && i < document->watchers->len; i++) {
+        mutation_watcher_t *watcher = g_ptr_array_index(document->watchers, i);
+        if (watcher->func != func)
+            continue;
+        luaH_object_unref_item(L, 1, watcher->func);
+        g_ptr_array_remove_index(document->watchers, i);
+        if (document->watchers->len == 0)
+            mutations_stop(document);
+        lua_pushboolean(L, TRUE);
+        return 1;
+    }
+
+    lua_pushboolean(L, FALSE);
+    return 1;
+}
+
+static void
+template_str_free(template_str_t *str)
+{
+    if (!str)
+        return;
+    for (guint i = 0; i < str->n_parts; i++)
+        g_free(str->parts[i].str);
+    g_free(str);
+}
+
+static void
+template_node_free(template_node_t *node)
+{
+    g_free(node->tag);
+    g_free(node->ref);
+    template_str_free(node->text);
+    for (guint i = 0; i < node->attrs->len; i++) {
+        template_attr_t *attr = &g_array_index(node->attrs, template_attr_t, i);
+        g_free(attr->name);
+        template_str_free(attr->value);
+    }
+    g_array_free(node->attrs, TRUE);
+    g_ptr_array_free(node->children, TRUE);
+    g_slice_free(template_node_t, node);
+}
+
+/* Split a string into literal parts and ${name} parameters */
+static template_str_t *
+template_str_parse(const gchar *s)
+{
+    GArray *parts = g_array_new(FALSE, FALSE, sizeof(template_part_t));
+    const gchar *start;
+
+    while ((start = strstr(s, "${"))) {
+        const gchar *end = strchr(start + 2, '}');
+        if (!end)
+            break;
+        if (start > s) {
+            template_part_t lit = { g_strndup(s, start - s), FALSE };
+            g_array_append_val(parts, lit);
+        }
+        template_part_t param = { g_strndup(start + 2, end - start - 2), TRUE };
+        g_array_append_val(parts, param);
+        s = end + 1;
+    }
+    if (*s || parts->len == 0) {
+        template_part_t lit = { g_strdup(s), FALSE };
+        g_array_append_val(parts, lit);
+    }
+
+    template_str_t *str = g_malloc(sizeof(*str) + parts->len * sizeof(template_part_t));
+    str->n_parts = parts->len;
+    memcpy(str->parts, parts->data, parts->len * sizeof(template_part_t));
+    g_array_free(parts, TRUE);
+    return str;
+}
+
+/* Expand a template string; the result is valid until the next expansion */
+static const gchar *
+template_str_expand(lua_State *L, template_str_t *str, gint params, GString *buf)
+{
+    if (str->n_parts == 1 && !str->parts[0].param)
+        return str->parts[0].str;
+
+    g_string_truncate(buf, 0);
+    for (guint i = 0; i < str->n_parts; i++) {
+        if (!str->parts[i].param) {
+            g_string_append(buf, str->parts[i].str);
+            continue;
+        }
+        if (!params)
+            continue;
+        lua_getfield(L, params, str->parts[i].str);
+        if (lua_isstring(L, -1))
+            g_string_append(buf, lua_tostring(L, -1));
+        lua_pop(L, 1);
+    }
+    return buf->str;
+}
+
+static const gchar *
+template_checkstring(lua_State *L, gint idx, const gchar *what)
+{
+    if (!lua_isstring(L, idx))
+        luaL_error(L, "build error: %s must be a string, got %s", what,
+                lua_typename(L, lua_type(L, idx)));
+    return lua_tostring(L, idx);
+}
+
+/* Compile the node spec at `idx`, and add it to `into`. Nodes are added
+ * before being filled in, so that nothing leaks if compilation fails */
+static void
+template_compile_node(lua_State *L, gint idx, GPtrArray *into)
+{
+    template_node_t *node = g_slice_new0(template_node_t);
+    node->attrs = g_array_new(FALSE, FALSE, sizeof(template_attr_t));
+    node->children = g_ptr_array_new_with_free_func((GDestroyNotify)template_node_free);
+    g_ptr_array_add(into, node);
+
+    if (!lua_istable(L, idx)) {
+        node->text = template_str_parse(template_checkstring(L, idx, "text node"));
+        return;
+    }
+
+    lua_rawgeti(L, idx, 1);
+    node->tag = g_strdup(template_checkstring(L, -1, "tag name"));
+    lua_pop(L, 1);
+
+    /* Attributes, text and ref */
+    lua_pushnil(L);
+    while (lua_next(L, idx)) {
+        if (lua_type(L, -2) == LUA_TSTRING) {
+            const gchar *key = lua_tostring(L, -2);
+            const gchar *value = template_checkstring(L, -1, key);
+            if (!strcmp(key, "text"))
+                node->text = template_str_parse(value);
+            else if (!strcmp(key, "ref"))
+                node->ref = g_strdup(value);
+            else {
+                template_attr_t attr = { g_strdup(key), template_str_parse(value) };
+                g_array_append_val(node->attrs, attr);
+            }
+        }
+        lua_pop(L, 1);
+    }
+
+    /* Children, in order */
+    gint n = lua_objlen(L, idx);
+    luaL_checkstack(L, 2, "template too deep");
+    for (gint i = 2; i <= n; i++) {
+        lua_rawgeti(L, idx, i);
+        template_compile_node(L, lua_gettop(L), node->children);
+        lua_pop(L, 1);
+    }
+}
+
+/* Compile the spec at `idx`, and push the template */
+static dom_template_t *
+template_compile(lua_State *L, gint idx)
+{
+    luaH_checktable(L, idx);
+    idx = luaH_absindex(L, idx);
+
+    dom_template_t *tpl = lua_newuserdata(L, sizeof(dom_template_t));
+    tpl->roots = g_ptr_array_new_with_free_func((GDestroyNotify)template_node_free);
+    luaH_settype(L, &dom_template_class);
+
+    /* A single element spec, or a list of node specs */
+    lua_rawgeti(L, idx, 1);
+    gboolean single = lua_type(L, -1) == LUA_TSTRING;
+    lua_pop(L, 1);
+
+    if (single)
+        template_compile_node(L, idx, tpl->roots);
+    else {
+        gint n = lua_objlen(L, idx);
+        for (gint i = 1; i <= n; i++) {
+            lua_rawgeti(L, idx, i);
+            template_compile_node(L, lua_gettop(L), tpl->roots);
+            lua_pop(L, 1);
+        }
+    }
+    return tpl;
+}
+
+static gint
+luaH_dom_template_gc(lua_State *L)
+{
+    dom_template_t *tpl = luaH_checkudata(L, 1, &dom_template_class);
+    g_ptr_array_free(tpl->roots, TRUE);
+    return 0;
+}
+
+static gint
+luaH_dom_document_compile(lua_State *L)
+{
+    luaH_check_dom_document(L, 1);
+    template_compile(L, 2);
+    return 1;
+}
+
+/* Build a node, and set the element in the refs table at `refs` if the node
+ * has a ref. Returns NULL and sets `error` on failure */
+static WebKitDOMNode *
+template_build_node(lua_State *L, WebKitDOMDocument *doc, template_node_t *node,
+        gint params, gint refs, GString *buf, GError **error)
+{
+    if (!node->tag) {
+        const gchar *text = template_str_expand(L, node->text, params, buf);
+        return WEBKIT_DOM_NODE(webkit_dom_document_create_text_node(doc, text));
+    }
+
+    WebKitDOMElement *elem = webkit_dom_document_create_element(doc, node->tag, error);
+    if (!elem)
+        return NULL;
+
+    for (guint i = 0; i < node->attrs->len; i++) {
+        template_attr_t *attr = &g_array_index(node->attrs, template_attr_t, i);
+        const gchar *value = template_str_expand(L, attr->value, params, buf);
+        webkit_dom_element_set_attribute(elem, attr->name, value, error);
+        if (*error)
+            return NULL;
+    }
+
+    if (node->text) {
+        const gchar *text = template_str_expand(L, node->text, params, buf);
+        WebKitDOMText *text_node = webkit_dom_document_create_text_node(doc, text);
+        webkit_dom_node_append_child(WEBKIT_DOM_NODE(elem), WEBKIT_DOM_NODE(text_node), error);
+        if (*error)
+            return NULL;
+    }
+
+    for (guint i = 0; i < node->children->len; i++) {
+        WebKitDOMNode *child = template_build_node(L, doc,
+                g_ptr_array_index(node->children, i), params, refs, buf, error);
+        if (!child)
+            return NULL;
+        webkit_dom_node_append_child(WEBKIT_DOM_NODE(elem), child, error);
+        if (*error)
+            return NULL;
+    }
+
+    if (node->ref) {
+        luaH_dom_element_from_node(L, elem);
+        lua_setfield(L, refs, node->ref);
+    }
+
+    return WEBKIT_DOM_NODE(elem);
+}
+
+/* Build all template roots into a fragment, and push the refs table */
+static gboolean
+template_build(lua_State *L, WebKitDOMDocument *doc, dom_template_t *tpl,
+        gint params, WebKitDOMDocumentFragment *fragment, GString *buf, GError **error)
+{
+    lua_newtable(L);
+    gint refs = lua_gettop(L);
+    for (guint i = 0; i < tpl->roots->len; i++) {
+        WebKitDOMNode *node = template_build_node(L, doc,
+                g_ptr_array_index(tpl->roots, i), params, refs, buf, error);
+        if (!node)
+            return FALSE;
+        webkit_dom_node_append_child(WEBKIT_DOM_NODE(fragment), node, error);
+        if (*error)
+            return FALSE;
+    }
+    return TRUE;
+}
+
+static gint
+luaH_dom_document_build(lua_State *L)
+{
+    dom_document_t *document = luaH_check_dom_document(L, 1);
+    lua_settop(L, 4);
+
+    /* Compile table specs on the fly */
+    dom_template_t *tpl = luaH_toudata(L, 2, &dom_template_class);
+    if (!tpl) {
+        tpl = template_compile(L, 2);
+        lua_replace(L, 2);
+    }
+
+    if (!lua_isnil(L, 3))
+        luaH_checktable(L, 3);
+
+    dom_element_t *parent = NULL;
+    if (!lua_isnil(L, 4)) {
+        parent = luaH_to_dom_element(L, 4);
+        if (!parent || !parent->element)
+            luaL_argerror(L, 4, "DOM element expected");
+    }
+
+    WebKitDOMDocument *doc = document->document;
+    WebKitDOMDocumentFragment *fragment = webkit_dom_document_create_document_fragment(doc);
+    GString *buf = g_string_new(NULL);
+    GError *error = NULL;
+    gboolean ok = TRUE;
+
+    /* A list of parameter tables builds the template once for each */
+    gboolean list = FALSE;
+    if (!lua_isnil(L, 3)) {
+        lua_rawgeti(L, 3, 1);
+        list = lua_istable(L, -1);
+        lua_pop(L, 1);
+    }
+
+    if (list) {
+        gint n = lua_objlen(L, 3);
+        lua_createtable(L, n, 0);
+        for (gint i = 1; ok && i <= n; i++) {
+            lua_rawgeti(L, 3, i);
+            ok = template_build(L, doc, tpl, lua_gettop(L), fragment, buf, &error);
+            lua_rawseti(L, 5, i);
+            lua_pop(L, 1);
+        }
+    } else
+        ok = template_build(L, doc, tpl, lua_isnil(L, 3) ? 0 : 3, fragment, buf, &error);
+
+    g_string_free(buf, TRUE);
+
+    /* Insert the whole subtree into the document at once */
+    if (ok && parent)
+        webkit_dom_node_append_child(WEBKIT_DOM_NODE(parent->element),
+                WEBKIT_DOM_NODE(fragment), &error);
+
+    if (error) {
+        lua_pushfstring(L, "build error: %s", error->message);
+        g_error_free(error);
+        return lua_error(L);
+    }
+
+    return 1;
+}
+
 static gint
 luaH_dom_document_index(lua_State *L)
 {
@@ -182,7 +806,12 @@ luaH_dom_document_index(lua_State *L)
     switch(token) {
         PF_CASE(CREATE_ELEMENT, luaH_dom_document_create_element);
         PF_CASE(ELEMENT_FROM_POINT, luaH_dom_document_element_from_point);
+        PF_CASE(WATCH_MUTATIONS, luaH_dom_document_watch_mutations);
+        PF_CASE(BUILD, luaH_dom_document_build);
+        PF_CASE(COMPILE, luaH_dom_document_compile);
+        PF_CASE(UNWATCH_MUTATIONS, luaH_dom_document_unwatch_mutations);
         case L_TK_BODY: return luaH_dom_document_push_body(L, document);
+        case L_TK_ACTIVE_ELEMENT: return luaH_dom_document_push_active_element(L, document);
         case L_TK_WINDOW: return luaH_dom_document_push_window_table(L);
         default:
             return 0;
@@ -213,6 +842,15 @@ dom_document_class_setup(lua_State *L)
             dom_document_methods, dom_document_meta);
 
     luaH_uniq_setup(L, REG_KEY, "");
+
+    static const struct luaL_reg dom_template_meta[] =
+    {
+        { "__gc", luaH_dom_template_gc },
+        { NULL, NULL },
+    };
+
+    luaH_class_setup(L, &dom_template_class, "dom_document::template",
+            NULL, NULL, NULL, NULL, dom_template_meta);
 }
 
 // vim: ft=c:et:sw=4:ts=8:sts=4:tw=80
@@ -30,6 +30,16 @@
 typedef struct _dom_document_t {
     LUA_OBJECT_HEADER
     WebKitDOMDocument *document;
+
+    /* Mutation watchers; mutation events are only listened for while
+     * there is at least one */
+    GPtrArray *watchers;
+    /* Elements added, removed and changed since the last batch */
+    GHashTable *added, *removed, *changed;
+    /* Parent of the last inserted or removed node */
+    WebKitDOMNode *mutated_parent;
+    /* Source that delivers the next batch */
+    guint flush_id;
 } dom_document_t;
 
 void dom_document_class_setup(lua_State *);
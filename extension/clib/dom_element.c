@@ -267,6 +267,10 @@ luaH_dom_element_attribute_newindex(lua_State *L)
 {
     dom_element_t *element = luaH_check_dom_element(L, lua_upvalueindex(1));
     const gchar *attr = luaL_checkstring(L, 2);
+    if (lua_isnil(L, 3)) {
+        webkit_dom_element_remove_attribute(element->element, attr);
+        return 0;
+    }
     const gchar *value = luaL_checkstring(L, 3);
     GError *error = NULL;
     webkit_dom_element_set_attribute(element->element, attr, value, &error);
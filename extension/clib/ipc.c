@@ -22,53 +22,74 @@
 #include "common/clib/ipc.h"
 #include "common/luaserialize.h"
 
-#define REG_KEY "luakit.registry.ipc_channel"
-
 gint
 ipc_channel_send(lua_State *L)
 {
     ipc_channel_t *ipc_channel = luaH_check_ipc_channel(L, 1);
     luaL_checkstring(L, 2);
-    lua_pushstring(L, ipc_channel->name);
-    ipc_send_lua(extension.ipc, IPC_TYPE_lua_ipc, L, 2, lua_gettop(L));
+
+    /* Replace the channel and signal names with interned ids if possible */
+    gint top = lua_gettop(L);
+    luaL_checkstack(L, top + 1, "too many arguments");
+    ipc_channel_push_name(L, extension.ipc, lua_tostring(L, 2));
+    for (gint i = 3; i <= top; i++)
+        lua_pushvalue(L, i);
+    ipc_channel_push_name(L, extension.ipc, ipc_channel->name);
+
+    ipc_send_lua(extension.ipc, IPC_TYPE_lua_ipc, L, top + 1, lua_gettop(L));
     return 0;
 }
 
+gint
+ipc_channel_call(lua_State *L)
+{
+    luaH_check_ipc_channel(L, 1);
+    page_t *page = luaH_check_page(L, 2);
+    lua_remove(L, 2);
+    return ipc_channel_call_to(L, extension.ipc, page->id);
+}
+
+/* Push the page a call was made for, or nil */
 void
-ipc_channel_recv(lua_State *L, const gchar *arg, guint arglen)
+luaH_ipc_channel_push_page(lua_State *L, guint64 page_id)
+{
+    WebKitWebPage *web_page = page_id ?
+        webkit_web_extension_get_page(extension.ext, page_id) : NULL;
+    luaH_page_from_web_page(L, web_page);
+}
+
+void
+ipc_channel_recv(lua_State *L, ipc_endpoint_t *ipc, const gchar *arg, guint arglen)
 {
     gint top = lua_gettop(L);
     int n = lua_deserialize_range(L, (guint8*)arg, arglen);
 
-    /* Remove signal name, module_name and page_id from the stack */
-    const char *signame = lua_tostring(L, -n);
-    lua_remove(L, -n);
-    const char *module_name = lua_tostring(L, -2);
+    /* Stack: signal name, arguments..., channel name, page_id */
+    const gchar *signame = ipc_channel_get_name(L, ipc, top + 1);
     guint64 page_id = lua_tointeger(L, -1);
-    lua_pop(L, 2);
-    n -= 3;
+    lua_pop(L, 1);
+
+    /* Replace the channel name with the channel object */
+    luaH_ipc_channel_push(L, ipc, -1);
+    lua_replace(L, -2);
+    if (!signame || lua_isnil(L, -1)) {
+        lua_settop(L, top);
+        return;
+    }
+
+    /* Move the channel before the arguments */
+    lua_insert(L, top + 2);
 
-    /* Prepend the page object, or nil */
+    /* Prepend the page object, or nil, to the arguments */
     if (page_id) {
         WebKitWebPage *web_page = webkit_web_extension_get_page(extension.ext, page_id);
         luaH_page_from_web_page(L, web_page);
     } else
         lua_pushnil(L);
-    lua_insert(L, -n-1);
-    n++;
+    lua_insert(L, top + 3);
 
-    /* Push the right module object onto the stack */
-    lua_pushstring(L, REG_KEY);
-    lua_rawget(L, LUA_REGISTRYINDEX);
-    lua_pushstring(L, module_name);
-    lua_rawget(L, -2);
-    lua_remove(L, -2);
-
-    /* Move the module before arguments, and emit signal */
-    if (!lua_isnil(L, -1)) {
-        lua_insert(L, -n-1);
-        luaH_object_emit_signal(L, -n-1, signame, n, 0);
-    }
+    /* The signal name stays on the stack until the emission is done */
+    luaH_object_emit_signal(L, top + 2, signame, n-2, 0);
     lua_settop(L, top);
 }
 
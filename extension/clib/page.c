@@ -23,15 +23,43 @@
 #include "common/luautil.h"
 #include "common/luauniq.h"
 #include "common/luajs.h"
+#include "common/clib/ipc.h"
 #include "luah.h"
 
+#include <string.h>
+
 #define REG_KEY "luakit.uniq.registry.page"
+#define JS_FUNC_CACHE_REG_KEY "luakit.registry.page.js_func_cache"
 
-static lua_class_t page_class;
+static lua_class_t page_class, page_js_func_class;
 
 LUA_OBJECT_FUNCS(page_class, page_t, page);
 
-static page_t*
+static const gchar *referer_policy_names[] = {
+    "default", "same-origin", "strict-origin", "origin-only", "none", NULL
+};
+
+/* Referer policy configuration; domain overrides are keyed by domain name */
+static referer_policy_t referer_default_policy = REFERER_POLICY_DEFAULT;
+static GHashTable *referer_domain_policies;
+/* Bumped whenever the configuration changes, to invalidate page caches */
+static guint referer_generation = 1;
+
+/* A JavaScript function compiled by wrap_js(). The function is protected
+ * from the JavaScript garbage collector until its Lua userdata is collected */
+typedef struct _page_js_func_t {
+    JSGlobalContextRef ctx;
+    JSObjectRef func;
+} page_js_func_t;
+
+/* Each time a page's main frame window object is cleared, the page is given
+ * a new generation from this counter. wrap_js() cache keys include it, so
+ * functions compiled for the old window are never reused, and other pages'
+ * cached functions are unaffected */
+#define JS_FUNC_GENERATION_KEY "luakit-js-func-generation"
+static guint js_func_generation;
+
+page_t*
 luaH_check_page(lua_State *L, gint udx)
 {
     page_t *page = luaH_checkudata(L, udx, &page_class);
@@ -40,14 +68,105 @@ luaH_check_page(lua_State *L, gint udx)
     return page;
 }
 
+/* Recompute the cached page origin and referer policy, if stale */
+static void
+page_update_referer_policy(page_t *page)
+{
+    if (page->referer_generation == referer_generation)
+        return;
+    page->referer_generation = referer_generation;
+
+    if (page->origin)
+        soup_uri_free(page->origin);
+    g_free(page->origin_str);
+    page->origin_str = NULL;
+
+    const gchar *uri = webkit_web_page_get_uri(page->page);
+    page->origin = uri ? soup_uri_new(uri) : NULL;
+    page->referer_policy = referer_default_policy;
+
+    if (!page->origin || !page->origin->host)
+        return;
+
+    SoupURI *o = page->origin;
+    if (soup_uri_uses_default_port(o))
+        page->origin_str = g_strdup_printf("%s://%s/", o->scheme, o->host);
+    else
+        page->origin_str = g_strdup_printf("%s://%s:%u/", o->scheme, o->host, o->port);
+
+    if (!referer_domain_policies)
+        return;
+
+    /* Check the page host, then each of its parent domains */
+    for (const gchar *domain = o->host; domain; domain = strchr(domain, '.')) {
+        if (*domain == '.')
+            domain++;
+        gpointer policy;
+        if (g_hash_table_lookup_extended(referer_domain_policies, domain, NULL, &policy)) {
+            page->referer_policy = GPOINTER_TO_INT(policy);
+            return;
+        }
+    }
+}
+
+static void
+page_apply_referer_policy(page_t *page, const gchar *uri, SoupMessageHeaders *hdrs)
+{
+    if (!soup_message_headers_get_one(hdrs, "Referer"))
+        return;
+
+    page_update_referer_policy(page);
+    if (page->referer_policy == REFERER_POLICY_DEFAULT)
+        return;
+
+    SoupURI *o = page->origin, *target = NULL;
+    gboolean keep = FALSE, origin_only = FALSE;
+
+    if (o && page->origin_str) {
+        switch (page->referer_policy) {
+            case REFERER_POLICY_SAME_ORIGIN:
+                target = soup_uri_new(uri);
+                keep = target && target->scheme == o->scheme
+                    && target->port == o->port && !g_strcmp0(target->host, o->host);
+                break;
+            case REFERER_POLICY_STRICT_ORIGIN:
+                /* Never send a Referer on a HTTPS -> HTTP downgrade */
+                target = soup_uri_new(uri);
+                keep = origin_only = target && (o->scheme != SOUP_URI_SCHEME_HTTPS
+                        || target->scheme == SOUP_URI_SCHEME_HTTPS);
+                break;
+            case REFERER_POLICY_ORIGIN_ONLY:
+                keep = origin_only = TRUE;
+                break;
+            default:
+                break;
+        }
+    }
+
+    if (!keep)
+        soup_message_headers_remove(hdrs, "Referer");
+    else if (origin_only)
+        soup_message_headers_replace(hdrs, "Referer", page->origin_str);
+
+    if (target)
+        soup_uri_free(target);
+}
+
 static gboolean
 send_request_cb(WebKitWebPage *web_page, WebKitURIRequest *request,
-        WebKitURIResponse *UNUSED(redirected_response), page_t *UNUSED(page))
+        WebKitURIResponse *UNUSED(redirected_response), page_t *page)
 {
     lua_State *L = extension.WL;
     const gchar *uri = webkit_uri_request_get_uri(request);
     SoupMessageHeaders *hdrs = webkit_uri_request_get_http_headers(request);
 
+    if (hdrs)
+        page_apply_referer_policy(page, uri, hdrs);
+
+    /* Don't bother building the headers table if nobody is listening */
+    if (!signal_lookup(page->signals, "send-request"))
+        return FALSE;
+
     int top = lua_gettop(L);
 
     /* Build headers table */
@@ -135,20 +254,29 @@ luaH_page_eval_js(lua_State *L)
         lua_settop(L, top);
     }
 
-    source = source ?: luaH_callerinfo(L);
-
     WebKitFrame *frame = webkit_web_page_get_main_frame(page->page);
     WebKitScriptWorld *world = extension.script_world;
     JSGlobalContextRef ctx = webkit_frame_get_javascript_context_for_script_world(frame, world);
-    return luaJS_eval_js(extension.WL, ctx, script, source, false);
+    gint n = luaJS_eval_js(L, ctx, script, source, false);
+
+    /* Only look up the caller when there is an error to report */
+    if (!source && n == 2 && lua_isnil(L, -2)) {
+        gchar *origin = luaH_callerinfo(L);
+        if (origin) {
+            lua_pushfstring(L, "%s: %s", origin, lua_tostring(L, -1));
+            lua_replace(L, -2);
+            g_free(origin);
+        }
+    }
+    return n;
 }
 
 static gint
 luaH_page_js_func(lua_State *L)
 {
-    const void *ctx = lua_topointer(L, lua_upvalueindex(1));
-    const void *func = lua_topointer(L, lua_upvalueindex(2));
-    page_t *page = luaH_check_page(L, lua_upvalueindex(3));
+    page_js_func_t *f = luaH_checkudata(L, lua_upvalueindex(1), &page_js_func_class);
+    page_t *page = luaH_check_page(L, lua_upvalueindex(2));
+    JSContextRef ctx = f->ctx;
 
     gint argc = lua_gettop(L);
     JSValueRef *args = argc > 0 ? g_alloca(sizeof(*args)*argc) : NULL;
@@ -164,11 +292,42 @@ luaH_page_js_func(lua_State *L)
     }
 
     /* Call the function */
-    JSValueRef ret = JSObjectCallAsFunction(ctx, (JSObjectRef)func, NULL, argc, args, NULL);
+    JSValueRef ret = JSObjectCallAsFunction(ctx, f->func, NULL, argc, args, NULL);
     luaJS_pushvalue(L, ctx, ret, NULL);
     return 1;
 }
 
+static gint
+luaH_page_js_func_gc(lua_State *L)
+{
+    page_js_func_t *f = luaH_checkudata(L, 1, &page_js_func_class);
+    JSValueUnprotect(f->ctx, f->func);
+    JSGlobalContextRelease(f->ctx);
+    return 0;
+}
+
+/* Push the wrap_js() cache table. Values are weak, so entries are dropped
+ * once their closures are collected */
+static void
+luaH_page_js_func_cache_push(lua_State *L)
+{
+    lua_pushliteral(L, JS_FUNC_CACHE_REG_KEY);
+    lua_rawget(L, LUA_REGISTRYINDEX);
+    if (!lua_isnil(L, -1))
+        return;
+    lua_pop(L, 1);
+
+    lua_newtable(L);
+    lua_createtable(L, 0, 1);
+    lua_pushliteral(L, "__mode");
+    lua_pushliteral(L, "v");
+    lua_rawset(L, -3);
+    lua_setmetatable(L, -2);
+    lua_pushliteral(L, JS_FUNC_CACHE_REG_KEY);
+    lua_pushvalue(L, -2);
+    lua_rawset(L, LUA_REGISTRYINDEX);
+}
+
 static gint
 luaH_page_wrap_js(lua_State *L)
 {
@@ -182,36 +341,124 @@ luaH_page_wrap_js(lua_State *L)
     WebKitScriptWorld *world = extension.script_world;
     JSGlobalContextRef ctx = webkit_frame_get_javascript_context_for_script_world(frame, world);
 
+    /* Compiled functions are cached by page, window generation, argument
+     * names and script */
+    int argc = lua_objlen(L, 3);
+    for (int i = 1; i <= argc; i++) {
+        lua_rawgeti(L, 3, i);
+        luaL_checktype(L, -1, LUA_TSTRING);
+        lua_pop(L, 1);
+    }
+    GString *key = g_string_sized_new(64);
+    guint generation = GPOINTER_TO_UINT(g_object_get_data(G_OBJECT(page->page),
+                JS_FUNC_GENERATION_KEY));
+    g_string_printf(key, "%" G_GUINT64_FORMAT ":%u", page->id, generation);
+    for (int i = 1; i <= argc; i++) {
+        lua_rawgeti(L, 3, i);
+        g_string_append_c(key, ',');
+        g_string_append(key, lua_tostring(L, -1));
+        lua_pop(L, 1);
+    }
+    g_string_append_c(key, '\n');
+    g_string_append(key, script);
+
+    luaH_page_js_func_cache_push(L);
+    lua_pushlstring(L, key->str, key->len);
+    g_string_free(key, TRUE);
+    lua_pushvalue(L, -1);
+    lua_rawget(L, -3);
+    if (!lua_isnil(L, -1))
+        return 1;
+    lua_pop(L, 1);
+
     /* Construct argument names array */
-    int argc = lua_objlen(L, 3), i = 0;
     JSStringRef *args = argc > 0 ? g_alloca(sizeof(*args)*argc) : NULL;
-
-    /* {}, index, tbl val */
-    if (argc > 0) {
-        while (lua_pushnumber(L, ++i), lua_rawget(L, -2), !lua_isnil(L, -1)) {
-            luaL_checktype(L, -1, LUA_TSTRING);
-            const char *name = lua_tostring(L, -1);
-            args[i-1] = JSStringCreateWithUTF8CString(name);
-            lua_pop(L, 1);
-        }
+    for (int i = 0; i < argc; i++) {
+        lua_rawgeti(L, 3, i+1);
+        args[i] = JSStringCreateWithUTF8CString(lua_tostring(L, -1));
+        lua_pop(L, 1);
     }
 
     /* Convert script to a JS function */
     JSStringRef body = JSStringCreateWithUTF8CString(script);
     JSObjectRef func = JSObjectMakeFunction(ctx, NULL, argc, args, body, NULL, 1, NULL);
+    JSStringRelease(body);
+    for (int i = 0; i < argc; i++)
+        JSStringRelease(args[i]);
+
+    if (!func)
+        return luaL_error(L, "unable to compile JavaScript function");
+
+    page_js_func_t *f = lua_newuserdata(L, sizeof(page_js_func_t));
+    f->ctx = JSGlobalContextRetain(ctx);
+    f->func = func;
+    JSValueProtect(ctx, func);
+    luaH_settype(L, &page_js_func_class);
 
-    lua_pushlightuserdata(L, ctx);
-    lua_pushlightuserdata(L, func);
     lua_pushvalue(L, 1);
-    lua_pushcclosure(L, luaH_page_js_func, 3);
+    lua_pushcclosure(L, luaH_page_js_func, 2);
 
+    /* cache[key] = closure */
+    lua_pushvalue(L, -2);
+    lua_pushvalue(L, -2);
+    lua_rawset(L, -5);
     return 1;
 }
 
+void
+page_window_object_cleared_cb(WebKitScriptWorld *UNUSED(world),
+        WebKitWebPage *web_page, WebKitFrame *frame, gpointer UNUSED(data))
+{
+    /* Functions compiled for the old window must not be reused */
+    if (webkit_frame_is_main_frame(frame))
+        g_object_set_data(G_OBJECT(web_page), JS_FUNC_GENERATION_KEY,
+                GUINT_TO_POINTER(++js_func_generation));
+}
+
+static void
+page_uri_changed_cb(WebKitWebPage *UNUSED(web_page), GParamSpec *UNUSED(ps), page_t *page)
+{
+    page->referer_generation = 0;
+}
+
+/* Set the default referer policy, or the policy for a domain and all of its
+ * subdomains. Passing nil as the policy removes a domain override. */
+static gint
+luaH_page_set_referer_policy(lua_State *L)
+{
+    const gchar *domain = luaL_optstring(L, 2, NULL);
+
+    if (!domain) {
+        referer_default_policy = luaL_checkoption(L, 1, NULL, referer_policy_names);
+    } else {
+        if (!referer_domain_policies)
+            referer_domain_policies = g_hash_table_new_full(g_str_hash,
+                    g_str_equal, g_free, NULL);
+        gchar *key = g_ascii_strdown(domain, -1);
+        if (lua_isnil(L, 1))
+            g_hash_table_remove(referer_domain_policies, key);
+        else {
+            referer_policy_t policy = luaL_checkoption(L, 1, NULL, referer_policy_names);
+            g_hash_table_replace(referer_domain_policies, key, GINT_TO_POINTER(policy));
+            key = NULL;
+        }
+        g_free(key);
+    }
+
+    referer_generation++;
+    return 0;
+}
+
 static void
 webkit_web_page_destroy_cb(page_t *page, GObject *web_page)
 {
     page->page = NULL;
+    ipc_channel_cancel_calls(page->id);
+    if (page->origin)
+        soup_uri_free(page->origin);
+    page->origin = NULL;
+    g_free(page->origin_str);
+    page->origin_str = NULL;
     luaH_uniq_del_ptr(extension.WL, REG_KEY, web_page);
 }
 
@@ -228,9 +475,11 @@ luaH_page_from_web_page(lua_State *L, WebKitWebPage *web_page)
 
     page_t *page = page_new(L);
     page->page = web_page;
+    page->id = webkit_web_page_get_id(web_page);
 
     g_signal_connect(page->page, "send-request", G_CALLBACK(send_request_cb), page);
     g_signal_connect(page->page, "document-loaded", G_CALLBACK(document_loaded_cb), page);
+    g_signal_connect(page->page, "notify::uri", G_CALLBACK(page_uri_changed_cb), page);
 
     luaH_uniq_add_ptr(L, REG_KEY, web_page, -1);
     g_object_weak_ref(G_OBJECT(web_page), (GWeakNotify)webkit_web_page_destroy_cb, page);
@@ -274,6 +523,7 @@ page_class_setup(lua_State *L)
     {
         LUA_CLASS_METHODS(page)
         { "__call", luaH_page_new },
+        { "set_referer_policy", luaH_page_set_referer_policy },
         { NULL, NULL }
     };
 
@@ -291,6 +541,15 @@ page_class_setup(lua_State *L)
             page_methods, page_meta);
 
     luaH_uniq_setup(L, REG_KEY, "");
+
+    static const struct luaL_reg page_js_func_meta[] =
+    {
+        { "__gc", luaH_page_js_func_gc },
+        { NULL, NULL },
+    };
+
+    luaH_class_setup(L, &page_js_func_class, "page::js_function",
+            NULL, NULL, NULL, NULL, page_js_func_meta);
 }
 
 // vim: ft=c:et:sw=4:ts=8:sts=4:tw=80
@@ -27,15 +27,35 @@
 
 #include <gtk/gtk.h>
 
+typedef enum {
+    REFERER_POLICY_DEFAULT,
+    REFERER_POLICY_SAME_ORIGIN,
+    REFERER_POLICY_STRICT_ORIGIN,
+    REFERER_POLICY_ORIGIN_ONLY,
+    REFERER_POLICY_NONE,
+} referer_policy_t;
+
 typedef struct _page_t {
     LUA_OBJECT_HEADER
     WebKitWebPage *page;
+    /* Page id; still valid after the web page is destroyed */
+    guint64 id;
     /* Lua object ref */
     gpointer ref;
+
+    /* Parsed page URI and its serialized origin, for Referer filtering */
+    SoupURI *origin;
+    gchar *origin_str;
+    /* Referer policy that applies to the current page URI */
+    referer_policy_t referer_policy;
+    /* Referer configuration generation the above fields were computed for */
+    guint referer_generation;
 } page_t;
 
 void page_class_setup(lua_State *);
 gint luaH_page_from_web_page(lua_State *L, WebKitWebPage *web_page);
+page_t *luaH_check_page(lua_State *L, gint udx);
+void page_window_object_cleared_cb(WebKitScriptWorld *, WebKitWebPage *, WebKitFrame *, gpointer);
 
 #endif
 
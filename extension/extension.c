@@ -37,8 +37,11 @@
 #include "common/clib/msg.h"
 #include "common/clib/ipc.h"
 #include "common/clib/timer.h"
+#include "common/clib/gc.h"
+#include "common/clib/task.h"
 #include "common/clib/regex.h"
 #include "common/common.h"
+#include "common/trace.h"
 
 #include "extension/scroll.h"
 #include "extension/luajs.h"
@@ -59,10 +62,13 @@ web_lua_init(void)
     luaH_object_setup(WL);
     luaH_uniq_setup(WL, NULL, "v");
     luaH_add_paths(WL, NULL);
+    trace_lua_setup(WL);
     luakit_lib_setup(WL);
     soup_lib_setup(WL);
     ipc_channel_class_setup(WL);
     timer_class_setup(WL);
+    task_class_setup(WL);
+    gc_scheduler_setup(WL);
     regex_class_setup(WL);
     dom_document_class_setup(WL);
     dom_element_class_setup(WL);
@@ -76,7 +82,13 @@ web_lua_init(void)
 G_MODULE_EXPORT void
 webkit_web_extension_initialize_with_user_data(WebKitWebExtension *ext, GVariant *payload)
 {
-    const gchar *socket_path = g_variant_get_string(payload, NULL);
+    const gchar *socket_path;
+    gboolean trace;
+    g_variant_get(payload, "(&sb)", &socket_path, &trace);
+
+    if (trace)
+        trace_init("Web", NULL);
+    gint64 start = trace_begin();
 
     extension.WL = luaL_newstate();
     common.L = extension.WL;
@@ -87,11 +99,14 @@ webkit_web_extension_initialize_with_user_data(WebKitWebExtension *ext, GVariant
         debug("luakit web process: connecting to UI thread failed");
         exit(EXIT_FAILURE);
     }
+    trace_end(start, "startup", "connect");
 
+    start = trace_begin();
     web_lua_init();
     web_scroll_init();
     web_luajs_init();
     web_script_world_init();
+    trace_end(start, "startup", "web_lua_init");
 
     debug("luakit web process: PID %d", getpid());
     debug("luakit web process: ready for messages");
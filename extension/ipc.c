@@ -23,6 +23,7 @@
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <sys/un.h>
+#include <unistd.h>
 
 #include "extension/extension.h"
 #include "extension/clib/extension.h"
@@ -32,6 +33,7 @@
 #include "common/luajs.h"
 #include "common/luaserialize.h"
 #include "common/clib/ipc.h"
+#include "common/trace.h"
 
 static GPtrArray *queued_page_ipc;
 
@@ -42,22 +44,39 @@ ipc_recv_lua_require_module(ipc_endpoint_t *UNUSED(ipc), const ipc_lua_require_m
     assert(strlen(module_name) > 0);
     assert(strlen(module_name) == length-1);
 
+    gint64 start = trace_begin();
     lua_pushstring(extension.WL, module_name);
     lua_getglobal(extension.WL, "require");
     luaH_dofunction(extension.WL, 1, 0);
+    trace_end(start, "web_module", module_name);
 }
 
 void
-ipc_recv_lua_ipc(ipc_endpoint_t *UNUSED(ipc), const ipc_lua_ipc_t *msg, guint length)
+ipc_recv_lua_ipc(ipc_endpoint_t *ipc, const ipc_lua_ipc_t *msg, guint length)
 {
-    ipc_channel_recv(extension.WL, msg->arg, length);
+    ipc_channel_recv(extension.WL, ipc, msg->arg, length);
 }
 
 void
-ipc_recv_extension_init(ipc_endpoint_t *UNUSED(ipc), gpointer UNUSED(msg), guint UNUSED(length))
+ipc_recv_lua_ipc_call(ipc_endpoint_t *ipc, const ipc_lua_ipc_t *msg, guint length)
+{
+    ipc_channel_recv_call(extension.WL, ipc, msg->arg, length);
+}
+
+void
+ipc_recv_lua_ipc_reply(ipc_endpoint_t *ipc, const ipc_lua_ipc_t *msg, guint length)
+{
+    ipc_channel_recv_reply(extension.WL, ipc, msg->arg, length);
+}
+
+void
+ipc_recv_extension_init(ipc_endpoint_t *ipc, gpointer UNUSED(msg), guint UNUSED(length))
 {
     emit_pending_page_creation_ipc();
     extension_class_emit_pending_signals(extension.WL);
+
+    /* Startup is complete; hand recorded events over to the UI process */
+    trace_send(ipc);
 }
 
 void
@@ -76,34 +95,70 @@ ipc_recv_scroll(ipc_endpoint_t *UNUSED(ipc), const guint8 *msg, guint length)
     lua_pop(L, 3);
 }
 
+/** Scripts registered by the UI process, by content hash. The converted
+ * script strings are kept for the lifetime of the web process, so each is
+ * converted once, and JSC sees the same source on every evaluation */
+static GHashTable *scripts;
+
+void
+ipc_recv_script(ipc_endpoint_t *UNUSED(ipc), const ipc_script_t *msg, guint length)
+{
+    g_assert(length > sizeof(*msg));
+    g_assert(msg->hash[IPC_SCRIPT_HASH_LEN] == '\0');
+
+    if (!scripts)
+        scripts = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+                (GDestroyNotify)JSStringRelease);
+    g_hash_table_insert(scripts, g_strdup(msg->hash),
+            JSStringCreateWithUTF8CString(msg->source));
+}
+
 void
 ipc_recv_eval_js(ipc_endpoint_t *UNUSED(ipc), const guint8 *msg, guint length)
 {
     lua_State *L = extension.WL;
     gint n = lua_deserialize_range(L, msg, length);
-    g_assert_cmpint(n, ==, 5);
+    g_assert_cmpint(n, ==, 6);
 
-    gboolean no_return = lua_toboolean(L, -5);
-    guint64 page_id = lua_tointeger(L, -4);
-    const gchar *script = lua_tostring(L, -3);
+    gboolean no_return = lua_toboolean(L, -6);
+    guint64 page_id = lua_tointeger(L, -5);
+    const gchar *script = lua_tostring(L, -4);
+    /* If set, script is the hash of a registered script */
+    gboolean registered = lua_toboolean(L, -3);
     const gchar *source = lua_tostring(L, -2);
     /* cb ref is index -1 */
 
     WebKitWebPage *page = webkit_web_extension_get_page(extension.ext, page_id);
     if (!page) {
         /* Do nothing if eval'ing on page that's been closed */
-        lua_pop(L, 5);
+        lua_pop(L, 6);
         return;
     }
     WebKitFrame *frame = webkit_web_page_get_main_frame(page);
     WebKitScriptWorld *world = webkit_script_world_get_default();
     JSGlobalContextRef ctx = webkit_frame_get_javascript_context_for_script_world(frame, world);
 
-    n = luaJS_eval_js(L, ctx, script, source, no_return);
+    if (registered) {
+        JSStringRef js_script = scripts ? g_hash_table_lookup(scripts, script) : NULL;
+        g_assert(js_script);
+        n = luaJS_eval_jsstring(L, ctx, js_script, source, no_return);
+    } else
+        n = luaJS_eval_js(L, ctx, script, source, no_return);
     /* Send source and callback ref back again as well */
     if (n) /* Don't send if no_return == true and no errors */
         ipc_send_lua(extension.ipc, IPC_TYPE_eval_js, L, -n-2, -1);
-    lua_pop(L, 5 + n);
+    lua_pop(L, 6 + n);
+}
+
+void
+ipc_recv_memory(ipc_endpoint_t *ipc, gpointer UNUSED(msg), guint UNUSED(length))
+{
+    ipc_memory_t reply = {
+        .pid = getpid(),
+        .lua_kb = lua_gc(extension.WL, LUA_GCCOUNT, 0),
+    };
+    ipc_header_t header = { .type = IPC_TYPE_memory, .length = sizeof(reply) };
+    ipc_send(ipc, &header, &reply);
 }
 
 static gboolean
@@ -26,6 +26,8 @@ void emit_pending_page_creation_ipc(void);
 
 void ipc_recv_lua_require_module(ipc_endpoint_t *from, const ipc_lua_require_module_t *msg, guint length);
 void ipc_recv_lua_ipc(ipc_endpoint_t *from, const ipc_lua_ipc_t *msg, guint length);
+void ipc_recv_lua_ipc_call(ipc_endpoint_t *from, const ipc_lua_ipc_t *msg, guint length);
+void ipc_recv_lua_ipc_reply(ipc_endpoint_t *from, const ipc_lua_ipc_t *msg, guint length);
 
 #endif
 
@@ -17,10 +17,9 @@
  */
 
 #include <JavaScriptCore/JavaScript.h>
+#include <string.h>
 #include <unistd.h>
 
-#define LUAKIT_LUAJS_REGISTRY_KEY "luakit.luajs.registry"
-
 #include "luah.h"
 #include "extension/extension.h"
 #include "extension/luajs.h"
@@ -29,8 +28,6 @@
 #include "common/luaserialize.h"
 #include "common/luajs.h"
 
-static void register_func(WebKitScriptWorld *world, WebKitWebPage *web_page, WebKitFrame *frame, const gchar *name, gpointer ref);
-
 static void
 lua_gc_stack_top(lua_State *L)
 {
@@ -111,51 +108,225 @@ ipc_recv_lua_js_call(ipc_endpoint_t *UNUSED(ipc), const guint8 *msg, guint lengt
     g_assert(lua_isboolean(L, -1));
 }
 
+/* How a registration pattern is matched against a page uri */
+typedef enum {
+    /* Call string.find(uri, pattern) */
+    LUAJS_MATCH_FIND,
+    /* Match any uri starting with the literal prefix */
+    LUAJS_MATCH_PREFIX,
+    /* Match the literal prefix exactly */
+    LUAJS_MATCH_EXACT,
+} luajs_match_t;
+
+typedef struct _luajs_registration_t {
+    gchar *pattern;
+    gchar *name;
+    gpointer ref;
+    /* Whether to install the function in subframes as well */
+    gboolean all_frames;
+    /* Literal prefix of every matching uri, or NULL if unanchored */
+    gchar *prefix;
+    luajs_match_t match;
+} luajs_registration_t;
+
+/* All registrations, in registration order */
+static GPtrArray *registrations;
+/* Registrations indexed by "scheme://host/" or "scheme:", depending on how
+ * much of the uri their literal prefix determines */
+static GHashTable *registrations_by_key;
+/* Registrations that cannot be indexed */
+static GPtrArray *registrations_unindexed;
+/* Number of registrations that ask for subframes */
+static guint all_frames_count;
+/* One JSClassRef per function name, kept for the life of the process */
+static GHashTable *func_classes;
+
+/* Return the end of the single character class at p, or NULL if p is not a
+ * single character class */
+static const gchar *
+pattern_class_end(const gchar *p)
+{
+    switch (*p) {
+        case '\0':
+            return NULL;
+        case '%':
+            if (!p[1] || p[1] == 'b' || p[1] == 'f')
+                return NULL;
+            return p + 2;
+        case '[':
+            p++;
+            if (*p == '^')
+                p++;
+            /* The first character of a set is never its end */
+            do {
+                if (!*p)
+                    return NULL;
+                if (*p == '%' && !*++p)
+                    return NULL;
+                p++;
+            } while (*p != ']');
+            return p + 1;
+        case '(': case ')': case '$': case '^':
+        case '*': case '+': case '?': case '-':
+            return NULL;
+        default:
+            return p + 1;
+    }
+}
+
+/* Whether the pattern fragment matches the empty string at any position,
+ * regardless of what follows */
+static gboolean
+pattern_matches_anything(const gchar *p)
+{
+    while (*p) {
+        if (*p == '(' || *p == ')') {
+            p++;
+            continue;
+        }
+        const gchar *end = pattern_class_end(p);
+        if (!end || !*end || !strchr("*?-", *end))
+            return FALSE;
+        p = end + 1;
+    }
+    return TRUE;
+}
+
+/* Determine the literal prefix and match strategy of a pattern */
+static void
+registration_compile(luajs_registration_t *reg)
+{
+    const gchar *p = reg->pattern;
+    reg->match = LUAJS_MATCH_FIND;
+    if (*p++ != '^')
+        return;
+
+    GString *prefix = g_string_new(NULL);
+    while (*p) {
+        const gchar *end = pattern_class_end(p);
+        /* Only literal characters are part of the prefix */
+        if (!end || (*p == '%' && g_ascii_isalnum(p[1])) || *p == '[' || *p == '.')
+            break;
+        /* Quantified characters are optional */
+        if (*end && strchr("*+?-", *end))
+            break;
+        g_string_append_c(prefix, p[end - p - 1]);
+        p = end;
+    }
+    reg->prefix = g_string_free(prefix, FALSE);
+
+    if (!strcmp(p, "$"))
+        reg->match = LUAJS_MATCH_EXACT;
+    else if (pattern_matches_anything(p))
+        reg->match = LUAJS_MATCH_PREFIX;
+}
+
+/* Get the index key of a uri or literal uri prefix. Returns the scheme key
+ * as well if only it is known. */
+static gchar *
+uri_index_key(const gchar *uri, gboolean want_host)
+{
+    const gchar *colon = strchr(uri, ':');
+    if (!colon)
+        return NULL;
+    if (want_host && g_str_has_prefix(colon, "://")) {
+        const gchar *slash = strchr(colon + 3, '/');
+        if (slash)
+            return g_strndup(uri, slash - uri + 1);
+    }
+    return g_strndup(uri, colon - uri + 1);
+}
+
+static void
+registration_index(luajs_registration_t *reg)
+{
+    gchar *key = reg->prefix ? uri_index_key(reg->prefix, TRUE) : NULL;
+    if (!key) {
+        g_ptr_array_add(registrations_unindexed, reg);
+        return;
+    }
+
+    GPtrArray *list = g_hash_table_lookup(registrations_by_key, key);
+    if (!list) {
+        list = g_ptr_array_new();
+        g_hash_table_insert(registrations_by_key, key, list);
+    } else
+        g_free(key);
+    g_ptr_array_add(list, reg);
+}
+
 void
 ipc_recv_lua_js_register(ipc_endpoint_t *UNUSED(ipc), const guint8 *msg, guint length)
 {
     lua_State *L = extension.WL;
 
-    /* Should have three values: pattern, function name, function ref */
+    /* Should have four values: pattern, function name, function ref, and
+     * whether to register in all frames */
     int n = lua_deserialize_range(L, msg, length);
-    g_assert_cmpint(n, ==, 3);
+    g_assert_cmpint(n, ==, 4);
+    g_assert(lua_isstring(L, -4));
     g_assert(lua_isstring(L, -3));
-    g_assert(lua_isstring(L, -2));
-    g_assert(lua_islightuserdata(L, -1));
+    g_assert(lua_islightuserdata(L, -2));
+    g_assert(lua_isboolean(L, -1));
 
-    /* push pattern_table[pattern] */
-    lua_pushliteral(L, LUAKIT_LUAJS_REGISTRY_KEY);
-    lua_rawget(L, LUA_REGISTRYINDEX);
-    lua_pushvalue(L, -4);
-    lua_rawget(L, -2);
+    const gchar *pattern = lua_tostring(L, -4);
+    const gchar *name = lua_tostring(L, -3);
+    gpointer ref = lua_touserdata(L, -2);
+    gboolean all_frames = lua_toboolean(L, -1);
 
-    /* If table[pattern] is nil, set it to an empty table */
-    if (lua_isnil(L, -1)) {
+    /* If that function is already registered, free it */
+    for (guint i = 0; i < registrations->len; i++) {
+        luajs_registration_t *reg = g_ptr_array_index(registrations, i);
+        if (strcmp(reg->pattern, pattern) || strcmp(reg->name, name))
+            continue;
+        lua_pushlightuserdata(L, reg->ref);
+        lua_gc_stack_top(L);
         lua_pop(L, 1);
-        /* Push key, {}, and set the value */
-        lua_pushvalue(L, -4);
-        lua_newtable(L);
-        lua_rawset(L, -3);
-        /* Push key, and get the newly-set value */
-        lua_pushvalue(L, -4);
-        lua_rawget(L, -2);
+        reg->ref = ref;
+        if (reg->all_frames != all_frames)
+            all_frames_count += all_frames ? 1 : -1;
+        reg->all_frames = all_frames;
+        lua_pop(L, 4);
+        return;
     }
 
-    lua_replace(L, -2);
+    luajs_registration_t *reg = g_slice_new0(luajs_registration_t);
+    reg->pattern = g_strdup(pattern);
+    reg->name = g_strdup(name);
+    reg->ref = ref;
+    reg->all_frames = all_frames;
+    registration_compile(reg);
+    g_ptr_array_add(registrations, reg);
+    registration_index(reg);
+    if (all_frames)
+        all_frames_count++;
+
+    lua_pop(L, 4);
+}
 
-    /* If that function is already registered, free it */
-    lua_pushvalue(L, -3);
-    lua_rawget(L, -2);
-    if (!lua_isnil(L, -1)) {
-        g_assert(lua_islightuserdata(L, -1));
-        lua_gc_stack_top(L);
+static gboolean
+registration_matches(lua_State *L, luajs_registration_t *reg, const gchar *uri)
+{
+    if (reg->prefix && !g_str_has_prefix(uri, reg->prefix))
+        return FALSE;
+
+    switch (reg->match) {
+        case LUAJS_MATCH_PREFIX:
+            return TRUE;
+        case LUAJS_MATCH_EXACT:
+            return strlen(uri) == strlen(reg->prefix);
+        default:
+            break;
     }
-    lua_pop(L, 1);
 
-    /* Shift the table down, and set it */
-    lua_insert(L, -3);
-    lua_rawset(L, -3);
-    lua_pop(L, 2);
+    /* Call string.find(uri, pattern) */
+    lua_pushstring(L, uri);
+    lua_pushstring(L, reg->pattern);
+    if (!luaH_dofunction_from_registry(L, lua_string_find_ref, 2, 1))
+        return FALSE;
+    gboolean match = !lua_isnil(L, -1);
+    lua_pop(L, 1);
+    return match;
 }
 
 static void
@@ -165,16 +336,30 @@ luaJS_registered_function_gc(JSObjectRef obj)
     g_slice_free(luajs_func_ctx_t, ctx);
 }
 
-static void register_func(WebKitScriptWorld *world, WebKitWebPage *web_page, WebKitFrame *frame, const gchar *name, gpointer ref)
+static JSClassRef
+registered_function_class(const gchar *name)
 {
-    JSGlobalContextRef context = webkit_frame_get_javascript_context_for_script_world(frame, world);
+    JSClassRef class = g_hash_table_lookup(func_classes, name);
+    if (class)
+        return class;
 
-    JSStringRef js_name = JSStringCreateWithUTF8CString(name);
+    /* The class name must outlive the class, so it doubles as the key */
+    gchar *class_name = g_strdup(name);
     JSClassDefinition def = kJSClassDefinitionEmpty;
     def.callAsFunction = luaJS_registered_function_callback;
-    def.className = g_strdup(name);
+    def.className = class_name;
     def.finalize = luaJS_registered_function_gc;
-    JSClassRef class = JSClassCreate(&def);
+    class = JSClassCreate(&def);
+    g_hash_table_insert(func_classes, class_name, class);
+    return class;
+}
+
+static void register_func(WebKitScriptWorld *world, WebKitWebPage *web_page, WebKitFrame *frame, const gchar *name, gpointer ref)
+{
+    JSGlobalContextRef context = webkit_frame_get_javascript_context_for_script_world(frame, world);
+
+    JSStringRef js_name = JSStringCreateWithUTF8CString(name);
+    JSClassRef class = registered_function_class(name);
 
     luajs_func_ctx_t *ctx = g_slice_new(luajs_func_ctx_t);
     ctx->page_id = webkit_web_page_get_id(web_page);
@@ -186,50 +371,47 @@ static void register_func(WebKitScriptWorld *world, WebKitWebPage *web_page, Web
             kJSPropertyAttributeDontDelete | kJSPropertyAttributeReadOnly, NULL);
 
     JSStringRelease(js_name);
-    JSClassRelease(class);
 }
 
 static void
-window_object_cleared_cb(WebKitScriptWorld *world, WebKitWebPage *web_page, WebKitFrame *frame, gpointer UNUSED(user_data))
+register_matching(WebKitScriptWorld *world, WebKitWebPage *web_page,
+        WebKitFrame *frame, gboolean main_frame, GPtrArray *list, const gchar *uri)
 {
+    if (!list)
+        return;
     lua_State *L = extension.WL;
-    const gchar *uri = webkit_web_page_get_uri(web_page) ?: "about:blank";
+    for (guint i = 0; i < list->len; i++) {
+        luajs_registration_t *reg = g_ptr_array_index(list, i);
+        if (!main_frame && !reg->all_frames)
+            continue;
+        if (registration_matches(L, reg, uri))
+            register_func(world, web_page, frame, reg->name, reg->ref);
+    }
+}
 
-    /* Push pattern -> funclist table */
-    lua_pushliteral(L, LUAKIT_LUAJS_REGISTRY_KEY);
-    lua_rawget(L, LUA_REGISTRYINDEX);
-
-    /* Iterate over all patterns */
-    lua_pushnil(L);
-    while (lua_next(L, -2) != 0) {
-        /* Entries must be string -> function-list */
-        g_assert(lua_isstring(L, -2));
-        g_assert(lua_istable(L, -1));
-
-        /* Call string.find(uri, pattern) */
-        lua_pushstring(L, uri);
-        lua_pushvalue(L, -3);
-        luaH_dofunction_from_registry(L, lua_string_find_ref, 2, 1);
-
-        if (!lua_isnil(L, -1)) {
-            /* got a match: iterate over all functions */
-            lua_pushnil(L);
-            while (lua_next(L, -3) != 0) {
-                /* Entries must be name -> ref */
-                g_assert(lua_isstring(L, -2));
-                g_assert(lua_islightuserdata(L, -1));
-                /* Register the function */
-                register_func(world, web_page, frame, lua_tostring(L, -2), lua_touserdata(L, -1));
-                lua_pop(L, 1);
-            }
-        }
+static void
+window_object_cleared_cb(WebKitScriptWorld *world, WebKitWebPage *web_page, WebKitFrame *frame, gpointer UNUSED(user_data))
+{
+    gboolean main_frame = webkit_frame_is_main_frame(frame);
+    if (!main_frame && !all_frames_count)
+        return;
 
-        /* Pop off return code and the function value */
-        lua_pop(L, 2);
-    }
+    const gchar *uri = webkit_web_page_get_uri(web_page) ?: "about:blank";
 
-    /* Pop off table and string.find() */
-    lua_pop(L, 1);
+    /* Only registrations whose prefix agrees with the uri's scheme and
+     * host can match */
+    gchar *host_key = uri_index_key(uri, TRUE);
+    gchar *scheme_key = uri_index_key(uri, FALSE);
+    if (host_key && g_strcmp0(host_key, scheme_key))
+        register_matching(world, web_page, frame, main_frame,
+                g_hash_table_lookup(registrations_by_key, host_key), uri);
+    if (scheme_key)
+        register_matching(world, web_page, frame, main_frame,
+                g_hash_table_lookup(registrations_by_key, scheme_key), uri);
+    register_matching(world, web_page, frame, main_frame,
+            registrations_unindexed, uri);
+    g_free(host_key);
+    g_free(scheme_key);
 }
 
 void
@@ -238,13 +420,14 @@ web_luajs_init(void)
     g_signal_connect(webkit_script_world_get_default(), "window-object-cleared",
             G_CALLBACK (window_object_cleared_cb), NULL);
 
-    /* Push empty function registration table */
-    lua_State *L = extension.WL;
-    lua_pushliteral(L, LUAKIT_LUAJS_REGISTRY_KEY);
-    lua_newtable(L);
-    lua_rawset(L, LUA_REGISTRYINDEX);
+    registrations = g_ptr_array_new();
+    registrations_by_key = g_hash_table_new_full(g_str_hash, g_str_equal,
+            g_free, (GDestroyNotify) g_ptr_array_unref);
+    registrations_unindexed = g_ptr_array_new();
+    func_classes = g_hash_table_new(g_str_hash, g_str_equal);
 
     /* Save reference to string.find() */
+    lua_State *L = extension.WL;
     lua_getglobal(L, "string");
     lua_getfield(L, -1, "find");
     luaH_registerfct(L, -1, &lua_string_find_ref);
@@ -18,11 +18,14 @@
 
 #include <webkit2/webkit-web-extension.h>
 #include "extension/extension.h"
+#include "extension/clib/page.h"
 
 void
 web_script_world_init(void)
 {
     extension.script_world = webkit_script_world_new();
+    g_signal_connect(extension.script_world, "window-object-cleared",
+            G_CALLBACK(page_window_object_cleared_cb), NULL);
 }
 
 // vim: ft=c:et:sw=4:ts=8:sts=4:tw=80
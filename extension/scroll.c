@@ -23,6 +23,19 @@
 #include "extension/scroll.h"
 #include "extension/ipc.h"
 
+/* Scroll and document size changes are coalesced, and sent to the UI
+ * process at most once per frame */
+#define SCROLL_FLUSH_INTERVAL_MS 16
+
+typedef struct _scroll_state_t {
+    WebKitWebPage *web_page;
+    WebKitDOMDOMWindow *window;
+    WebKitDOMElement *html;
+    gboolean scroll_pending, docresize_pending;
+    gint doc_w, doc_h;
+    guint flush_id;
+} scroll_state_t;
+
 static void
 send_scroll_msg(gint h, gint v, WebKitWebPage *web_page, ipc_scroll_subtype_t subtype)
 {
@@ -39,78 +52,144 @@ send_scroll_msg(gint h, gint v, WebKitWebPage *web_page, ipc_scroll_subtype_t su
 }
 
 static void
-window_scroll_cb(WebKitDOMDOMWindow *window, WebKitDOMEvent *UNUSED(event), WebKitWebPage *web_page)
+scroll_flush(scroll_state_t *state)
+{
+    if (state->flush_id) {
+        g_source_remove(state->flush_id);
+        state->flush_id = 0;
+    }
+
+    if (state->scroll_pending) {
+        state->scroll_pending = FALSE;
+        gint h = webkit_dom_dom_window_get_scroll_x(state->window);
+        gint v = webkit_dom_dom_window_get_scroll_y(state->window);
+        send_scroll_msg(h, v, state->web_page, IPC_SCROLL_TYPE_scroll);
+    }
+
+    if (state->docresize_pending) {
+        state->docresize_pending = FALSE;
+        gint h = webkit_dom_element_get_scroll_width(state->html);
+        gint v = webkit_dom_element_get_scroll_height(state->html);
+
+        /* Only send message if the size changes */
+        if (h != state->doc_w || v != state->doc_h) {
+            state->doc_w = h;
+            state->doc_h = v;
+            send_scroll_msg(h, v, state->web_page, IPC_SCROLL_TYPE_docresize);
+        }
+    }
+}
+
+static gboolean
+scroll_flush_cb(scroll_state_t *state)
 {
-    gint h = webkit_dom_dom_window_get_scroll_x(window);
-    gint v = webkit_dom_dom_window_get_scroll_y(window);
-    send_scroll_msg(h, v, web_page, IPC_SCROLL_TYPE_scroll);
+    state->flush_id = 0;
+    scroll_flush(state);
+    return FALSE;
 }
 
 static void
-window_resize_cb(WebKitDOMDOMWindow *window, WebKitDOMEvent *UNUSED(event), WebKitWebPage *web_page)
+scroll_queue_flush(scroll_state_t *state)
 {
-    gint h = webkit_dom_dom_window_get_inner_width(window);
-    gint v = webkit_dom_dom_window_get_inner_height(window);
-    send_scroll_msg(h, v, web_page, IPC_SCROLL_TYPE_winresize);
+    if (!state->flush_id)
+        state->flush_id = g_timeout_add(SCROLL_FLUSH_INTERVAL_MS,
+                (GSourceFunc)scroll_flush_cb, state);
 }
 
-static gint scroll_width_prev = -1, scroll_height_prev = -1;
+static void
+scroll_state_free(scroll_state_t *state)
+{
+    if (state->flush_id)
+        g_source_remove(state->flush_id);
+    g_clear_object(&state->window);
+    g_clear_object(&state->html);
+    g_slice_free(scroll_state_t, state);
+}
 
 static void
-document_resize_cb(WebKitDOMElement *html, WebKitDOMEvent *UNUSED(event), WebKitWebPage *web_page)
+window_scroll_cb(WebKitDOMDOMWindow *UNUSED(window), WebKitDOMEvent *UNUSED(event), scroll_state_t *state)
 {
-    gint h = webkit_dom_element_get_scroll_width(html);
-    gint v = webkit_dom_element_get_scroll_height(html);
+    state->scroll_pending = TRUE;
+    scroll_queue_flush(state);
+}
 
-    /* Only send message if the size changes */
-    /* This still isn't that performant... needs a better solution really */
-    if (h == scroll_width_prev && v == scroll_height_prev)
-        return;
-    scroll_width_prev = h;
-    scroll_height_prev = v;
+static void
+window_resize_cb(WebKitDOMDOMWindow *window, WebKitDOMEvent *UNUSED(event), scroll_state_t *state)
+{
+    gint h = webkit_dom_dom_window_get_inner_width(window);
+    gint v = webkit_dom_dom_window_get_inner_height(window);
+    send_scroll_msg(h, v, state->web_page, IPC_SCROLL_TYPE_winresize);
+}
 
-    send_scroll_msg(h, v, web_page, IPC_SCROLL_TYPE_docresize);
+static void
+document_resize_cb(WebKitDOMElement *UNUSED(html), WebKitDOMEvent *UNUSED(event), scroll_state_t *state)
+{
+    /* Querying the document size forces a layout, so only do so once the
+     * burst of mutations is over */
+    state->docresize_pending = TRUE;
+    scroll_queue_flush(state);
 }
 
 static void
-web_page_document_loaded_cb(WebKitWebPage *web_page, gpointer UNUSED(user_data))
+web_page_document_loaded_cb(WebKitWebPage *web_page, scroll_state_t *state)
 {
     WebKitDOMDocument *document = webkit_web_page_get_dom_document(web_page);
     WebKitDOMElement *html = webkit_dom_document_get_document_element(document);
     WebKitDOMDOMWindow *window = webkit_dom_document_get_default_view(document);
 
+    g_clear_object(&state->window);
+    g_clear_object(&state->html);
+    state->window = g_object_ref(window);
+    state->html = g_object_ref(html);
+    state->doc_w = state->doc_h = -1;
+
     /* Add event listeners... */
 
     webkit_dom_event_target_add_event_listener(WEBKIT_DOM_EVENT_TARGET(window),
-        "scroll", G_CALLBACK(window_scroll_cb), FALSE, web_page);
+        "scroll", G_CALLBACK(window_scroll_cb), FALSE, state);
     webkit_dom_event_target_add_event_listener(WEBKIT_DOM_EVENT_TARGET(window),
-        "resize", G_CALLBACK(window_resize_cb), FALSE, web_page);
+        "resize", G_CALLBACK(window_resize_cb), FALSE, state);
     webkit_dom_event_target_add_event_listener(WEBKIT_DOM_EVENT_TARGET(html),
-        "DOMSubtreeModified", G_CALLBACK(document_resize_cb), FALSE, web_page);
+        "DOMSubtreeModified", G_CALLBACK(document_resize_cb), FALSE, state);
 
     /* ... and make sure initial values are set */
 
-    window_scroll_cb(window, NULL, web_page);
-    window_resize_cb(window, NULL, web_page);
-    document_resize_cb(html, NULL, web_page);
+    window_resize_cb(window, NULL, state);
+    state->scroll_pending = state->docresize_pending = TRUE;
+    scroll_flush(state);
 }
 
 static void
 web_page_created_cb(WebKitWebExtension *UNUSED(ext), WebKitWebPage *web_page, gpointer UNUSED(user_data))
 {
-    g_signal_connect(web_page, "document-loaded", G_CALLBACK(web_page_document_loaded_cb), NULL);
+    scroll_state_t *state = g_slice_new0(scroll_state_t);
+    state->web_page = web_page;
+    g_object_set_data_full(G_OBJECT(web_page), "luakit-scroll-state", state,
+            (GDestroyNotify)scroll_state_free);
+    g_signal_connect(web_page, "document-loaded", G_CALLBACK(web_page_document_loaded_cb), state);
 }
 
 void
 web_scroll_to(guint64 page_id, gint scroll_x, gint scroll_y)
 {
     WebKitWebPage *page = webkit_web_extension_get_page(extension.ext, page_id);
+    /* Do nothing if scrolling a page that's been closed */
+    if (!page)
+        return;
+    scroll_state_t *state = g_object_get_data(G_OBJECT(page), "luakit-scroll-state");
+    if (!state)
+        return;
     WebKitDOMDocument *document = webkit_web_page_get_dom_document(page);
     WebKitDOMDOMWindow *window = webkit_dom_document_get_default_view(document);
 
     /* Scroll, then tell UI process what the new scroll position is */
     webkit_dom_dom_window_scroll_to(window, scroll_x, scroll_y);
-    window_scroll_cb(window, NULL, page);
+    if (state->window) {
+        state->scroll_pending = TRUE;
+        scroll_flush(state);
+    } else
+        send_scroll_msg(webkit_dom_dom_window_get_scroll_x(window),
+                webkit_dom_dom_window_get_scroll_y(window), page, IPC_SCROLL_TYPE_scroll);
 }
 
 void
@@ -34,6 +34,8 @@
 #include "clib/widget.h"
 #include "common/luaserialize.h"
 #include "common/clib/ipc.h"
+#include "common/trace.h"
+#include "memory.h"
 #include "web_context.h"
 #include "widgets/webview.h"
 
@@ -51,10 +53,12 @@ NO_HANDLER(lua_require_module)
 NO_HANDLER(lua_js_register)
 NO_HANDLER(web_extension_loaded)
 NO_HANDLER(crash)
+NO_HANDLER(script)
 
 void
 ipc_recv_extension_init(ipc_endpoint_t *ipc, const gpointer UNUSED(msg), guint UNUSED(length))
 {
+    trace_instant("startup", "web extension connected");
     web_module_load_modules_on_endpoint(ipc);
     luaH_register_functions_on_endpoint(ipc, globalconf.L);
 
@@ -64,9 +68,33 @@ ipc_recv_extension_init(ipc_endpoint_t *ipc, const gpointer UNUSED(msg), guint U
 }
 
 void
-ipc_recv_lua_ipc(ipc_endpoint_t *UNUSED(ipc), const ipc_lua_ipc_t *msg, guint length)
+ipc_recv_lua_ipc(ipc_endpoint_t *ipc, const ipc_lua_ipc_t *msg, guint length)
 {
-    ipc_channel_recv(globalconf.L, msg->arg, length);
+    ipc_channel_recv(globalconf.L, ipc, msg->arg, length);
+}
+
+void
+ipc_recv_trace(ipc_endpoint_t *UNUSED(ipc), const gchar *msg, guint length)
+{
+    trace_add_events(msg, length);
+}
+
+void
+ipc_recv_memory(ipc_endpoint_t *UNUSED(ipc), const ipc_memory_t *msg, guint UNUSED(length))
+{
+    memory_set_web_lua_heap(msg->pid, msg->lua_kb);
+}
+
+void
+ipc_recv_lua_ipc_call(ipc_endpoint_t *ipc, const ipc_lua_ipc_t *msg, guint length)
+{
+    ipc_channel_recv_call(globalconf.L, ipc, msg->arg, length);
+}
+
+void
+ipc_recv_lua_ipc_reply(ipc_endpoint_t *ipc, const ipc_lua_ipc_t *msg, guint length)
+{
+    ipc_channel_recv_reply(globalconf.L, ipc, msg->arg, length);
 }
 
 void
@@ -173,6 +201,8 @@ web_extension_connect_thread(const gchar *socket_path)
 static void
 initialize_web_extensions_cb(WebKitWebContext *context, gpointer socket_path)
 {
+    trace_instant("startup", "spawn web process");
+
 #if DEVELOPMENT_PATHS
     gchar *extension_dir = g_get_current_dir();
 #else
@@ -195,7 +225,9 @@ initialize_web_extensions_cb(WebKitWebContext *context, gpointer socket_path)
      * until after the web extension process has already started (and failed to
      * connect). TODO: add a busy wait */
 
-    GVariant *payload = g_variant_new_string(socket_path);
+    /* Web processes are told whether to trace, rather than reading it from
+     * the environment, so that processes spawned later don't inherit it */
+    GVariant *payload = g_variant_new("(sb)", socket_path, trace_enabled());
     webkit_web_context_set_web_extensions_initialization_user_data(context, payload);
     webkit_web_context_set_web_extensions_directory(context, extension_dir);
 #if DEVELOPMENT_PATHS
@@ -55,6 +55,7 @@ _M.html_template = [==[
     <html>
     <head>
         <title>{title}</title>
+        {link}
         <style type="text/css">
             {style}
         </style>
@@ -202,7 +203,8 @@ chrome.add("adblock", function ()
     local html_subs = {
         links   = table.concat(links, "\n\n"),
         title  = _M.html_page_title,
-        style  = chrome.stylesheet .. _M.html_style,
+        link   = chrome.stylesheet_link(),
+        style  = _M.html_style,
         state = adblock.enabled and "Enabled" or "Disabled",
         white   = rulescount.white,
         black   = rulescount.black,
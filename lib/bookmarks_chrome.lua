@@ -204,6 +204,7 @@ local html_template = [==[
 <head>
     <meta charset="utf-8">
     <title>Bookmarks</title>
+    {%link}
     <style type="text/css">
         {%stylesheet}
     </style>
@@ -480,13 +481,16 @@ local export_funcs = {
 }
 
 chrome.add("bookmarks", function ()
-    local style = chrome.stylesheet .. _M.stylesheet
+    local style = _M.stylesheet
 
     if not _M.show_uri then
         style = style .. " .bookmark .uri { display: none !important; } "
     end
 
-    local html = string.gsub(html_template, "{%%(%w+)}", { stylesheet = style })
+    local html = string.gsub(html_template, "{%%(%w+)}", {
+        link = chrome.stylesheet_link(),
+        stylesheet = style,
+    })
     return html
 end,
 function (view)
@@ -133,6 +133,126 @@ _M.stylesheet = [===[
 -- luakit:// page handlers
 local handlers = {}
 local on_first_visual_handlers = {}
+-- Loaders for pages that are added on first use
+local loaders = {}
+
+--- URI of the common stylesheet, served from memory. Chrome pages can link
+-- to it with `stylesheet_link()` instead of inlining `stylesheet`.
+-- @type string
+-- @readonly
+_M.stylesheet_uri = "luakit://asset/chrome.css"
+
+-- The common stylesheet currently served, and its version
+local served_stylesheet, stylesheet_version = nil, 0
+
+--- Serve a static asset from memory.
+--
+-- Assets are served without calling into Lua, and may be cached by the
+-- web process. Requests for `luakit://<path>` return the asset; any query
+-- string is ignored, so it can be used to bust the cache.
+--
+-- @tparam string path The asset path, of the form `"page/file"`.
+-- @tparam string data The asset contents, or `nil` to remove the asset.
+-- @tparam string mime The asset MIME type.
+function _M.add_asset(path, data, mime)
+    assert(type(path) == "string" and string.match(path, "^[%w%-]+/."),
+        "invalid chrome asset path: " .. tostring(path))
+    luakit.register_scheme_asset("luakit", path, data, mime)
+end
+
+--- Get a `<link>` tag for the common stylesheet.
+-- @treturn string The HTML `<link>` tag.
+function _M.stylesheet_link()
+    if _M.stylesheet ~= served_stylesheet then
+        served_stylesheet = _M.stylesheet
+        stylesheet_version = stylesheet_version + 1
+        _M.add_asset("asset/chrome.css", served_stylesheet, "text/css")
+    end
+    return string.format('<link rel="stylesheet" type="text/css" href="%s?v=%d">',
+        _M.stylesheet_uri, stylesheet_version)
+end
+
+local function show_missing_page(v, page, request)
+    error_page.show_error_page(v, {
+        heading = "Chrome handler error",
+        content = [==[
+            <div class="errorMessage">
+                <p>No chrome handler for <code>luakit://{page}/</code></p>
+            </div>
+        ]==],
+        buttons = {},
+        page = page,
+        request = request,
+    })
+end
+
+local function on_load_status(v, status, load)
+    -- Wait for new page to be created
+    if status ~= "finished" then return end
+
+    -- Match "luakit://page/path"
+    local page, path = string.match(load.uri, "^luakit://([^/]+)/?(.*)")
+    if not page then return end
+
+    -- Ensure we have a hook to call
+    local on_first_visual_func = on_first_visual_handlers[page]
+    if not on_first_visual_func then return end
+
+    local w = webview.window(v)
+    local meta = { page = page, path = path, w = w,
+        uri = "luakit://" .. page .. "/" .. path }
+
+    -- Call the supplied handler
+    on_first_visual_func(v, meta)
+end
+
+-- Views that have loaded a chrome page
+local chrome_views = setmetatable({}, { __mode = "k" })
+
+-- Called natively for requests to registered chrome pages
+local function dispatch(v, _, request, page, path)
+    -- Only views that load chrome pages watch for them finishing
+    if not chrome_views[v] then
+        chrome_views[v] = true
+        v:add_signal("load-status", on_load_status)
+    end
+
+    local loader = loaders[page]
+    if loader then
+        loaders[page] = nil
+        loader(page)
+    end
+
+    local func = handlers[page]
+    if not func then return show_missing_page(v, page, request) end
+
+    -- Give the handler function everything it may need
+    local w = webview.window(v)
+    local meta = { page = page, path = path, w = w,
+        uri = "luakit://" .. page .. "/" .. path }
+
+    -- Render error output in webview with traceback
+    local function error_handler(err)
+        error_page.show_error_page(v, {
+            heading = "Chrome handler error",
+            content = [==[
+                <div class="errorMessage">
+                    <p>An error occurred in the <code>luakit://{page}/</code> handler function:
+                    <pre>{traceback}</pre>
+                </div>
+            ]==],
+            buttons = {},
+            page = page,
+            traceback = debug.traceback(err, 2),
+            request = request,
+        })
+    end
+
+    -- Call luakit:// page handler
+    local ok, html, mime = xpcall(function () return func(v, meta) end,
+        error_handler)
+    if ok then request:finish(html, mime) end
+end
 
 --- Register a chrome page URI with an associated handler function.
 -- @tparam string page The name of the chrome page to register.
@@ -162,6 +282,22 @@ function _M.add(page, func, on_first_visual_func, export_funcs)
 
     handlers[page] = func
     on_first_visual_handlers[page] = on_first_visual_func
+    loaders[page] = nil
+    luakit.register_scheme_page("luakit", page, dispatch)
+end
+
+--- Register a loader function for a chrome page that has not been added yet.
+-- The loader is called with the page name the first time the page is
+-- requested, and must add the page with `add()`.
+-- @tparam string page The name of the chrome page.
+-- @tparam function func The loader function.
+function _M.add_loader(page, func)
+    assert(type(func) == "function",
+        "invalid chrome loader (function expected, got "..type(func)..")")
+    if not handlers[page] then
+        loaders[page] = func
+        luakit.register_scheme_page("luakit", page, dispatch)
+    end
 end
 
 --- Remove a regeistered chrome page.
@@ -169,83 +305,19 @@ end
 function _M.remove(page)
     handlers[page] = nil
     on_first_visual_handlers[page] = nil
+    loaders[page] = nil
+    luakit.register_scheme_page("luakit", page, nil)
 end
 
-luakit.register_scheme("luakit")
+-- Requests for pages without a handler show an error page
+luakit.register_scheme("luakit", function (v, _, request, page)
+    show_missing_page(v, page, request)
+end)
 
--- Catch all navigations to the luakit:// scheme
 webview.add_signal("init", function (view)
-    view:add_signal("scheme-request::luakit", function (v, uri, request)
-        -- Match "luakit://page/path"
-        local page, path = string.match(uri, "^luakit://([^/]+)/?(.*)")
-        if not page then return end
-
-        local func = handlers[page]
-        if func then
-            -- Give the handler function everything it may need
-            local w = webview.window(v)
-            local meta = { page = page, path = path, w = w,
-                uri = "luakit://" .. page .. "/" .. path }
-
-            -- Render error output in webview with traceback
-            local function error_handler(err)
-                error_page.show_error_page(v, {
-                    heading = "Chrome handler error",
-                    content = [==[
-                        <div class="errorMessage">
-                            <p>An error occurred in the <code>luakit://{page}/</code> handler function:
-                            <pre>{traceback}</pre>
-                        </div>
-                    ]==],
-                    buttons = {},
-                    page = page,
-                    traceback = debug.traceback(err, 2),
-                    request = request,
-                })
-            end
-
-            -- Call luakit:// page handler
-            local ok, html, mime = xpcall(function () return func(v, meta) end,
-                error_handler)
-            if ok then request:finish(html, mime) end
-            return
-        end
-
-        -- Load error page
-        error_page.show_error_page(v, {
-            heading = "Chrome handler error",
-            content = [==[
-                <div class="errorMessage">
-                    <p>No chrome handler for <code>luakit://{page}/</code></p>
-                </div>
-            ]==],
-            buttons = {},
-            page = page,
-            request = request,
-        })
-    end)
-
-    view:add_signal("load-status", function (v, status)
-        -- Wait for new page to be created
-        if status ~= "finished" then return end
-
-        -- Match "luakit://page/path"
-        local page, path = string.match(v.uri, "^luakit://([^/]+)/?(.*)")
-        if not page then return end
-
-        -- Ensure we have a hook to call
-        local on_first_visual_func = on_first_visual_handlers[page]
-        if not on_first_visual_func then return end
-
-        local w = webview.window(v)
-        local meta = { page = page, path = path, w = w,
-            uri = "luakit://" .. page .. "/" .. path }
-
-        -- Call the supplied handler
-        on_first_visual_func(v, meta)
-    end)
     -- Always enable JavaScript on luakit:// pages; without this, chrome
-    -- pages which depend upon javascript will break
+    -- pages which depend upon javascript will break. This is checked
+    -- before the page is requested, so it is needed on every view.
     view:add_signal("enable-scripts", function (v)
         if v.uri:match("^luakit://") then return true end
     end)
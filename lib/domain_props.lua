@@ -1,46 +1,111 @@
 --- Automatically apply per-domain webview properties.
 --
+-- The `globals.domain_props` table is compiled into a suffix trie the first
+-- time it is needed, and the effective property set for each host is cached.
+-- If `globals.domain_props` is modified in place, call `rebuild()`;
+-- replacing the table entirely is detected automatically.
+--
 -- @module domain_props
 -- @copyright 2012 Mason Larobina
 
 local lousy = require("lousy")
 local webview = require("webview")
 local globals = require("globals")
-local domain_props = globals.domain_props
 
 local _M = {}
 
-webview.add_signal("init", function (view)
-    view:add_signal("load-status", function (v, status)
-        if status ~= "committed" or v.uri == "about:blank" then return end
-        -- Get domain
-        local domain = lousy.uri.parse(v.uri).host
-        -- Strip leading www.
-        domain = string.match(domain or "", "^www%.(.+)") or domain or "all"
-        -- Build list of domain props tables to join & load.
-        -- I.e. for example.com load { .example.com, example.com, .com }
-        local prop_sets = {
-            { domain = "all", props = domain_props.all or {} },
-            { domain = domain, props = domain_props[domain] or {} },
-        }
-        repeat
-            table.insert(prop_sets, { domain = "."..domain, props = domain_props["."..domain] or {} })
-            domain = string.match(domain, "%.(.+)")
-        until not domain
-
-        -- Sort by rule precedence: "all" first, then by increasing specificity
-        table.sort(prop_sets, function (a, b)
-            if a.domain == "all" then return true end
-            if b.domain == "all" then return false end
-            return #a.domain < #b.domain
-        end)
-
-        -- Apply all properties
-        for _, props in ipairs(prop_sets) do
-            for k, prop in pairs(props.props) do
-                msg.info("Domain prop: %s = %s (%s)", k, prop, props.domain)
-                view[k] = prop
+-- The domain_props table the trie was compiled from
+local compiled_from
+-- Root of the suffix trie; children are keyed by domain label, right to left
+local trie
+-- Effective property set per host
+local resolved = {}
+local resolved_count = 0
+local max_resolved = 512
+
+local function new_node()
+    return { children = {} }
+end
+
+local function compile(domain_props)
+    local root = new_node()
+    for domain, props in pairs(domain_props) do
+        if type(props) == "table" and domain ~= "all" then
+            -- ".example.com" applies to example.com and all its subdomains;
+            -- "example.com" applies to that host only
+            local subdomains = string.sub(domain, 1, 1) == "."
+            local name = subdomains and string.sub(domain, 2) or domain
+            local labels = lousy.util.string.split(name, "%.")
+            local node = root
+            for i = #labels, 1, -1 do
+                local child = node.children[labels[i]]
+                if not child then
+                    child = new_node()
+                    node.children[labels[i]] = child
+                end
+                node = child
             end
+            node[subdomains and "sub" or "exact"] = props
+        end
+    end
+    root.exact = domain_props.all
+    return root
+end
+
+--- Recompile the domain properties table.
+-- Only needed if `globals.domain_props` has been modified in place.
+function _M.rebuild()
+    compiled_from = globals.domain_props
+    trie = compile(compiled_from or {})
+    resolved, resolved_count = {}, 0
+end
+
+local function merge(into, props)
+    if not props then return end
+    for k, v in pairs(props) do into[k] = v end
+end
+
+--- Get the effective domain properties for a host.
+-- Rules are applied in order of increasing specificity: `"all"` first, then
+-- the matching rules ordered by length.
+-- @tparam string host The host name, without any leading `www.`.
+-- @treturn table The property names and values to apply.
+function _M.resolve(host)
+    if globals.domain_props ~= compiled_from then _M.rebuild() end
+
+    local props = resolved[host]
+    if props then return props end
+
+    props = {}
+    merge(props, trie.exact)
+
+    -- Walk the trie from the top-level domain down to the full host
+    local labels = lousy.util.string.split(host, "%.")
+    local node = trie
+    for i = #labels, 1, -1 do
+        node = node.children[labels[i]]
+        if not node then break end
+        if i == 1 then merge(props, node.exact) end
+        merge(props, node.sub)
+    end
+
+    if resolved_count >= max_resolved then
+        resolved, resolved_count = {}, 0
+    end
+    resolved[host] = props
+    resolved_count = resolved_count + 1
+    return props
+end
+
+webview.add_signal("init", function (view)
+    view:add_signal("load-status", function (v, status, load)
+        if status ~= "committed" or load.uri == "about:blank" then return end
+        -- Get domain, stripping leading www.
+        local domain = lousy.uri.parse(load.uri).host
+        domain = string.match(domain or "", "^www%.(.+)") or domain or ""
+        local changed = v:set_properties(_M.resolve(domain))
+        if changed > 0 then
+            msg.verbose("Domain props: %d changed for %s", changed, domain)
         end
     end)
 end)
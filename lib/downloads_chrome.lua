@@ -11,7 +11,6 @@ local chrome = require("chrome")
 local binds = require("binds")
 local add_binds, add_cmds = binds.add_binds, binds.add_cmds
 local webview = require("webview")
-local window = require("window")
 
 local _M = {}
 
@@ -21,6 +20,7 @@ local html_template = [==[
 <head>
     <meta charset="utf-8">
     <title>Downloads</title>
+    {link}
     <style type="text/css">
         {style}
     </style>
@@ -135,99 +135,96 @@ function getid(that) {
     return $(that).parents(".download").eq(0).attr("id");
 };
 
-function update_list() {
-    var downloads = downloads_get_all(["status", "speed", "current_size", "total_size"]);
+function insert_download(d) {
+    var elem_html = make_download(d);
 
-    // return if no downloads to display
-    if (downloads.length === "undefined") {
-        setTimeout(update, 1000); // update 1s from now
-        return;
+    // ordered insert
+    var $all = $("#downloads-list .download");
+    for (var j = 0; j < $all.length; j++) {
+        if (d.created > $all.eq(j).attr("created")) {
+            $all.eq(j).before(elem_html);
+            return $("#"+d.id).eq(0).fadeIn();
+        }
     }
 
-    for (var i = 0; i < downloads.length; i++) {
-        var d = downloads[i];
-        // find existing element
-        var $elem = $("#"+d.id).eq(0);
-
-        // create new download element
-        if ($elem.length === 0) {
-            // get some more information
-            d = download_get(d.id, ["status", "destination", "created", "uri", "total_size"]);
-            var elem_html = make_download(d);
-
-            // ordered insert
-            var inserted = false;
-            var $all = $("#downloads-list .download");
-            for (var j = 0; j < $all.length; j++) {
-                if (d.created > $all.eq(j).attr("created")) {
-                    $all.eq(j).before(elem_html);
-                    inserted = true;
-                    break;
-                }
-            }
-
-            // back of the bus
-            if (!inserted) {
-                $("#downloads-list").append(elem_html);
-            }
-
-            $elem = $("#"+d.id).eq(0);
-            $elem.fadeIn();
-        }
+    // back of the bus
+    $("#downloads-list").append(elem_html);
+    return $("#"+d.id).eq(0).fadeIn();
+}
 
-        // update download controls when download status changes
-        if (d.status !== $elem.attr("status")) {
-            $elem.find(".controls a").hide();
-            switch (d.status) {
-            case "created":
-            case "started":
-                $elem.find(".cancel,.show").fadeIn();
-                break;
-            case "finished":
-                $elem.find(".show,.remove").fadeIn();
-                break;
-            case "error":
-            case "cancelled":
-                $elem.find(".remove,.restart").fadeIn();
-                break;
-            }
-            // save latest download status
-            $elem.attr("status", d.status);
-        }
+function update_download(d) {
+    var $elem = $("#"+d.id).eq(0);
+
+    if (d.kind === "removed") {
+        $elem.remove();
+        return;
+    }
 
-        // update status text
-        var $st = $elem.find(".status").eq(0);
+    // create new download element
+    if ($elem.length === 0) {
+        if (d.kind !== "added")
+            return;
+        $elem = insert_download(d);
+    }
+
+    // update download controls when download status changes
+    if (d.status !== $elem.attr("status")) {
+        $elem.find(".controls a").hide();
         switch (d.status) {
+        case "created":
         case "started":
-            $st.text("downloading - "
-                + readable_size(d.current_size) + "/"
-                + readable_size(d.total_size) + " @ "
-                + readable_size(d.speed) + "/s");
+            $elem.find(".cancel,.show").fadeIn();
             break;
-
         case "finished":
-            $st.html("Finished - " + readable_size(d.total_size));
+            $elem.find(".show,.remove").fadeIn();
             break;
-
         case "error":
-            $st.html("Error");
-            break;
-
         case "cancelled":
-            $st.html("Cancelled");
-            break;
-
-        case "created":
-            $st.html("Waiting");
-            break;
-
-        default:
-            $st.html("");
+            $elem.find(".remove,.restart").fadeIn();
             break;
         }
+        // save latest download status
+        $elem.attr("status", d.status);
+    }
+
+    // update status text
+    var $st = $elem.find(".status").eq(0);
+    switch (d.status) {
+    case "started":
+        $st.text("downloading - "
+            + readable_size(d.current_size) + "/"
+            + readable_size(d.total_size) + " @ "
+            + readable_size(d.speed) + "/s");
+        break;
+
+    case "finished":
+        $st.html("Finished - " + readable_size(d.total_size));
+        break;
+
+    case "error":
+        $st.html("Error");
+        break;
+
+    case "cancelled":
+        $st.html("Cancelled");
+        break;
+
+    case "created":
+        $st.html("Waiting");
+        break;
+
+    default:
+        $st.html("");
+        break;
     }
 };
 
+// Called from Lua with a batch of download state changes
+function apply_diffs(diffs) {
+    for (var i = 0; i < diffs.length; i++)
+        update_download(diffs[i]);
+};
+
 $(document).ready(function () {
     $("#downloads-list").on("click", ".controls .show", function (e) {
         download_show(getid(this));
@@ -255,12 +252,15 @@ $(document).ready(function () {
         return false;
     });
 
-    update_list();
+    // Fetch the initial list once; later changes are pushed from Lua
+    var downloads = downloads_get_all(["status", "destination", "created",
+        "uri", "current_size", "total_size", "speed"]);
+    for (var i = 0; i < downloads.length; i++)
+        downloads[i].kind = "added";
+    apply_diffs(downloads);
 });
 ]=]
 
-local update_list_js = [=[update_list();]=]
-
 -- default filter
 local default_filter = { destination = true, status = true, created = true,
     current_size = true, total_size = true, mime_type = true, uri = true,
@@ -321,6 +321,102 @@ local export_funcs = {
     downloads_clear  = function (_, id) return downloads.clear(id) end,
 }
 
+-- Open luakit://downloads pages; only these receive download updates
+local pages = setmetatable({}, { __mode = "k" })
+local leave_page
+
+-- Downloads that open pages already know about, and their ids
+local announced = setmetatable({}, { __mode = "k" })
+
+-- Coalesced state changes waiting to be pushed, by download id
+local pending, pending_order, flush_queued = {}, {}, false
+
+local function js_string(s)
+    s = string.gsub(s, "[%c\\\"<]", function (c)
+        return string.format("\\u%04x", string.byte(c))
+    end)
+    return '"' .. s .. '"'
+end
+
+local function js_diff(diff)
+    local fields = {}
+    for k, v in pairs(diff) do
+        if type(v) == "string" then v = js_string(v)
+        else v = tostring(v) end
+        table.insert(fields, k .. ":" .. v)
+    end
+    return "{" .. table.concat(fields, ",") .. "}"
+end
+
+local function flush_updates()
+    flush_queued = false
+    local diffs = {}
+    for _, id in ipairs(pending_order) do
+        table.insert(diffs, js_diff(pending[id]))
+    end
+    pending, pending_order = {}, {}
+    if #diffs == 0 then return end
+
+    local js = "apply_diffs([" .. table.concat(diffs, ",") .. "]);"
+    for v in pairs(pages) do
+        v:eval_js(js, { no_return = true })
+    end
+end
+
+-- Priority of diff kinds when several changes to one download are coalesced
+local kind_rank = { progress = 1, finished = 2, added = 3, removed = 4 }
+
+local function queue_update(kind, id, fields)
+    if not next(pages) then return end
+
+    local diff = pending[id]
+    if not diff then
+        diff = { id = id }
+        pending[id] = diff
+        table.insert(pending_order, id)
+    end
+    if not diff.kind or kind_rank[kind] > kind_rank[diff.kind] then
+        diff.kind = kind
+    end
+    for k, v in pairs(fields or {}) do diff[k] = v end
+
+    if not flush_queued then
+        flush_queued = true
+        luakit.idle_add(flush_updates)
+    end
+end
+
+local function forget_page(v)
+    pages[v] = nil
+    v:remove_signal("load-status", leave_page)
+    v:remove_signal("destroy", forget_page)
+end
+
+function leave_page(v, status)
+    if status == "provisional" then forget_page(v) end
+end
+
+local progress_filter = { status = true, current_size = true,
+    total_size = true, speed = true }
+local added_filter = { status = true, destination = true, created = true,
+    uri = true, current_size = true, total_size = true, speed = true }
+
+downloads.add_signal("download::status", function (d, data)
+    if not data then return end
+    local kind
+    if not announced[d] then
+        announced[d] = data.id
+        kind = "added"
+    elseif d.status == "finished" or d.status == "error"
+        or d.status == "cancelled" then
+        kind = "finished"
+    else
+        kind = "progress"
+    end
+    local filter = kind == "added" and added_filter or progress_filter
+    queue_update(kind, data.id, collate_download_data(d, data, filter))
+end)
+
 downloads.add_signal("status-tick", function (running)
     if running == 0 then
         for _, data in pairs(downloads.get_all()) do data.speed = nil end
@@ -330,27 +426,43 @@ downloads.add_signal("status-tick", function (running)
             local last, curr = rawget(data, "last_size") or 0, d.current_size
             rawset(data, "speed", curr - last)
             rawset(data, "last_size", curr)
+            queue_update("progress", data.id,
+                collate_download_data(d, data, progress_filter))
         end
     end
+end)
 
-    -- Update all download pages when a change occurrs
-    for _, w in pairs(window.bywidget) do
-        for _, v in ipairs(w.tabs.children) do
-            if string.match(v.uri or "", "^luakit://downloads/?") then
-                v:eval_js(update_list_js, { no_return = true })
-            end
+downloads.add_signal("removed-download", function (d, data)
+    announced[d] = nil
+    if data then queue_update("removed", data.id) end
+end)
+
+downloads.add_signal("cleared-downloads", function ()
+    local all = downloads.get_all()
+    for d, id in pairs(announced) do
+        if not all[d] then
+            announced[d] = nil
+            queue_update("removed", id)
         end
     end
 end)
 
 chrome.add("downloads", function ()
     local html_subs = {
-        style  = chrome.stylesheet .. _M.stylesheet,
+        link   = chrome.stylesheet_link(),
+        style  = _M.stylesheet,
     }
     local html = string.gsub(html_template, "{(%w+)}", html_subs)
     return html
 end,
 function (view)
+    -- Start pushing updates to this view until it navigates away
+    if not pages[view] then
+        pages[view] = true
+        view:add_signal("load-status", leave_page)
+        view:add_signal("destroy", forget_page)
+    end
+
     -- Load jQuery JavaScript library
     local jquery = lousy.load("lib/jquery.min.js")
     view:eval_js(jquery, { no_return = true })
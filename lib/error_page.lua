@@ -341,7 +341,8 @@ webview.add_signal("init", function (view)
             -- Update view history table
             local vs = view_state[v]
             if vs and not vs.is_error_page then
-                vs.history[v.history.index] = nil
+                local load = ...
+                vs.history[load.history_index] = nil
             end
         elseif status == "failed" then
             handle_error(v, ...)
@@ -138,8 +138,14 @@ local function follow_func_cb(w, ret)
     ignore_keys(w)
 end
 
-local function matches_cb(w, n)
-    w:set_ibar_theme(n > 0 and "ok" or "error")
+-- Callback for the number of hints matching in the current view
+local function matches_cb(w)
+    local view = w.view
+    return function (ok, n)
+        if ok and w.view == view then
+            w:set_ibar_theme(n > 0 and "ok" or "error")
+        end
+    end
 end
 
 follow_wm:add_signal("follow_func", function(_, page_id, ret)
@@ -147,11 +153,6 @@ follow_wm:add_signal("follow_func", function(_, page_id, ret)
         if w.view.id == page_id then follow_func_cb(w, ret) end
     end
 end)
-follow_wm:add_signal("matches", function(_, page_id, n)
-    for _, w in pairs(window.bywidget) do
-        if w.view.id == page_id then matches_cb(w, n) end
-    end
-end)
 follow_wm:add_signal("click_a_target_blank", function(_, page_id, href)
     for _, w in pairs(window.bywidget) do
         if w.view.id == page_id then w:new_tab(href) end
@@ -201,7 +202,7 @@ new_mode("follow", {
         -- Cut func out of mode, since we can't send functions
         local func = mode.func
         mode.func = nil
-        follow_wm:emit_signal(w.view, "enter", mode, _M.ignore_case)
+        follow_wm:call(w.view, "enter", mode, _M.ignore_case, {}, matches_cb(w))
         mode.func = func
     end,
 
@@ -212,7 +213,8 @@ new_mode("follow", {
         local pattern_maker = mode.pattern_maker or _M.pattern_maker
         local hint_pat, text_pat = pattern_maker(text)
 
-        follow_wm:emit_signal(w.view, "changed", hint_pat, text_pat, text)
+        follow_wm:call(w.view, "changed", hint_pat, text_pat, text, {},
+            matches_cb(w))
     end,
 
     leave = function (w)
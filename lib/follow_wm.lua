@@ -106,16 +106,16 @@ ui:add_signal("enter", function(_, page, mode, ignore_case)
     page_mode[page] = mode
     select.enter(page, mode.selector, mode.stylesheet, ignore_case)
 
-    local num_visible_hints = #(select.hints(page))
-    ui:emit_signal("matches", page.id, num_visible_hints)
+    -- Reply with the number of visible hints
+    return #(select.hints(page))
 end)
 
 ui:add_signal("changed", function(_, page, hint_pat, text_pat, text)
     local _, num_visible_hints = select.changed(page, hint_pat, text_pat, text)
-    ui:emit_signal("matches", page.id, num_visible_hints)
     if num_visible_hints == 1 and text ~= "" then
         follow(page, false)
     end
+    return num_visible_hints
 end)
 
 ui:add_signal("leave", function (_, page)
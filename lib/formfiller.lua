@@ -222,19 +222,8 @@ local function fill_form_fast(w)
     formfiller_wm:emit_signal(w.view, "fill-fast", form_specs)
 end
 
--- Support for choosing a form with a menu
-local function fill_form_menu(w)
-    local rules = read_formfiller_rules_from_file(w)
-    local form_specs = form_specs_for_uri(rules, w.view.uri)
-    if #form_specs == 0 then
-        w:error("no rules matched")
-        return
-    end
-    formfiller_wm:emit_signal(w.view, "filter", form_specs)
-end
-
-formfiller_wm:add_signal("filter", function (_, view_id, form_specs)
-    local w = w_from_view_id(view_id)
+-- Show a menu of the form specs that matched the current page
+local function show_form_menu(w, form_specs)
     -- Build menu
     local menu = {}
     for _, form in ipairs(form_specs) do
@@ -248,7 +237,21 @@ formfiller_wm:add_signal("filter", function (_, view_id, form_specs)
     else
         w:set_mode("formfiller-menu", menu)
     end
-end)
+end
+
+-- Support for choosing a form with a menu
+local function fill_form_menu(w)
+    local rules = read_formfiller_rules_from_file(w)
+    local form_specs = form_specs_for_uri(rules, w.view.uri)
+    if #form_specs == 0 then
+        w:error("no rules matched")
+        return
+    end
+    local view = w.view
+    formfiller_wm:call(view, "filter", form_specs, {}, function (ok, matching)
+        if ok and w.view == view then show_form_menu(w, matching) end
+    end)
+end
 
 webview.add_signal("init", function (view)
     view:add_signal("load-status", function (v, status)
@@ -301,7 +301,7 @@ ui:add_signal("filter", function (_, page, form_specs)
             matching_form_specs[#matching_form_specs+1] = form_spec
         end
     end
-    ui:emit_signal("filter", page.id, matching_form_specs)
+    return matching_form_specs
 end)
 
 -- vim: et:sw=4:ts=8:sts=4:tw=80
@@ -13,6 +13,7 @@ local markdown = require("markdown")
 local editor = require("editor")
 local get_modes = require("modes").get_modes
 local add_cmds = require("binds").add_cmds
+local lazy = require("lazy")
 
 local _M = {}
 
@@ -22,8 +23,8 @@ local html_template = [==[
 <head>
     <meta charset="utf-8">
     <title>Luakit Introspector</title>
+    {link}
     <style type="text/css">
-        {style}
         body {
             background-color: white;
             color: black;
@@ -188,9 +189,7 @@ local html_template = [==[
     <div class="content-margin">
         {sections}
     </div>
-    <script>
-        {jquery}
-    </script>
+    <script src="luakit://asset/jquery.min.js"></script>
     <script>
         {javascript}
     </script>
@@ -267,6 +266,9 @@ local function function_source_range(_, info)
 end
 
 local help_get_modes = function ()
+    -- Make sure bindings of lazily loaded modules are listed
+    lazy.load_all()
+
     local ret = {}
     local modes = lousy.util.table.values(get_modes())
     table.sort(modes, function (a, b) return a.order < b.order end)
@@ -302,6 +304,9 @@ local help_get_modes = function ()
     return ret
 end
 
+chrome.add_asset("asset/jquery.min.js", lousy.load("lib/jquery.min.js"),
+    "application/javascript")
+
 chrome.add("help", function ()
     local sections = {}
     local modes = help_get_modes()
@@ -326,9 +331,8 @@ chrome.add("help", function ()
     local sections_html = table.concat(sections, "\n")
     local html_subs = {
         sections = sections_html,
-        style  = chrome.stylesheet,
+        link = chrome.stylesheet_link(),
         javascript = main_js,
-        jquery = lousy.load("lib/jquery.min.js")
     }
     local html = string.gsub(html_template, "{(%w+)}", html_subs)
     return html
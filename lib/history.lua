@@ -100,13 +100,11 @@ end
 
 webview.add_signal("init", function (view)
     -- Add items & update visit count
-    view:add_signal("load-status", function (_, status)
+    view:add_signal("load-status", function (_, status, load)
+        if status ~= "committed" then return end
         -- Don't add history items when in private browsing mode
         if view.enable_private_browsing then return end
-
-        if status == "committed" then
-            _M.add(view.uri)
-        end
+        _M.add(load.uri)
     end)
     -- Update titles
     view:add_signal("property::title", function ()
@@ -87,6 +87,7 @@ local html_template = [==[
 <head>
     <meta charset="utf-8">
     <title>History</title>
+    {%link}
     <style type="text/css">
         {%stylesheet}
     </style>
@@ -386,8 +387,8 @@ local export_funcs = {
 
 chrome.add("history", function ()
     local html = string.gsub(html_template, "{%%(%w+)}", {
-        -- Merge common chrome stylesheet and history stylesheet
-        stylesheet = chrome.stylesheet .. _M.stylesheet
+        link = chrome.stylesheet_link(),
+        stylesheet = _M.stylesheet,
     })
     return html
 end,
@@ -45,12 +45,12 @@ webview.add_signal("init", function (view)
     local top_level = {}
     local uri_mime_cache = {}
 
-    view:add_signal("load-status", function (v, status)
+    view:add_signal("load-status", function (v, status, load)
         if status == "provisional" then
             top_level[v] = true
         elseif status == "committed" then
             top_level[v] = nil
-            local mime = uri_mime_cache[v.uri]
+            local mime = uri_mime_cache[load.uri]
             local is_image = mime and mime:match("^image/")
             view.stylesheets[_M.stylesheet] = is_image
             if is_image then
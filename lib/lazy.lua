@@ -0,0 +1,164 @@
+--- Load modules on first use.
+--
+-- Many modules only do something once one of their chrome pages is
+-- visited, or one of their bindings or commands is used. Instead of loading
+-- such a module at startup, `lazy.require()` installs stub chrome pages,
+-- bindings and commands for the entry points listed in the module's
+-- manifest. The first time one of the stubs is used, all of them are
+-- removed, the module is loaded, and the matching real entry point is
+-- called in place of the stub.
+--
+-- Modules without a manifest are loaded immediately.
+--
+-- @module lazy
+-- @copyright 2017 Aidan Holm
+
+local lousy = require("lousy")
+local chrome = require("chrome")
+local modes = require("modes")
+local add_binds = require("binds").add_binds
+
+local _M = {}
+
+--- Entry points of modules that can be loaded on first use.
+--
+-- Each manifest lists the chrome pages, commands, and bindings (by mode)
+-- that the module adds. Bindings are given as `{ "key", mods, key }` or
+-- `{ "buf", pattern }`.
+--
+-- @type table
+_M.manifest = {
+    help_chrome = {
+        chrome = { "help" },
+        cmds = { "help" },
+    },
+    history_chrome = {
+        chrome = { "history" },
+        cmds = { "history" },
+    },
+    bookmarks_chrome = {
+        chrome = { "bookmarks" },
+        cmds = { "bookmarks", "bookmark" },
+        binds = { normal = {
+            { "key", {}, "B" }, { "buf", "^gb$" }, { "buf", "^gB$" },
+        }},
+    },
+    memory_chrome = {
+        chrome = { "memory" },
+        cmds = { "memory" },
+    },
+    downloads_chrome = {
+        chrome = { "downloads" },
+        cmds = { "downloads" },
+        binds = { normal = { { "buf", "^gd$" }, { "buf", "^gD$" } } },
+    },
+}
+
+-- Stub bindings of modules that have not been loaded yet, by module name
+-- and then by mode name
+local pending = {}
+
+local function same_bind(stub, b)
+    if stub.type ~= b.type then return false end
+    if b.type == "key" then return stub.key == b.key and stub.mods == b.mods end
+    if b.type == "buffer" then return stub.pattern == b.pattern end
+    if b.type == "command" then return lousy.util.table.hasitem(b.cmds, stub.cmds[1]) end
+    return false
+end
+
+local function remove_stubs(stubs)
+    for mode_name, mode_stubs in pairs(stubs) do
+        local mode = modes.get_mode(mode_name)
+        local binds = mode and mode.binds or {}
+        for i = #binds, 1, -1 do
+            if mode_stubs[binds[i]] then table.remove(binds, i) end
+        end
+    end
+end
+
+--- Load a module that was registered with `lazy.require()`.
+-- Does nothing if the module is already loaded.
+-- @tparam string name The name of the module.
+-- @return The module.
+function _M.load(name)
+    local stubs = pending[name]
+    if stubs then
+        pending[name] = nil
+        remove_stubs(stubs)
+        msg.verbose("loading module '%s' on first use", name)
+    end
+    return require(name)
+end
+
+--- Load all modules that have not been used yet.
+function _M.load_all()
+    local names = lousy.util.table.keys(pending)
+    for _, name in ipairs(names) do _M.load(name) end
+end
+
+local function new_stub(name, mode_name, spec)
+    local stub
+    local func = function (...)
+        _M.load(name)
+        local mode = modes.get_mode(mode_name)
+        for _, b in ipairs(mode and mode.binds or {}) do
+            if same_bind(stub, b) then return b.func(...) end
+        end
+        return false
+    end
+
+    local bind = lousy.bind
+    if spec[1] == "key" then
+        stub = bind.key(spec[2], spec[3], func)
+    elseif spec[1] == "buf" then
+        stub = bind.buf(spec[2], func)
+    elseif spec[1] == "cmd" then
+        stub = bind.cmd(spec[2], func)
+    else
+        error("invalid binding in manifest of module '" .. name .. "'")
+    end
+    return stub
+end
+
+--- Load a module on first use.
+--
+-- If the module has a manifest, stubs for its entry points are installed,
+-- and the module is loaded when one of them is first used. Otherwise, the
+-- module is loaded immediately.
+--
+-- @tparam string name The name of the module.
+function _M.require(name)
+    local manifest = _M.manifest[name]
+    if package.loaded[name] or pending[name] or not manifest then
+        if not pending[name] then require(name) end
+        return
+    end
+
+    local binds = lousy.util.table.clone(manifest.binds or {})
+    if manifest.cmds then
+        local cmds = {}
+        for _, cmd in ipairs(manifest.cmds) do cmds[#cmds+1] = { "cmd", cmd } end
+        binds.command = cmds
+    end
+
+    local stubs = {}
+    for mode_name, specs in pairs(binds) do
+        local mode_stubs, list = {}, {}
+        for _, spec in ipairs(specs) do
+            local stub = new_stub(name, mode_name, spec)
+            mode_stubs[stub] = true
+            list[#list+1] = stub
+        end
+        stubs[mode_name] = mode_stubs
+        add_binds(mode_name, list)
+    end
+    pending[name] = stubs
+
+    for _, page in ipairs(manifest.chrome or {}) do
+        chrome.add_loader(page, function () _M.load(name) end)
+    end
+end
+
+return _M
+
+-- vim: et:sw=4:ts=8:sts=4:tw=80
@@ -7,8 +7,9 @@
 -- @copyright 2008-2009 Damien Leone, Julien Danjou, 2010 Mason Larobina
 
 local util = require "lousy.util"
+local capi = { luakit = luakit }
 
-local theme
+local theme, raw_theme
 
 local _M = {}
 
@@ -34,6 +35,79 @@ local default_theme = {
     font = "9px monospace",
 }
 
+--- Style rules compiled into the application stylesheet.
+--
+-- Each rule is a CSS selector and a table mapping CSS properties to theme
+-- keys. Widgets take on these styles by adding the matching style classes,
+-- rather than setting colours and fonts individually.
+-- @type table
+_M.rules = {
+    { ".tablist", { ["background-color"] = "tab_list_bg" } },
+    { ".tab", { ["background-color"] = "tab_bg" } },
+    { ".tab label", { color = "tab_fg", font = "tab_font" } },
+    { ".tab.selected", { ["background-color"] = "tab_selected_bg" } },
+    { ".tab.selected label", { color = "tab_selected_fg" } },
+    { ".tab.hover", { ["background-color"] = "tab_hover_bg" } },
+    { ".sbar-buf", { color = "buf_sbar_fg", font = "buf_sbar_font" } },
+    { ".sbar-hist", { color = "hist_sbar_fg", font = "hist_sbar_font" } },
+    { ".sbar-progress", { color = "sbar_loaded_fg", font = "sbar_loaded_font" } },
+    { ".sbar-scroll", { color = "scroll_sbar_fg", font = "scroll_sbar_font" } },
+    { ".sbar-ssl", { color = "ssl_sbar_fg", font = "ssl_sbar_font" } },
+    { ".sbar-ssl.trust", { color = "trust_fg" } },
+    { ".sbar-ssl.notrust", { color = "notrust_fg" } },
+    { ".sbar-tabi", { color = "tabi_sbar_fg", font = "tabi_sbar_font" } },
+    { ".sbar-uri", { color = "uri_sbar_fg", font = "uri_sbar_font" } },
+}
+
+--- Compile the style rules into a CSS stylesheet.
+-- @tparam[opt] table t The theme table to use. Defaults to the current theme.
+-- @treturn string The stylesheet.
+function _M.compile(t)
+    t = t or theme
+    local css = {}
+    for _, rule in ipairs(_M.rules) do
+        local selector, props = rule[1], rule[2]
+        local decls = {}
+        for prop, key in pairs(props) do
+            local value = t[key]
+            if value then decls[#decls+1] = prop .. ": " .. value .. ";" end
+        end
+        if #decls > 0 then
+            table.sort(decls)
+            css[#css+1] = selector .. " { " .. table.concat(decls, " ") .. " }"
+        end
+    end
+    return table.concat(css, "\n")
+end
+
+--- Compile the current theme and install it as the application stylesheet.
+-- Nothing is restyled if the stylesheet is unchanged.
+-- @treturn boolean Whether the stylesheet changed.
+function _M.apply()
+    if not theme or not capi.luakit.set_theme_css then return false end
+    return capi.luakit.set_theme_css(_M.compile())
+end
+
+-- Fill the theme table from the raw theme values, dropping cached lookups
+local function rebuild()
+    for k in pairs(theme) do theme[k] = nil end
+    for k, v in pairs(raw_theme) do theme[k] = v end
+end
+
+--- Change theme values and restyle all widgets.
+--
+-- The theme table is updated in place, so references obtained from
+-- `get()` remain valid. Widgets styled through style classes are restyled
+-- with a single stylesheet update.
+-- @tparam table values The theme values to change.
+function _M.update(values)
+    assert(theme, "no theme loaded")
+    assert(type(values) == "table", "values must be a table")
+    for k, v in pairs(values) do raw_theme[k] = v end
+    rebuild()
+    _M.apply()
+end
+
 --- Load the theme table from file.
 -- @param path The filepath of the theme.
 function _M.init(path)
@@ -49,7 +123,10 @@ function _M.init(path)
         return error("error loading theme: not a table")
     end
     -- Merge with defaults and set metatable
-    theme = setmetatable(util.table.join(default_theme, theme), { __index = index })
+    raw_theme = util.table.join(default_theme, theme)
+    theme = setmetatable({}, { __index = index })
+    rebuild()
+    _M.apply()
     return theme
 end
 
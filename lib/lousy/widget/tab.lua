@@ -44,14 +44,17 @@ local function update_label(tl)
     label.text = title
 end
 
+-- Tab colours and fonts come from the theme stylesheet; tabs only toggle
+-- style classes, see `lousy.theme.rules`.
+local function set_class(w, class, enabled)
+    if enabled then w:add_class(class) else w:remove_class(class) end
+end
+
 local function set_current(tl, current)
-    local theme = get_theme()
-    local ebox = tl.widget
     local priv = data[tl]
-    local label = priv.label
+    if priv.current == current then return end
     priv.current = current
-    label.fg = (priv.current and theme.tab_selected_fg) or theme.tab_fg
-    ebox.bg = (priv.current and theme.tab_selected_bg) or theme.tab_bg
+    set_class(tl.widget, "selected", current)
     update_label(tl)
 end
 
@@ -87,10 +90,9 @@ local function new(view, index)
         no_title = false,
     }
 
-    local theme = get_theme()
     local label = data[tl].label
     tl.widget.child = label
-    label.font = theme.tab_font
+    tl.widget:add_class("tab")
     label.align = { x = 0 }
     label.margin_left = 10
     label.margin_right = 10
@@ -110,15 +112,14 @@ local function new(view, index)
     end)
 
     tl.widget:add_signal("mouse-enter", function (t)
-        t.bg = theme.tab_hover_bg
+        t:add_class("hover")
     end)
     tl.widget:add_signal("mouse-leave", function (t)
-        t.bg = (data[tl].current and theme.tab_selected_bg) or theme.tab_bg
+        t:remove_class("hover")
     end)
 
     -- Set new title
     update_title_and_label(tl)
-    set_current(tl, false)
 
     -- Setup metatable interface
     setmetatable(tl, {
@@ -5,7 +5,6 @@
 -- @copyright 2010 Mason Larobina
 
 local signal = require "lousy.signal"
-local get_theme = require("lousy.theme").get
 local capi = { widget = widget, luakit = luakit, }
 local tab = require "lousy.widget.tab"
 
@@ -77,6 +76,21 @@ local function regenerate_tab_indices(tlist, a, b)
     end
 end
 
+-- Stop updating tab indices and tablist visibility when tabs are removed,
+-- until thaw() is called. Used when removing many tabs at once.
+local function freeze(tlist)
+    data[tlist].frozen = true
+end
+
+-- Resume updates after freeze(), and bring the tablist up to date
+local function thaw(tlist)
+    local d = data[tlist]
+    if not d.frozen then return end
+    d.frozen = false
+    regenerate_tab_indices(tlist)
+    d.update_visibility()
+end
+
 --- Create a new tablist widget connected to a given notebook widget.
 --
 -- `orientation` should be one of `"horizontal"` or `"vertical"`.
@@ -92,11 +106,12 @@ function _M.new(notebook, orientation)
     local tlist = {
         widget  = capi.widget{type = "scrolled"},
         destroy = destroy,
+        freeze  = freeze,
+        thaw    = thaw,
     }
 
     local box = capi.widget{type = orientation == "horizontal" and "hbox" or "vbox"}
-    local theme = get_theme()
-    box.bg = theme.tab_list_bg
+    box:add_class("tablist")
     tlist.widget.child = box
 
     -- Hide scrollbar on horizontal tablist, since it covers the tabs
@@ -140,8 +155,8 @@ function _M.new(notebook, orientation)
         local tl = data[tlist].tabs[view]
         box:remove(tl.widget)
         tl:destroy()
-        regenerate_tab_indices(tlist)
         data[tlist].tabs[view] = nil
+        if not data[tlist].frozen then regenerate_tab_indices(tlist) end
     end)
 
     notebook:add_signal("switch-page", function (_, view)
@@ -167,10 +182,13 @@ function _M.new(notebook, orientation)
     end)
 
     local function update_tablist_visibility()
+        if data[tlist].frozen then return end
         if tlist.visible and notebook:count() >= 2 then tlist.widget:show() end
         if not tlist.visible or notebook:count() < 2 then tlist.widget:hide() end
     end
 
+    data[tlist].update_visibility = update_tablist_visibility
+
     -- Show tablist widget if there is more than one tab
     notebook:add_signal("page-added", update_tablist_visibility)
     notebook:add_signal("page-removed", update_tablist_visibility)
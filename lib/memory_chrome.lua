@@ -0,0 +1,205 @@
+--- Memory usage - chrome page.
+--
+-- This module provides [luakit://memory/](luakit://memory/), a page that
+-- shows the memory used by the UI process and each web process, the size
+-- of the Lua heap in each of them, SQLite page cache usage per database,
+-- and the number of entries in major Lua tables. The page refreshes itself
+-- while it is open.
+--
+-- @module memory_chrome
+-- @copyright 2017 Aidan Holm
+
+local chrome = require("chrome")
+local lousy = require("lousy")
+local add_cmds = require("binds").add_cmds
+
+local _M = {}
+
+--- Interval between refreshes of open memory pages, in milliseconds.
+-- @type number
+_M.refresh_interval = 3000
+
+local html_template = [==[
+<!doctype html>
+<html>
+<head>
+    <meta charset="utf-8">
+    <title>Memory</title>
+    {link}
+    <style type="text/css">
+        {style}
+    </style>
+</head>
+<body>
+    <header id="page-header">
+        <h1>Memory</h1>
+    </header>
+    <div id="stats" class="content-margin">{stats}</div>
+</body>
+</html>
+]==]
+
+--- CSS for memory chrome page.
+-- @type string
+_M.stylesheet = [==[
+    h2 {
+        font-size: 1.4em;
+        margin: 1.5em 0 0.5em 0;
+    }
+
+    table {
+        border-collapse: collapse;
+        font-size: 1.2em;
+    }
+
+    th, td {
+        text-align: left;
+        padding: 0.2em 1.5em 0.2em 0;
+        vertical-align: top;
+    }
+
+    td.size {
+        text-align: right;
+        font-family: monospace;
+    }
+
+    .views {
+        color: #888;
+    }
+]==]
+
+local escape = lousy.util.escape
+
+local function size(kb)
+    if not kb then return "&ndash;" end
+    if kb < 1024 then return string.format("%d kB", kb) end
+    return string.format("%.1f MB", kb / 1024)
+end
+
+local function row(cells)
+    return "<tr>" .. table.concat(cells) .. "</tr>"
+end
+
+local function process_row(name, p)
+    return row {
+        "<td>", name, "</td>",
+        "<td>", tostring(p.pid), "</td>",
+        "<td class=size>", size(p.rss_kb), "</td>",
+        "<td class=size>", size(p.pss_kb), "</td>",
+        "<td class=size>", size(p.lua_kb), "</td>",
+    }
+end
+
+local function render_stats()
+    local stats = luakit.memory_stats()
+    local html = {}
+    local function add(s) html[#html+1] = s end
+
+    add("<h2>Processes</h2><table>")
+    add("<tr><th>Process</th><th>PID</th><th>RSS</th><th>PSS</th><th>Lua heap</th></tr>")
+    add(process_row("UI", stats.ui))
+    table.sort(stats.web_processes, function (a, b) return a.pid < b.pid end)
+    for _, p in ipairs(stats.web_processes) do
+        add(process_row("Web", p))
+        local uris = {}
+        for _, view in ipairs(p.views) do
+            uris[#uris+1] = escape(view.uri or "about:blank")
+        end
+        add(row { "<td></td><td class=views colspan=4>", table.concat(uris, "<br>"), "</td>" })
+    end
+    add("</table>")
+
+    add("<h2>SQLite</h2><table>")
+    add("<tr><th>Database</th><th>Page cache</th><th>Schema</th><th>Statements</th></tr>")
+    for _, db in ipairs(stats.sqlite.handles) do
+        add(row {
+            "<td>", escape(db.filename), "</td>",
+            "<td class=size>", size(db.cache_kb), "</td>",
+            "<td class=size>", size(db.schema_kb), "</td>",
+            "<td class=size>", size(db.stmt_kb), "</td>",
+        })
+    end
+    add(row { "<td>Total</td><td class=size>", size(stats.sqlite.memory_used_kb), "</td>" })
+    add("</table>")
+
+    add("<h2>Lua tables</h2><table>")
+    add("<tr><th>Table</th><th>Entries</th></tr>")
+    for _, name in ipairs({ "registry", "objects", "globals", "modules" }) do
+        add(row { "<td>", name, "</td><td class=size>", tostring(stats.tables[name]), "</td>" })
+    end
+    local names = {}
+    for name in pairs(stats.tables.registry_tables) do names[#names+1] = name end
+    table.sort(names)
+    for _, name in ipairs(names) do
+        add(row { "<td>", escape(name), "</td><td class=size>",
+            tostring(stats.tables.registry_tables[name]), "</td>" })
+    end
+    add("</table>")
+
+    return table.concat(html)
+end
+
+local function js_string(s)
+    s = string.gsub(s, "[%c\\\"<]", function (c)
+        return string.format("\\u%04x", string.byte(c))
+    end)
+    return '"' .. s .. '"'
+end
+
+-- Open luakit://memory pages
+local pages = setmetatable({}, { __mode = "k" })
+local refresh_timer = timer{ interval = _M.refresh_interval }
+
+local function forget_page(view)
+    pages[view] = nil
+    view:remove_signal("destroy", forget_page)
+end
+
+refresh_timer:add_signal("timeout", function ()
+    for view in pairs(pages) do
+        if not string.match(view.uri or "", "^luakit://memory/?") then
+            forget_page(view)
+        end
+    end
+    if not next(pages) then
+        refresh_timer:stop()
+        return
+    end
+    local js = "document.getElementById('stats').innerHTML = "
+        .. js_string(render_stats()) .. ";"
+    for view in pairs(pages) do
+        view:eval_js(js, { no_return = true })
+    end
+end)
+
+chrome.add("memory", function ()
+    local html_subs = {
+        link = chrome.stylesheet_link(),
+        style = _M.stylesheet,
+        stats = render_stats(),
+    }
+    return (string.gsub(html_template, "{(%w+)}", html_subs))
+end,
+function (view)
+    if not pages[view] then
+        pages[view] = true
+        view:add_signal("destroy", forget_page)
+    end
+    if not refresh_timer.started then
+        refresh_timer.interval = _M.refresh_interval
+        refresh_timer:start()
+    end
+end)
+
+--- URI of the memory chrome page.
+-- @type string
+_M.chrome_page = "luakit://memory/"
+
+add_cmds({
+    lousy.bind.cmd("memory", "Open [luakit://memory/](luakit://memory/) in a new tab.",
+        function (w) w:new_tab(_M.chrome_page) end),
+})
+
+return _M
+
+-- vim: et:sw=4:ts=8:sts=4:tw=80
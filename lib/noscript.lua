@@ -161,7 +161,7 @@ window.add_signal("init", function (w)
 end)
 
 webview.add_signal("init", function (view)
-    view:add_signal("load-status", function (v, status)
+    view:add_signal("load-status", function (v, status, load)
         if status == "provisional" or status == "redirected" then
             local es = v:emit_signal("enable-scripts")
             local ep = v:emit_signal("enable-plugins")
@@ -170,7 +170,7 @@ webview.add_signal("init", function (view)
                 enable_plugins_domain = ep and "override" or nil,
             }
             if es == nil or ep == nil then
-                local s, p, matched_domain = lookup_domain(v.uri)
+                local s, p, matched_domain = lookup_domain(load.uri)
                 if es == nil then es = s; vns.enable_scripts_domain = matched_domain end
                 if ep == nil then ep = p; vns.enable_plugins_domain = matched_domain end
             end
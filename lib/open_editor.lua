@@ -1,64 +1,202 @@
 --- Edit the contents of text inputs in an external editor.
 --
+-- The contents of the focused input are written to a file, which is opened
+-- in an external editor. While the editor is open, the input is read-only,
+-- and changes saved in the editor are copied to it shortly after each save.
+--
+-- The edit session ends when the editor command exits. Commands that return
+-- straight away, such as `xdg-open`, hand the file to an editor process
+-- that luakit can't wait for; in that case the session ends when the
+-- editor removes the lock or swap file it keeps next to the edited file.
+-- Many editors keep no such file; pressing `Control-e` in the input again
+-- ends the session. Sessions also end when the page is navigated away from
+-- or closed.
+--
 -- @module open_editor
+-- @copyright 2017 Aidan Holm
 
 local lousy = require "lousy"
+local lfs = require "lfs"
 local binds = require("binds")
 local add_binds = binds.add_binds
 
+local wm = require_web_module("open_editor_wm")
+
 local _M = {}
 
-local function edit_externally(w)
-    local time = os.time()
-    local marker = "luakit_extedit_" .. time
-    local file = luakit.cache_dir .. "/" .. marker .. ".txt"
-
-    local function editor_callback()
-        local f = io.open(file, "r")
-        local s = f:read("*all")
-        f:close()
-        os.remove(file)
-        -- Strip the string
-        s = s:gsub("^%s*(.-)%s*$", "%1")
-        -- Escape it but remove the quotes
-        s = string.format("%q", s):sub(2, -2)
-        -- lua escaped newlines (slash+newline) into js newlines (slash+n)
-        s = s:gsub("\\\n", "\\n")
-        w.view:eval_js(string.format([=[
-            var e = document.getElementsByClassName('%s');
-            if (1 == e.length && e[0].disabled) {
-                e[0].focus();
-                e[0].value = "%s";
-                e[0].disabled = false;
-                e[0].className = e[0].className.replace(/\b %s\b/,'');
-            }
-        ]=], marker, s, marker), { no_return = true })
+--- The command used to open the editor. `{file}` is replaced with the
+-- quoted path of the file to edit.
+-- @type string
+-- @readwrite
+_M.editor_cmd = "xdg-open {file}"
+
+--- Delay in milliseconds between the last change to the file and copying
+-- its contents to the input.
+-- @type number
+-- @readwrite
+_M.update_delay = 150
+
+--- Editor commands that exit within this many milliseconds are assumed to
+-- have handed the file to another process.
+-- @type number
+-- @readwrite
+_M.fork_threshold = 1000
+
+--- Lua patterns matching the names of lock and swap files that editors
+-- keep next to the file being edited.
+-- @type {string}
+-- @readwrite
+_M.lock_patterns = { "^%..+%.sw.$", "^%.#", "^#.+#$" }
+
+-- Active edit sessions, by id
+local sessions = {}
+local next_id = 0
+
+local function read_file(path)
+    local f = io.open(path, "r")
+    if not f then return end
+    local s = f:read("*all")
+    f:close()
+    -- Strip the string
+    return (s:gsub("^%s*(.-)%s*$", "%1"))
+end
+
+-- Quote a string for the shell
+local function shell_quote(s)
+    return "'" .. string.gsub(s, "'", "'\\''") .. "'"
+end
+
+local function is_lock_file(path)
+    local name = string.match(path, "[^/]+$")
+    for _, pat in ipairs(_M.lock_patterns) do
+        if string.match(name, pat) then return true end
+    end
+    return false
+end
+
+-- Copy the file contents to the input, if they changed
+local function update(s)
+    s.timer:stop()
+    local text = read_file(s.file)
+    if not text or text == s.text then return end
+    s.text = text
+    wm:emit_signal(s.view, "update", s.id, text)
+end
+
+local function finish(s)
+    if not sessions[s.id] then return end
+    sessions[s.id] = nil
+    s.timer:stop()
+    luakit.unwatch_file(s.watch)
+    s.view:remove_signal("load-status", s.on_load_status)
+    s.view:remove_signal("destroy", s.on_destroy)
+
+    if not s.destroyed then
+        local text = read_file(s.file)
+        wm:emit_signal(s.view, "finish", s.id, text)
+    end
+    os.remove(s.file)
+    for name in lfs.dir(s.dir) do
+        if is_lock_file(name) then os.remove(s.dir .. "/" .. name) end
+    end
+    lfs.rmdir(s.dir)
+end
+
+local function on_file_event(s, event, path)
+    if not sessions[s.id] then return end
+    if path == s.file then
+        if event ~= "deleted" then
+            -- Debounce updates, so that each save is read once
+            s.timer:stop()
+            s.timer:start()
+        end
+    elseif is_lock_file(path) then
+        if event == "created" then
+            s.locks[path] = true
+            s.had_lock = true
+        elseif event == "deleted" and s.locks[path] then
+            s.locks[path] = nil
+            if s.forked and not next(s.locks) then finish(s) end
+        end
+    end
+end
+
+local function start_session(w, view, id, text)
+    local dir = string.format("%s/extedit-%d-%d", luakit.cache_dir, os.time(), id)
+    local ok, err = lfs.mkdir(dir)
+    if not ok then
+        wm:emit_signal(view, "finish", id)
+        return w:error("Unable to edit externally: " .. tostring(err))
     end
 
-    w.view:eval_js(string.format([=[
-        var e = document.activeElement;
-        if (e && ('TEXTAREA' === e.tagName || 'text' === e.type)) {
-            var s = e.value;
-            e.className += " %s";
-            e.disabled = true;
-            e.value = 'Editing externally...';
-            s;
-        } else 'false';
-    ]=], marker, file), { callback = function(s)
-        if "false" ~= s then
-            local f = io.open(file, "w")
-            f:write(s)
-            f:flush()
-            f:close()
-            local c = string.format("xdg-open %s", file)
-            luakit.spawn(c, editor_callback)
+    local s = {
+        id = id, view = view, dir = dir, file = dir .. "/input.txt",
+        text = text, locks = {},
+        timer = timer{ interval = _M.update_delay },
+    }
+    local f = io.open(s.file, "w")
+    f:write(text)
+    f:close()
+
+    s.timer:add_signal("timeout", function () update(s) end)
+    s.on_load_status = function (_, status)
+        if status == "provisional" then finish(s) end
+    end
+    s.on_destroy = function ()
+        s.destroyed = true
+        finish(s)
+    end
+    view:add_signal("load-status", s.on_load_status)
+    view:add_signal("destroy", s.on_destroy)
+    s.watch = luakit.watch_file(dir, function (event, path)
+        on_file_event(s, event, path)
+    end)
+    sessions[id] = s
+
+    local started = luakit.time()
+    local cmd = string.gsub(_M.editor_cmd, "{file}", function ()
+        return shell_quote(s.file)
+    end)
+    ok, err = pcall(luakit.spawn, cmd, function ()
+        if (luakit.time() - started) * 1000 < _M.fork_threshold then
+            -- The editor runs in another process
+            s.forked = true
+            if s.had_lock and not next(s.locks) then finish(s) end
+        else
+            finish(s)
+        end
+    end)
+    if not ok then
+        finish(s)
+        w:error("Unable to start editor: " .. tostring(err))
+    end
+end
+
+--- Edit the focused text input of a window's current page in an external
+-- editor. If the input is already being edited, the edit session ends
+-- instead.
+-- @tparam table w The window.
+function _M.edit_externally(w)
+    local view = w.view
+    next_id = next_id + 1
+    local id = next_id
+    wm:call(view, "start", id, {}, function (ok, ret)
+        if not ok or not ret then
+            return w:notify("No text input is focused")
+        end
+        -- The id of the input's session, if it is being edited
+        if type(ret) == "number" then
+            local s = sessions[ret]
+            if s then return finish(s) end
+            return wm:emit_signal(view, "finish", ret)
         end
-    end })
+        start_session(w, view, id, ret)
+    end)
 end
 
 local key = lousy.bind.key
 add_binds("insert", {
-    key({"Control"}, "e", "Edit currently focused input in external editor.", edit_externally),
+    key({"Control"}, "e", "Edit currently focused input in external editor.", _M.edit_externally),
 })
 
 return _M
@@ -0,0 +1,50 @@
+-- Edit the contents of text inputs in an external editor - web module.
+--
+-- @submodule open_editor_wm
+-- @copyright 2017 Aidan Holm
+
+local ui = ipc_channel("open_editor_wm")
+
+-- Inputs being edited, by session id
+local elements = {}
+
+local text_input_types = {
+    [""] = true, text = true, search = true, email = true, url = true, tel = true,
+}
+
+local function is_text_input(elem)
+    local tag = elem.tag_name
+    if tag == "TEXTAREA" then return true end
+    return tag == "INPUT" and text_input_types[string.lower(elem.attr.type or "")]
+end
+
+ui:add_signal("start", function (_, page, id)
+    local elem = dom_document(page.id).active_element
+    if not elem then return false end
+    -- If the input is already being edited, return its session id
+    for edit_id, e in pairs(elements) do
+        if e == elem then return edit_id end
+    end
+    if not is_text_input(elem) or elem.attr.readonly then
+        return false
+    end
+    elements[id] = elem
+    elem.attr.readonly = "readonly"
+    return elem.value or ""
+end)
+
+ui:add_signal("update", function (_, _, id, text)
+    local elem = elements[id]
+    if elem then elem.value = text end
+end)
+
+ui:add_signal("finish", function (_, _, id, text)
+    local elem = elements[id]
+    if not elem then return end
+    elements[id] = nil
+    if text then elem.value = text end
+    elem.attr.readonly = nil
+    elem:focus()
+end)
+
+-- vim: et:sw=4:ts=8:sts=4:tw=80
@@ -0,0 +1,65 @@
+--- Filter the Referer header of outgoing requests.
+--
+-- By default, the `Referer` header is only sent with requests to the origin
+-- of the current page. The policy can be changed globally, or overridden for
+-- individual domains (and their subdomains):
+--
+--     local referer_control = require "referer_control"
+--     referer_control.set_policy("strict-origin")
+--     referer_control.set_policy("default", "example.com")
+--
+-- The available policies are `"default"`, `"same-origin"`,
+-- `"strict-origin"`, `"origin-only"`, and `"none"`; see
+-- `page.set_referer_policy` for details.
+--
+-- @module referer_control
+-- @copyright 2016 Aidan Holm
+
+local _M = {}
+
+local wm = require_web_module("referer_control_wm")
+
+local policies = {
+    ["default"] = true, ["same-origin"] = true, ["strict-origin"] = true,
+    ["origin-only"] = true, ["none"] = true,
+}
+
+local default_policy = "same-origin"
+local domain_policies = {}
+
+--- Set the Referer policy.
+-- @tparam string|nil policy The policy name. May only be `nil` if `domain`
+-- is given, in which case the override for that domain is removed.
+-- @tparam[opt] string domain Apply the policy only to pages on this domain
+-- and its subdomains.
+function _M.set_policy(policy, domain)
+    assert(domain == nil or type(domain) == "string", "invalid domain")
+    assert((policy == nil and domain) or policies[policy],
+        "invalid referer policy: " .. tostring(policy))
+    if domain then
+        domain = string.lower(domain)
+        domain_policies[domain] = policy
+    else
+        default_policy = policy
+    end
+    wm:emit_signal("set_policy", policy, domain)
+end
+
+--- Get the Referer policy.
+-- @tparam[opt] string domain The domain to get the override for.
+-- @treturn string|nil The policy name.
+function _M.get_policy(domain)
+    if domain then return domain_policies[string.lower(domain)] end
+    return default_policy
+end
+
+luakit.add_signal("web-extension-created", function (view)
+    wm:emit_signal(view, "set_policy", default_policy)
+    for domain, policy in pairs(domain_policies) do
+        wm:emit_signal(view, "set_policy", policy, domain)
+    end
+end)
+
+return _M
+
+-- vim: et:sw=4:ts=8:sts=4:tw=80
@@ -1,25 +1,17 @@
---- Only send Referer header if coming from the same domain - web module.
+-- Filter the Referer header of outgoing requests - web module.
 --
--- @module referer_control_wm
+-- The filtering itself is done natively by the page class; this module only
+-- forwards policy changes from the UI process.
+--
+-- @submodule referer_control_wm
 -- @copyright 2016 Aidan Holm
 
 local _M = {}
 
-local function domain_from_uri(uri)
-    local domain = (uri and string.match(string.lower(uri), "^%a+://([^/]*)/?"))
-    -- Strip leading www. www2. etc
-    domain = string.match(domain or "", "^www%d?%.(.+)") or domain
-    return domain or ""
-end
+local ui = ipc_channel("referer_control_wm")
 
-extension:add_signal("page-created", function(_, page)
-    page:add_signal("send-request", function(p, _, headers)
-        if not headers.Referer then return end
-        if domain_from_uri(p.uri) ~= domain_from_uri(headers.Referer) then
-            msg.verbose("Removing referer '%s'", headers.Referer)
-            headers.Referer = nil
-        end
-    end)
+ui:add_signal("set_policy", function(_, _, policy, domain)
+    page.set_referer_policy(policy, domain)
 end)
 
 return _M
@@ -240,15 +240,29 @@ end
 
 local page_states = {}
 
+-- Hint overlay and label. Compiled templates don't depend on the document
+-- they were compiled with, so the template is compiled on first use and then
+-- shared by all documents
+local hint_spec = {
+    { "span", class = "${overlay_class}", style = "${overlay_style}", ref = "overlay" },
+    { "span", class = "${label_class}", style = "${label_style}", text = "${label}", ref = "label" },
+}
+local hint_tpl
+
+-- The stylesheet is passed as a parameter, so that "${" in user CSS is not
+-- expanded as part of the template
+local frame_spec = {
+    { "div", id = "luakit_select_overlay", ref = "overlay" },
+    { "style", id = "luakit_select_stylesheet", text = "${stylesheet}", ref = "stylesheet" },
+}
+
 local function init_frame(frame, stylesheet)
     assert(frame.doc)
     assert(frame.body)
 
-    frame.overlay = frame.doc:create_element("div", { id = "luakit_select_overlay" })
-    frame.stylesheet = frame.doc:create_element("style", { id = "luakit_select_stylesheet" }, stylesheet)
-
-    frame.body:append(frame.overlay)
-    frame.body:append(frame.stylesheet)
+    local refs = frame.doc:build(frame_spec, { stylesheet = stylesheet }, frame.body)
+    frame.overlay = refs.overlay
+    frame.stylesheet = refs.stylesheet
 end
 
 local function cleanup_frame(frame)
@@ -387,21 +401,26 @@ function _M.enter(page, elements, stylesheet, ignore_case)
     end
 
     for _, frame in ipairs(state.frames) do
-        for _, hint in ipairs(frame.hints) do
-            -- Append hint elements to overlay
+        -- Build all hint elements of the frame, and append them to the
+        -- overlay in a single insertion
+        local params = {}
+        for i, hint in ipairs(frame.hints) do
             local e = hint.elem
             local r = hint.bb
-
-            local overlay_style = string.format("left: %dpx; top: %dpx; width: %dpx; height: %dpx;", r.x, r.y, r.w, r.h)
-            local label_style = string.format("left: %dpx; top: %dpx;", max(r.x-10, 0), max(r.y-10, 0), r.w, r.h)
-
-            local overlay_class = "hint_overlay hint_overlay_" .. e.tag_name
-            local label_class = "hint_label hint_label_" .. e.tag_name
-            hint.overlay_elem = frame.doc:create_element("span", {class = overlay_class, style = overlay_style})
-            hint.label_elem = frame.doc:create_element("span", {class = label_class, style = label_style}, hint.label)
-
-            frame.overlay:append(hint.overlay_elem)
-            frame.overlay:append(hint.label_elem)
+            params[i] = {
+                overlay_style = string.format("left: %dpx; top: %dpx; width: %dpx; height: %dpx;", r.x, r.y, r.w, r.h),
+                label_style = string.format("left: %dpx; top: %dpx;", max(r.x-10, 0), max(r.y-10, 0)),
+                overlay_class = "hint_overlay hint_overlay_" .. e.tag_name,
+                label_class = "hint_label hint_label_" .. e.tag_name,
+                label = hint.label,
+            }
+        end
+        if #params > 0 then
+            hint_tpl = hint_tpl or frame.doc:compile(hint_spec)
+            for i, refs in ipairs(frame.doc:build(hint_tpl, params, frame.overlay)) do
+                frame.hints[i].overlay_elem = refs.overlay
+                frame.hints[i].label_elem = refs.label
+            end
         end
     end
 
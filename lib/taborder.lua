@@ -13,8 +13,6 @@
 -- @module taborder
 -- @copyright 2010 Henrik Hallberg <henrik@k2h.se>
 
-local lousy = require("lousy")
-
 local _M = {}
 
 --- Tab order function: Always insert new tabs before all other tabs.
@@ -40,40 +38,52 @@ _M.before_current = function (w)
     return w.tabs:current()
 end
 
+--- Find the index just after the unbroken chain of descendants of a tab.
+-- Runs in time linear in the number of tabs.
+-- @tparam table w The current window table.
+-- @tparam widget view The ancestor webview widget.
+-- @treturn number The index after the last descendant that directly follows
+-- `view`, or the index after `view` if it has no descendants there.
+_M.after_descendants = function (w, view)
+    local kids = _M.kidsof
+    local tabs = w.tabs
+    local index = tabs:indexof(view)
+    if not index then return tabs:count() + 1 end
+
+    -- Collect all descendants into a set
+    local desc, queue = { [view] = true }, { view }
+    local ii = 1
+    while queue[ii] do
+        for _, kid in ipairs(kids[queue[ii]] or {}) do
+            if not desc[kid] then
+                desc[kid] = true
+                table.insert(queue, kid)
+            end
+        end
+        ii = ii + 1
+    end
+
+    -- Skip over descendants following the ancestor
+    local n = tabs:count()
+    repeat
+        index = index + 1
+    until index > n or not desc[tabs:nth(index)]
+    return index
+end
+
 --- Tab order function: Put new child tab next to the parent after unbroken chain of descendants.
 -- Logical way to use when one "queues" background-followed links.
 -- @tparam table w The current window table.
 -- @tparam widget newview The new webview widget.
 _M.by_origin = function(w, newview)
-    local newindex = 0
     local currentview = w.view
     if not currentview then return 1 end
 
     local kids = _M.kidsof
-    local views = w.tabs.children
+    local newindex
 
     if kids[currentview] then
-        -- Collect all descendants
-        local desc = { currentview }
-        local ii = 1
-        repeat
-            desc = lousy.util.table.join(desc, kids[desc[ii]])
-            ii = ii + 1
-        until ii > #desc
-
-        -- Find the non-descendant closest after current. This is where
-        -- the new tab should be put.
-        for i = #views, 1, -1 do
-            if not lousy.util.table.hasitem(desc, views[i]) then
-                newindex = i
-            end
-            if views[i] == currentview then
-                break
-            end
-        end
-
-        -- There were no non-descendants after current. Put new tab last.
-        if newindex == 0 then newindex = _M.last(w, newview) end
+        newindex = _M.after_descendants(w, currentview)
     else
         kids[currentview] = {}
         newindex = _M.after_current(w, newview)
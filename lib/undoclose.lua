@@ -151,6 +151,9 @@ end)
 window.add_signal("init", function (w)
     w.closed_tabs = {}
     w:add_signal("close-tab", on_tab_close)
+    w:add_signal("close-tabs", function (_, views)
+        for _, view in ipairs(views) do on_tab_close(w, view) end
+    end)
 end)
 
 local key = lousy.bind.key
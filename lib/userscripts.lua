@@ -231,8 +231,8 @@ local function load_all()
     end
 end
 
-local function view_has_userscripts(view)
-    local uri = view.uri or "about:blank"
+local function uri_has_userscripts(uri)
+    uri = uri or "about:blank"
     for _, script in pairs(scripts) do
         if script:match(uri) then
             return true
@@ -241,9 +241,9 @@ local function view_has_userscripts(view)
     return false
 end
 
--- Invoke all userscripts for a given webviews current uri
-local function invoke(view, on_start)
-    local uri = view.uri or "about:blank"
+-- Invoke all userscripts for a given webview and uri
+local function invoke(view, uri, on_start)
+    uri = uri or "about:blank"
     for _, script in pairs(scripts) do
         if on_start == script.on_start then
             if script:match(uri) then
@@ -276,7 +276,7 @@ end
 
 -- Hook on the webview's load-status signal to invoke the userscripts.
 webview.add_signal("init", function (view)
-    view:add_signal("load-status", function (v, status)
+    view:add_signal("load-status", function (v, status, load)
         if status == "provisional" then
             -- Clear last userscript-loaded state
             lstate[v] = { loaded = {}, gmloaded = false }
@@ -284,7 +284,7 @@ webview.add_signal("init", function (view)
 --        elseif status == "first-visual" then
 --            invoke(v, true)
         elseif status == "finished" then
-            if view_has_userscripts(view) then
+            if uri_has_userscripts(load.uri) then
                 if v:emit_signal("enable-userscripts") == false then
                     return
                 end
@@ -292,8 +292,8 @@ webview.add_signal("init", function (view)
             -- WebKit2 has no first-visual signal, so we can't inject
             -- userscripts set to run at document start that way. Just
             -- inject them all when loading has finished for now.
-            invoke(v, true)
-            invoke(v)
+            invoke(v, load.uri, true)
+            invoke(v, load.uri)
         end
     end)
 end)
@@ -8,7 +8,6 @@
 
 local window = require("window")
 local lousy = require("lousy")
-local theme = lousy.theme.get()
 
 local function update (w)
     local buf = w.sbar.r.buf
@@ -28,8 +27,7 @@ window.add_signal("init", function (w)
     r.buf:hide()
 
     -- Set style
-    r.buf.fg = theme.buf_sbar_fg
-    r.buf.font = theme.buf_sbar_font
+    r.buf:add_class("sbar-buf")
 end)
 
 window.methods.update_buf = update
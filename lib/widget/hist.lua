@@ -7,13 +7,16 @@
 -- @copyright 2010 Mason Larobina
 
 local window = require("window")
-local webview = require("webview")
-local lousy = require("lousy")
-local theme = lousy.theme.get()
+local model = require("widget.model")
 
-local function update (w)
+local function update (w, _, _, load)
     local hist = w.sbar.l.hist
-    local back, forward = w.view:can_go_back(), w.view:can_go_forward()
+    local back, forward
+    if load then
+        back, forward = load.can_go_back, load.can_go_forward
+    else
+        back, forward = w.view:can_go_back(), w.view:can_go_forward()
+    end
     local s = (back and "+" or "") .. (forward and "-" or "")
     if s ~= "" then
         hist.text = '['..s..']'
@@ -23,18 +26,8 @@ local function update (w)
     end
 end
 
-webview.add_signal("init", function (view)
-    -- Update widget when current page changes status
-    view:add_signal("load-status", function (v)
-        local w = webview.window(v)
-        if w and w.view == v then
-            update(w)
-        end
-    end)
-    view:add_signal("switched-page", function (v)
-        update(webview.window(v))
-    end)
-end)
+-- Update widget when current page changes status
+model.subscribe({"view", "load-status"}, update)
 
 window.add_signal("init", function (w)
     -- Add widget to window
@@ -44,8 +37,7 @@ window.add_signal("init", function (w)
     l.hist:hide()
 
     -- Set style
-    l.hist.fg = theme.hist_sbar_fg
-    l.hist.font = theme.hist_sbar_font
+    l.hist:add_class("sbar-hist")
 end)
 
 -- vim: et:sw=4:ts=8:sts=4:tw=80
@@ -0,0 +1,156 @@
+--- Shared status bar model.
+--
+-- Status bar widgets are only interested in the current view of each
+-- window. Rather than every widget connecting its own signal handlers to
+-- every webview, widgets subscribe to fields of this model; each window
+-- has a single dispatcher that is connected to its current view only, and
+-- is moved over to the new view when the current tab changes.
+--
+-- The following fields are available:
+--
+-- - `"view"`: the current view of the window changed.
+-- - `"tabs"`: tabs were added, removed or reordered.
+-- - `"uri"`: the URI of the current view changed.
+-- - `"progress"`: the load progress of the current view changed.
+-- - `"load-status"`: the load status of the current view changed.
+-- - `"link-hover"`, `"link-unhover"`: a link was hovered or unhovered.
+-- - `"expose"`: the current view was redrawn.
+--
+-- The `"view"` and `"tabs"` fields are delivered from an idle callback,
+-- so a burst of tab changes results in a single update.
+--
+-- @module widget.model
+-- @copyright 2017 Aidan Holm
+
+local window = require("window")
+
+local _M = {}
+
+-- Webview signal for each view field
+local view_signals = {
+    ["uri"] = "property::uri",
+    ["progress"] = "property::progress",
+    ["load-status"] = "load-status",
+    ["link-hover"] = "link-hover",
+    ["link-unhover"] = "link-unhover",
+    ["expose"] = "expose",
+}
+
+-- Subscriber functions for each field
+local subscribers = {}
+
+-- Dispatcher state for each window
+local states = setmetatable({}, { __mode = "k" })
+
+local function notify(w, field, ...)
+    for _, func in ipairs(subscribers[field] or {}) do
+        func(w, field, ...)
+    end
+end
+
+local function unbind(state)
+    local view = state.view
+    if not view then return end
+    for field, handler in pairs(state.handlers) do
+        view:remove_signal(view_signals[field], handler)
+    end
+    state.view = nil
+end
+
+local function bind(state, view)
+    if state.view == view then return end
+    unbind(state)
+    state.view = view
+    for field, handler in pairs(state.handlers) do
+        view:add_signal(view_signals[field], handler)
+    end
+end
+
+-- Create the dispatcher function for a view field of a window
+local function add_handler(w, state, field)
+    local handler = function (v, ...)
+        if v == state.view then notify(w, field, ...) end
+    end
+    state.handlers[field] = handler
+    if state.view then
+        state.view:add_signal(view_signals[field], handler)
+    end
+end
+
+-- Notify subscribers of the given field from an idle callback
+local function queue(w, state, field)
+    local first = not next(state.pending)
+    state.pending[field] = true
+    if not first then return end
+    luakit.idle_add(function ()
+        local pending = state.pending
+        state.pending = {}
+        -- Cancel if window already destroyed
+        if not w.win or not w.view then return end
+        for _, f in ipairs({"tabs", "view"}) do
+            if pending[f] then notify(w, f) end
+        end
+    end)
+end
+
+--- Subscribe to fields of the status bar model.
+--
+-- The subscriber function is called with the window, the name of the
+-- field that changed, and any arguments of the underlying webview signal.
+--
+-- @tparam table fields A list of field names.
+-- @tparam function func The subscriber function.
+function _M.subscribe(fields, func)
+    assert(type(func) == "function", "subscriber must be a function")
+    for _, field in ipairs(fields) do
+        assert(field == "view" or field == "tabs" or view_signals[field],
+            "unknown status bar field: " .. tostring(field))
+        subscribers[field] = subscribers[field] or {}
+        table.insert(subscribers[field], func)
+        -- Connect dispatchers for newly used view fields
+        if view_signals[field] then
+            for w, state in pairs(states) do
+                if not state.handlers[field] then add_handler(w, state, field) end
+            end
+        end
+    end
+end
+
+--- Unsubscribe from fields of the status bar model.
+-- @tparam table fields A list of field names.
+-- @tparam function func The subscriber function.
+function _M.unsubscribe(fields, func)
+    for _, field in ipairs(fields) do
+        local funcs = subscribers[field] or {}
+        for i = #funcs, 1, -1 do
+            if funcs[i] == func then table.remove(funcs, i) end
+        end
+    end
+end
+
+window.add_signal("init", function (w)
+    local state = { handlers = {}, pending = {} }
+    states[w] = state
+    for field in pairs(view_signals) do
+        if subscribers[field] then add_handler(w, state, field) end
+    end
+
+    w.tabs:add_signal("switch-page", function (_, view)
+        bind(state, view)
+        queue(w, state, "view")
+    end)
+    w.tabs:add_signal("page-added", function ()
+        queue(w, state, "tabs")
+    end)
+    w.tabs:add_signal("page-removed", function (_, view)
+        if view == state.view then unbind(state) end
+        queue(w, state, "tabs")
+    end)
+    w.tabs:add_signal("page-reordered", function ()
+        queue(w, state, "tabs")
+    end)
+end)
+
+return _M
+
+-- vim: et:sw=4:ts=8:sts=4:tw=80
@@ -7,9 +7,7 @@
 -- @copyright 2010 Mason Larobina
 
 local window = require("window")
-local webview = require("webview")
-local lousy = require("lousy")
-local theme = lousy.theme.get()
+local model = require("widget.model")
 
 local function update (w)
     local p = w.view.progress
@@ -22,20 +20,8 @@ local function update (w)
     end
 end
 
-webview.add_signal("init", function (view)
-    -- Update widget when current page changes status
-    for _, sig in ipairs({"load-status", "property::progress"}) do
-        view:add_signal(sig, function (v)
-            local w = webview.window(v)
-            if w and w.view == v then
-                update(w)
-            end
-        end)
-    end
-    view:add_signal("switched-page", function (v)
-        update(webview.window(v))
-    end)
-end)
+-- Update widget when current page changes status
+model.subscribe({"view", "load-status", "progress"}, update)
 
 window.add_signal("init", function (w)
     -- Add widget to window
@@ -45,8 +31,7 @@ window.add_signal("init", function (w)
     l.progress:hide()
 
     -- Set style
-    l.progress.fg = theme.sbar_loaded_fg
-    l.progress.font = theme.sbar_loaded_font
+    l.progress:add_class("sbar-progress")
 end)
 
 -- vim: et:sw=4:ts=8:sts=4:tw=80
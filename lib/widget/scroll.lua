@@ -7,9 +7,7 @@
 -- @copyright 2010 Mason Larobina
 
 local window = require("window")
-local webview = require("webview")
-local lousy = require("lousy")
-local theme = lousy.theme.get()
+local model = require("widget.model")
 
 local function update (w)
     w.view:eval_js([=[
@@ -33,17 +31,7 @@ local function update (w)
     end })
 end
 
-webview.add_signal("init", function (view)
-    view:add_signal("expose", function (v)
-        local w = webview.window(v)
-        if w.view == v then
-            update(w)
-        end
-    end)
-    view:add_signal("switched-page", function (v)
-        update(webview.window(v))
-    end)
-end)
+model.subscribe({"view", "expose"}, update)
 
 window.add_signal("init", function (w)
     -- Add widget to window
@@ -52,8 +40,7 @@ window.add_signal("init", function (w)
     r.layout:pack(r.scroll)
 
     -- Set style
-    r.scroll.fg = theme.scroll_sbar_fg
-    r.scroll.font = theme.scroll_sbar_font
+    r.scroll:add_class("sbar-scroll")
 end)
 
 -- vim: et:sw=4:ts=8:sts=4:tw=80
@@ -8,36 +8,35 @@
 -- @copyright 2010 Mason Larobina
 
 local window = require("window")
-local webview = require("webview")
-local lousy = require("lousy")
-local theme = lousy.theme.get()
+local model = require("widget.model")
 
-local function update (w)
-    local trusted = w.view:ssl_trusted()
+local function update (w, load)
+    local trusted, uri
+    if load then
+        trusted, uri = load.ssl_trusted, load.uri
+    else
+        trusted, uri = w.view:ssl_trusted(), w.view.uri
+    end
     local ssl = w.sbar.r.ssl
     if trusted == true then
-        ssl.fg = theme.trust_fg
+        ssl:remove_class("notrust")
+        ssl:add_class("trust")
         ssl.text = "(trust)"
         ssl:show()
-    elseif string.sub(w.view.uri or "", 1, 4) == "http" then
+    elseif string.sub(uri or "", 1, 4) == "http" then
         -- Display (notrust) on http/https URLs
-        ssl.fg = theme.notrust_fg
+        ssl:remove_class("trust")
+        ssl:add_class("notrust")
         ssl.text = "(notrust)"
         ssl:show()
     end
 end
 
-webview.add_signal("init", function (view)
-    -- Update widget when current page changes status
-    view:add_signal("load-status", function (v, status)
-        local w = webview.window(v)
-        if status == "committed" and w and w.view == v then
-            update(w)
-        end
-    end)
-    view:add_signal("switched-page", function (v)
-        update(webview.window(v))
-    end)
+-- Update widget when current page changes status
+model.subscribe({"view", "load-status"}, function (w, _, status, load)
+    if status == nil or status == "committed" then
+        update(w, load)
+    end
 end)
 
 window.add_signal("init", function (w)
@@ -48,8 +47,7 @@ window.add_signal("init", function (w)
     r.ssl:hide()
 
     -- Set style
-    r.ssl.fg = theme.ssl_sbar_fg
-    r.ssl.font = theme.ssl_sbar_font
+    r.ssl:add_class("sbar-ssl")
 end)
 
 -- vim: et:sw=4:ts=8:sts=4:tw=80
@@ -8,21 +8,14 @@
 -- @copyright 2010 Mason Larobina
 
 local window = require("window")
-local webview = require("webview")
-local lousy = require("lousy")
-local theme = lousy.theme.get()
+local model = require("widget.model")
 
 local function update (w)
     w.sbar.r.tabi.text = string.format("[%d/%d]", w.tabs:current(), w.tabs:count())
 end
 
-webview.add_signal("init", function (view)
-    -- Update widget when current page changes status
-    view:add_signal("switched-page", function (v)
-        local w = webview.window(v)
-        update(w)
-    end)
-end)
+-- Update widget when the current tab or the number of tabs changes
+model.subscribe({"view", "tabs"}, update)
 
 window.add_signal("init", function (w)
     -- Add widget to window
@@ -31,17 +24,7 @@ window.add_signal("init", function (w)
     r.layout:pack(r.tabi)
 
     -- Set style
-    r.tabi.fg = theme.tabi_sbar_fg
-    r.tabi.font = theme.tabi_sbar_font
-
-    w.tabs:add_signal("page-added", function ()
-        luakit.idle_add(function ()
-            update(w)
-        end)
-    end)
-    w.tabs:add_signal("page-reordered", function ()
-        update(w)
-    end)
+    r.tabi:add_class("sbar-tabi")
 end)
 
 -- vim: et:sw=4:ts=8:sts=4:tw=80
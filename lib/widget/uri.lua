@@ -8,37 +8,19 @@
 -- @copyright 2010 Mason Larobina
 
 local window = require("window")
-local webview = require("webview")
+local model = require("widget.model")
 local lousy = require("lousy")
-local theme = lousy.theme.get()
 
 local function update (w, link)
     w.sbar.l.uri.text = lousy.util.escape((link and "Link: " .. link)
         or (w.view and w.view.uri) or "about:blank")
 end
 
-webview.add_signal("init", function (view)
-    view:add_signal("property::uri", function (v)
-        local w = webview.window(v)
-        if w and w.view == v then
-            update(w)
-        end
-    end)
-    view:add_signal("link-hover", function (v, link)
-        local w = webview.window(v)
-        if w and w.view == v and link then
-            update(w, link)
-        end
-    end)
-    view:add_signal("link-unhover", function (v)
-        local w = webview.window(v)
-        if w and w.view == v then
-            update(w)
-        end
-    end)
-    view:add_signal("switched-page", function (v)
-        update(webview.window(v))
-    end)
+model.subscribe({"view", "uri", "link-unhover"}, function (w)
+    update(w)
+end)
+model.subscribe({"link-hover"}, function (w, _, link)
+    if link then update(w, link) end
 end)
 
 window.add_signal("init", function (w)
@@ -49,8 +31,7 @@ window.add_signal("init", function (w)
     l.uri.selectable = true
 
     -- Set style
-    l.uri.fg = theme.uri_sbar_fg
-    l.uri.font = theme.uri_sbar_font
+    l.uri:add_class("sbar-uri")
 end)
 
 -- vim: et:sw=4:ts=8:sts=4:tw=80
@@ -37,18 +37,58 @@
 #include "common/clib/ipc.h"
 #include "common/clib/msg.h"
 #include "common/clib/timer.h"
+#include "common/clib/gc.h"
+#include "common/clib/task.h"
 #include "common/clib/regex.h"
+#include "common/trace.h"
 #include "globalconf.h"
 
 #include <glib.h>
 #include <gtk/gtk.h>
 #include <stdlib.h>
 
+/* Modifier tables and key strings are cached in the registry, so that
+ * marshalling input events doesn't allocate. Cached modifier tables are
+ * shared between events; signal handlers must not modify them */
+#define MODIFIERS_REG_KEY "luakit.registry.modifiers"
+#define KEYSTR_REG_KEY "luakit.registry.keystr"
+
+/* Upper bound on the number of cached key strings */
+#define KEYSTR_CACHE_MAX 1024
+
+#define MODIFIERS_MASK (GDK_SHIFT_MASK | GDK_LOCK_MASK | GDK_CONTROL_MASK | \
+        GDK_MOD1_MASK | GDK_MOD2_MASK | GDK_MOD3_MASK | GDK_MOD4_MASK | GDK_MOD5_MASK)
+
+/* Push the registry table with the given key, creating it if necessary */
+static void
+luaH_cache_table_push(lua_State *L, const gchar *key)
+{
+    lua_pushstring(L, key);
+    lua_rawget(L, LUA_REGISTRYINDEX);
+    if (!lua_isnil(L, -1))
+        return;
+    lua_pop(L, 1);
+    lua_newtable(L);
+    lua_pushstring(L, key);
+    lua_pushvalue(L, -2);
+    lua_rawset(L, LUA_REGISTRYINDEX);
+}
+
 void
 luaH_modifier_table_push(lua_State *L, guint state) {
+    state &= MODIFIERS_MASK;
+
+    luaH_cache_table_push(L, MODIFIERS_REG_KEY);
+    lua_rawgeti(L, -1, state);
+    if (!lua_isnil(L, -1)) {
+        lua_remove(L, -2);
+        return;
+    }
+    lua_pop(L, 1);
+
     gint i = 1;
     lua_newtable(L);
-    if (state & GDK_MODIFIER_MASK) {
+    if (state) {
 
 #define MODKEY(key, name)           \
     if (state & GDK_##key##_MASK) { \
@@ -68,11 +108,25 @@ luaH_modifier_table_push(lua_State *L, guint state) {
 #undef MODKEY
 
     }
+
+    lua_pushvalue(L, -1);
+    lua_rawseti(L, -3, state);
+    lua_remove(L, -2);
 }
 
 void
 luaH_keystr_push(lua_State *L, guint keyval)
 {
+    static guint cached;
+
+    luaH_cache_table_push(L, KEYSTR_REG_KEY);
+    lua_rawgeti(L, -1, keyval);
+    if (!lua_isnil(L, -1)) {
+        lua_remove(L, -2);
+        return;
+    }
+    lua_pop(L, 1);
+
     gchar ucs[7];
     guint ulen;
     guint32 ukval = gdk_keyval_to_unicode(keyval);
@@ -86,6 +140,13 @@ luaH_keystr_push(lua_State *L, guint keyval)
     /* sent keysym for non-printable characters */
     else
         lua_pushstring(L, gdk_keyval_name(keyval));
+
+    if (cached < KEYSTR_CACHE_MAX && !lua_isnil(L, -1)) {
+        lua_pushvalue(L, -1);
+        lua_rawseti(L, -3, keyval);
+        cached++;
+    }
+    lua_remove(L, -2);
 }
 
 void
@@ -130,6 +191,12 @@ luaH_init(gchar ** uris)
     /* Export timer */
     timer_class_setup(L);
 
+    /* Export task */
+    task_class_setup(L);
+
+    /* Schedule garbage collection in idle time */
+    gc_scheduler_setup(L);
+
     /* Export regex */
     regex_class_setup(L);
 
@@ -148,6 +215,7 @@ luaH_init(gchar ** uris)
 
     /* add Lua search paths */
     luaH_add_paths(L, globalconf.config_dir);
+    trace_lua_setup(L);
 
     /* push a table of the startup uris */
     const gchar *uri;
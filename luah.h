@@ -28,6 +28,8 @@ void luaH_init();
 gboolean luaH_parserc(const gchar *, gboolean);
 gint luaH_mtnext(lua_State *, gint);
 
+/* Push the modifier table for the given state. It is cached and shared
+ * between events, so it must not be modified by callers or signal handlers */
 void luaH_modifier_table_push(lua_State *, guint);
 void luaH_keystr_push(lua_State *, guint);
 
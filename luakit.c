@@ -20,6 +20,7 @@
 
 #include "common/util.h"
 #include "common/common.h"
+#include "common/trace.h"
 #include "globalconf.h"
 #include "luah.h"
 #include "ipc.h"
@@ -48,7 +49,7 @@ init_directories(void)
 
 /* load command line options into luakit and return uris to load */
 static gchar **
-parseopts(int *argc, gchar *argv[], gboolean **nonblock)
+parseopts(int *argc, gchar *argv[], gboolean **nonblock, gchar **trace_file)
 {
     GOptionContext *context;
     gboolean *version_only = NULL;
@@ -73,6 +74,7 @@ parseopts(int *argc, gchar *argv[], gboolean **nonblock)
         { "verbose",  'v', 0, G_OPTION_ARG_NONE,         &verbose,             "print verbose output",      NULL   },
         { "log",      'l', 0, G_OPTION_ARG_STRING,       &log_lvl,             "specify precise log level", "NAME" },
         { "version",  'V', 0, G_OPTION_ARG_NONE,         &version_only,        "print version and exit",    NULL   },
+        { "trace",    0,   0, G_OPTION_ARG_FILENAME,     trace_file,           "write startup trace to file", "FILE" },
         { NULL,       0,   0, 0,                         NULL,                 NULL,                        NULL   },
     };
 
@@ -173,6 +175,7 @@ gint
 main(gint argc, gchar *argv[])
 {
     gboolean *nonblock = NULL;
+    gchar *trace_file = NULL;
 
     globalconf.starttime = l_time();
 
@@ -183,7 +186,7 @@ main(gint argc, gchar *argv[])
     setlocale(LC_NUMERIC, "C");
 
     /* parse command line opts and get uris to load */
-    gchar **uris = parseopts(&argc, argv, &nonblock);
+    gchar **uris = parseopts(&argc, argv, &nonblock, &trace_file);
 
     /* hide command line parameters so process lists don't leak (possibly
        confidential) URLs */
@@ -206,19 +209,38 @@ main(gint argc, gchar *argv[])
         }
     }
 
+    if (trace_file) {
+        trace_init("UI", trace_file);
+        g_free(trace_file);
+        atexit(trace_finish);
+    }
+
+    gint64 start = trace_begin();
     gtk_init(&argc, &argv);
+    trace_end(start, "startup", "gtk_init");
 
 #if __GLIBC__ == 2 && __GLIBC_MINOR__ >= 50
     g_log_set_writer_func(glib_log_writer, NULL, NULL);
 #endif
     init_directories();
+
+    start = trace_begin();
     web_context_init();
+    trace_end(start, "startup", "web_context_init");
+
+    start = trace_begin();
     ipc_init();
+    trace_end(start, "startup", "ipc_init");
+
+    start = trace_begin();
     luaH_init(uris);
+    trace_end(start, "startup", "luaH_init");
 
     /* parse and run configuration file */
+    start = trace_begin();
     if (!luaH_parserc(globalconf.confpath, TRUE))
         fatal("couldn't find rc file");
+    trace_end(start, "startup", "config");
 
     if (!globalconf.windows->len)
         fatal("no windows spawned by rc file, exiting");
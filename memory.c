@@ -0,0 +1,247 @@
+/*
+ * memory.c - process memory and Lua heap telemetry
+ *
+ * Copyright © 2017 Aidan Holm <aidanholm@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "memory.h"
+#include "globalconf.h"
+#include "clib/sqlite3.h"
+#include "common/ipc.h"
+#include "common/luaobject.h"
+#include "widgets/webview.h"
+
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Lua heap size of each web process, as last reported over IPC */
+static GHashTable *web_lua_heap;
+
+void
+memory_set_web_lua_heap(pid_t pid, gint kb)
+{
+    if (!web_lua_heap)
+        web_lua_heap = g_hash_table_new(g_direct_hash, g_direct_equal);
+    g_hash_table_insert(web_lua_heap, GINT_TO_POINTER(pid), GINT_TO_POINTER(kb));
+}
+
+/* Read the resident and proportional set sizes of a process. The PSS is only
+ * available from smaps_rollup (Linux 4.14); otherwise it is set to -1. */
+static gboolean
+memory_read_process(pid_t pid, gint *rss_kb, gint *pss_kb)
+{
+    gchar path[64], *contents;
+    *rss_kb = *pss_kb = -1;
+
+    g_snprintf(path, sizeof(path), "/proc/%d/smaps_rollup", pid);
+    if (g_file_get_contents(path, &contents, NULL, NULL)) {
+        for (gchar *line = contents; line && *line; ) {
+            if (g_str_has_prefix(line, "Rss:"))
+                *rss_kb = atoi(line + 4);
+            else if (g_str_has_prefix(line, "Pss:"))
+                *pss_kb = atoi(line + 4);
+            line = strchr(line, '\n');
+            if (line) line++;
+        }
+        g_free(contents);
+        return *rss_kb >= 0;
+    }
+
+    g_snprintf(path, sizeof(path), "/proc/%d/statm", pid);
+    if (!g_file_get_contents(path, &contents, NULL, NULL))
+        return FALSE;
+    glong size, resident;
+    if (sscanf(contents, "%ld %ld", &size, &resident) == 2)
+        *rss_kb = resident * (sysconf(_SC_PAGESIZE) / 1024);
+    g_free(contents);
+    return *rss_kb >= 0;
+}
+
+static void
+memory_push_process(lua_State *L, pid_t pid, gint lua_kb)
+{
+    gint rss_kb, pss_kb;
+    lua_createtable(L, 0, 5);
+    lua_pushinteger(L, pid);
+    lua_setfield(L, -2, "pid");
+    if (memory_read_process(pid, &rss_kb, &pss_kb)) {
+        lua_pushinteger(L, rss_kb);
+        lua_setfield(L, -2, "rss_kb");
+        if (pss_kb >= 0) {
+            lua_pushinteger(L, pss_kb);
+            lua_setfield(L, -2, "pss_kb");
+        }
+    }
+    if (lua_kb >= 0) {
+        lua_pushinteger(L, lua_kb);
+        lua_setfield(L, -2, "lua_kb");
+    }
+}
+
+/* Ask all web processes to report their Lua heap size */
+static void
+memory_request_web_lua_heap(void)
+{
+    const GPtrArray *endpoints = ipc_endpoints_get();
+    if (!endpoints)
+        return;
+    ipc_header_t header = { .type = IPC_TYPE_memory, .length = 0 };
+    for (guint i = 0; i < endpoints->len; i++)
+        ipc_send(endpoints->pdata[i], &header, NULL);
+}
+
+static void
+memory_push_web_processes(lua_State *L)
+{
+    /* Group webviews by web process */
+    GHashTable *views = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+            NULL, (GDestroyNotify)g_ptr_array_unref);
+    for (guint i = 0; i < globalconf.webviews->len; i++) {
+        widget_t *w = globalconf.webviews->pdata[i];
+        pid_t pid = webview_get_web_process_id(w);
+        if (!pid)
+            continue;
+        GPtrArray *list = g_hash_table_lookup(views, GINT_TO_POINTER(pid));
+        if (!list) {
+            list = g_ptr_array_new();
+            g_hash_table_insert(views, GINT_TO_POINTER(pid), list);
+        }
+        g_ptr_array_add(list, w);
+    }
+
+    /* Forget heap sizes of web processes that have gone away */
+    if (web_lua_heap) {
+        GHashTableIter iter;
+        gpointer pid;
+        g_hash_table_iter_init(&iter, web_lua_heap);
+        while (g_hash_table_iter_next(&iter, &pid, NULL))
+            if (!g_hash_table_contains(views, pid))
+                g_hash_table_iter_remove(&iter);
+    }
+
+    lua_createtable(L, g_hash_table_size(views), 0);
+    GHashTableIter iter;
+    gpointer pid, list;
+    gint n = 0;
+    g_hash_table_iter_init(&iter, views);
+    while (g_hash_table_iter_next(&iter, &pid, &list)) {
+        gpointer lua_kb;
+        gboolean known = web_lua_heap && g_hash_table_lookup_extended(
+                web_lua_heap, pid, NULL, &lua_kb);
+        memory_push_process(L, GPOINTER_TO_INT(pid),
+                known ? GPOINTER_TO_INT(lua_kb) : -1);
+
+        GPtrArray *ws = list;
+        lua_createtable(L, ws->len, 0);
+        for (guint i = 0; i < ws->len; i++) {
+            luaH_object_push(L, ((widget_t*)ws->pdata[i])->ref);
+            lua_rawseti(L, -2, i + 1);
+        }
+        lua_setfield(L, -2, "views");
+        lua_rawseti(L, -2, ++n);
+    }
+    g_hash_table_destroy(views);
+}
+
+static gint
+table_entries(lua_State *L, gint idx)
+{
+    gint n = 0;
+    if (!lua_istable(L, idx))
+        return 0;
+    if (idx < 0 && idx > LUA_REGISTRYINDEX)
+        idx = lua_gettop(L) + idx + 1;
+    lua_pushnil(L);
+    while (lua_next(L, idx)) {
+        n++;
+        lua_pop(L, 1);
+    }
+    return n;
+}
+
+/* Push the number of entries in major Lua tables */
+static void
+memory_push_tables(lua_State *L)
+{
+    lua_createtable(L, 0, 4);
+
+    lua_pushinteger(L, table_entries(L, LUA_REGISTRYINDEX));
+    lua_setfield(L, -2, "registry");
+    lua_pushinteger(L, table_entries(L, LUA_GLOBALSINDEX));
+    lua_setfield(L, -2, "globals");
+
+    lua_getglobal(L, "package");
+    if (lua_istable(L, -1))
+        lua_getfield(L, -1, "loaded");
+    else
+        lua_pushnil(L);
+    lua_pushinteger(L, table_entries(L, -1));
+    lua_setfield(L, -4, "modules");
+    lua_pop(L, 2);
+
+    luaH_object_registry_push(L);
+    lua_pushinteger(L, table_entries(L, -1));
+    lua_setfield(L, -3, "objects");
+    lua_pop(L, 1);
+
+    /* Each named table in the registry, such as the unique object
+     * registries of the luakit classes */
+    lua_newtable(L);
+    lua_pushnil(L);
+    while (lua_next(L, LUA_REGISTRYINDEX)) {
+        if (lua_type(L, -2) == LUA_TSTRING && lua_istable(L, -1)) {
+            lua_pushvalue(L, -2);
+            lua_pushinteger(L, table_entries(L, -2));
+            lua_rawset(L, -5);
+        }
+        lua_pop(L, 1);
+    }
+    lua_setfield(L, -2, "registry_tables");
+}
+
+/** Collect memory usage statistics.
+ *
+ * Web process Lua heap sizes are reported asynchronously; each call returns
+ * the sizes reported since the previous call, and requests new ones.
+ *
+ * \param L The Lua VM state.
+ * \return  The number of elements pushed on the stack (1).
+ */
+gint
+luaH_luakit_memory_stats(lua_State *L)
+{
+    lua_createtable(L, 0, 4);
+
+    memory_push_process(L, getpid(), lua_gc(L, LUA_GCCOUNT, 0));
+    lua_setfield(L, -2, "ui");
+
+    memory_push_web_processes(L);
+    lua_setfield(L, -2, "web_processes");
+    memory_request_web_lua_heap();
+
+    sqlite3_push_memory_stats(L);
+    lua_setfield(L, -2, "sqlite");
+
+    memory_push_tables(L);
+    lua_setfield(L, -2, "tables");
+    return 1;
+}
+
+// vim: ft=c:et:sw=4:ts=8:sts=4:tw=80
@@ -0,0 +1,68 @@
+--- DOM subtree construction test - web module.
+--
+-- @copyright 2017 Aidan Holm
+
+local ui = ipc_channel("tests.async.dom_build_wm")
+
+local hint_spec = {
+    { "span", class = "overlay", style = "${style}", ref = "overlay" },
+    { "span", class = "label", text = "${label}", ref = "label" },
+}
+
+local function hint_params(n)
+    local params = {}
+    for i = 1, n do
+        params[i] = { style = "left: " .. i .. "px;", label = tostring(i) }
+    end
+    return params
+end
+
+-- Create `n` labelled overlays one element at a time
+ui:add_signal("create", function (_, page, n)
+    local doc = dom_document(page.id)
+    local params = hint_params(n)
+    local start = os.clock()
+    local root = doc:create_element("div", { id = "create_root" })
+    doc.body:append(root)
+    for i = 1, n do
+        local p = params[i]
+        root:append(doc:create_element("span", { class = "overlay", style = p.style }))
+        root:append(doc:create_element("span", { class = "label" }, p.label))
+    end
+    return os.clock() - start
+end)
+
+-- Create `n` labelled overlays with a compiled template
+ui:add_signal("build", function (_, page, n)
+    local doc = dom_document(page.id)
+    local params = hint_params(n)
+    local start = os.clock()
+    local root = doc:build({ "div", id = "build_root", ref = "root" }, nil, doc.body).root
+    local list = doc:build(doc:compile(hint_spec), params, root)
+    local elapsed = os.clock() - start
+
+    -- Check the returned refs
+    assert(#list == n)
+    for _, i in ipairs({1, n}) do
+        local refs = list[i]
+        assert(refs.overlay.attr.class == "overlay")
+        assert(refs.overlay.attr.style == params[i].style)
+        assert(refs.label.text_content == params[i].label)
+    end
+    return elapsed
+end)
+
+ui:add_signal("build_nested", function (_, page)
+    local doc = dom_document(page.id)
+    local refs = doc:build({
+        "ul", id = "nested_root", ref = "list",
+        { "li", "first ", { "b", text = "${name}", ref = "name" } },
+        { "li", text = "second" },
+    }, { name = "bold ${name}" }, doc.body)
+    assert(refs.list.child_count == 2)
+    -- Parameter values are inserted as they are, not expanded again
+    assert(refs.name.text_content == "bold ${name}")
+    return refs.list.text_content
+end)
+
+-- vim: et:sw=4:ts=8:sts=4:tw=80
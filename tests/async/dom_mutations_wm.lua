@@ -0,0 +1,36 @@
+--- DOM mutation watcher test - web module.
+--
+-- @copyright 2017 Aidan Holm
+
+local ui = ipc_channel("tests.async.dom_mutations_wm")
+
+local stats
+
+local function watcher(added, removed, changed)
+    stats.batches = stats.batches + 1
+    stats.added = stats.added + #added
+    stats.removed = stats.removed + #removed
+    stats.changed = stats.changed + #changed
+end
+
+local function reset()
+    stats = { batches = 0, added = 0, removed = 0, changed = 0 }
+end
+
+ui:add_signal("watch", function (_, page, selector)
+    reset()
+    dom_document(page.id):watch_mutations(selector, watcher)
+    return true
+end)
+
+ui:add_signal("unwatch", function (_, page)
+    return dom_document(page.id):unwatch_mutations(watcher)
+end)
+
+ui:add_signal("stats", function ()
+    local ret = stats
+    reset()
+    return ret
+end)
+
+-- vim: et:sw=4:ts=8:sts=4:tw=80
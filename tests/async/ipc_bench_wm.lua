@@ -0,0 +1,25 @@
+--- IPC round trip benchmark - web module.
+--
+-- Mimics hint filtering: each "changed" message from the UI process is
+-- answered with a "matches" message. Also provides handlers for testing
+-- `ipc_channel:call()`.
+--
+-- @copyright 2017 Aidan Holm
+
+local ui = ipc_channel("tests.async.ipc_bench_wm")
+
+ui:add_signal("changed", function (_, page, i, text)
+    ui:emit_signal("matches", page.id, i, #text)
+end)
+
+ui:add_signal("echo", function (_, page, ...)
+    return page.id, ...
+end)
+
+ui:add_signal("sleep", function (_, _, seconds)
+    local start = os.clock()
+    while os.clock() - start < seconds do end
+    return true
+end)
+
+-- vim: et:sw=4:ts=8:sts=4:tw=80
@@ -2,6 +2,7 @@
 --
 -- @copyright 2017 Aidan Holm
 
+local test = require "tests.lib"
 local assert = require "luassert"
 
 local T = {}
@@ -24,6 +25,136 @@ T.test_regex_matches = function ()
     assert(regex{pattern="A"}:match("A"))
 end
 
+T.test_regex_exec = function ()
+    local reg = regex{pattern="(\\w+)=(\\w+)?"}
+    assert.same({1, 3, "a", "b"}, {reg:exec("a=b c=d")})
+    assert.same({5, 7, "c", "d"}, {reg:exec("a=b c=d", 4)})
+    assert.same({5, 6, "c", false}, {reg:exec("a=b c=", 4)})
+    assert.same({5, 7, "c", "d"}, {reg:exec("a=b c=d", -3)})
+    assert.is_nil((reg:exec("a=b c=d", 8)))
+    -- Byte limit
+    assert.same({1, 2, "a", false}, {reg:exec("a=b", 1, 2)})
+    assert.is_nil((reg:exec("a=b", 1, 1)))
+    assert.is_false(reg:match("a=b", 1, 1))
+    assert.is_true(reg:match("xx a=b", 3))
+
+    -- Continuing from the previous match returns the next one
+    local s = "k1=v1 k2=v2 k3=v3"
+    local pos, found = 1, {}
+    while true do
+        local _, e, k, v = reg:exec(s, pos)
+        if not e then break end
+        found[#found+1] = k .. ":" .. v
+        pos = e + 1
+    end
+    assert.same({"k1:v1", "k2:v2", "k3:v3"}, found)
+end
+
+T.test_regex_gmatch = function ()
+    local words = {}
+    for w in regex{pattern="\\w+"}:gmatch("one two  three") do
+        words[#words+1] = w
+    end
+    assert.same({"one", "two", "three"}, words)
+
+    local pairs_ = {}
+    for k, v in regex{pattern="(\\w)=(\\d)"}:gmatch("a=1,b=2,c=3", 4) do
+        pairs_[#pairs_+1] = k .. v
+    end
+    assert.same({"b2", "c3"}, pairs_)
+
+    -- Only the first limit bytes are searched
+    words = {}
+    for w in regex{pattern="\\w+"}:gmatch("one two three", 1, 6) do
+        words[#words+1] = w
+    end
+    assert.same({"one", "tw"}, words)
+
+    -- Empty matches make progress
+    local n = 0
+    for _ in regex{pattern="x*"}:gmatch("abc") do n = n + 1 end
+    assert.is_equal(4, n)
+end
+
+T.test_regex_gsub = function ()
+    local reg = regex{pattern="(\\w+)@(\\w+)"}
+    assert.same({"b at a, d at c", 2}, {reg:gsub("a@b, c@d", "%2 at %1")})
+    assert.same({"b at a, c@d", 1}, {reg:gsub("a@b, c@d", "%2 at %1", 1)})
+    assert.same({"[a@b], [c@d]", 2}, {reg:gsub("a@b, c@d", "[%0]")})
+    assert.same({"100%", 1}, {regex{pattern="\\d+"}:gsub("100", "%0%%")})
+    assert.same({"A@b, c@d", 2}, {reg:gsub("a@b, c@d", { a = "A@b" })})
+    assert.same({"ab, cd", 2}, {reg:gsub("a@b, c@d", function (x, y) return x .. y end)})
+    assert.same({"xaxbxcx", 4}, {regex{pattern="y*"}:gsub("abc", "x")})
+    assert.same({"x", 1}, {regex{pattern="\\w+"}:gsub("abc", "x")})
+    assert.same({"b at a, c@d", 1}, {reg:gsub("a@b, c@d", "%2 at %1", nil, 5)})
+    assert.has_error(function () reg:gsub("a@b", "%3") end)
+    assert.has_error(function () reg:gsub("a@b", "%z") end)
+
+    -- The replacement function may use the same regex
+    local out = reg:gsub("a@b c@d", function (x, y)
+        return (reg:gsub(y .. "@" .. x, "%1%2"))
+    end)
+    assert.is_equal("ba dc", out)
+
+    -- A false result keeps the original match, even if the callback has
+    -- matched the same regex against another string
+    out = reg:gsub("a@b c@d", function (x)
+        reg:match("zz@yy")
+        reg:gsub("ww@vv", "%2")
+        return x == "c" and "X"
+    end)
+    assert.is_equal("a@b X", out)
+    out = reg:gsub("a@b c@d", setmetatable({}, { __index = function ()
+        reg:match("zz@yy")
+    end }))
+    assert.is_equal("a@b c@d", out)
+end
+
+T.test_regex_split = function ()
+    local comma = regex{pattern="\\s*,\\s*"}
+    assert.same({"a", "b", "c"}, comma:split("a , b,c"))
+    assert.same({"", "a", ""}, comma:split(",a,"))
+    assert.same({"a", "b,c"}, comma:split("a,b,c", 2))
+    assert.same({"abc"}, comma:split("abc"))
+    assert.same({"a", "b,c"}, comma:split("a,b,c", nil, 3))
+    assert.same({"a", "b", "c"}, regex{pattern=""}:split("abc"))
+end
+
+-- Compare against Lua pattern equivalents on a large input
+T.test_regex_benchmark = function ()
+    local parts = {}
+    for i = 1, 20000 do
+        parts[i] = string.format("key%d=value%d", i, i * 7)
+    end
+    local input = table.concat(parts, "; ")
+
+    local reg = regex{pattern="(\\w+)=(\\w+)"}
+    local _, n_regex = test.bench("regex gmatch", 1, function ()
+        local n = 0
+        for _ in reg:gmatch(input) do n = n + 1 end
+        return n
+    end)
+    local _, n_lua = test.bench("lua gmatch", 1, function ()
+        local n = 0
+        for _ in input:gmatch("(%w+)=(%w+)") do n = n + 1 end
+        return n
+    end)
+    assert.is_equal(n_lua, n_regex)
+
+    local _, r_regex = test.bench("regex gsub", 1, function ()
+        return (reg:gsub(input, "%2=%1"))
+    end)
+    local _, r_lua = test.bench("lua gsub", 1, function ()
+        return (input:gsub("(%w+)=(%w+)", "%2=%1"))
+    end)
+    assert.is_equal(r_lua, r_regex)
+
+    local _, f_regex = test.bench("regex split", 1, function ()
+        return regex{pattern="; "}:split(input)
+    end)
+    assert.is_equal(#parts, #f_regex)
+end
+
 return T
 
 -- vim: et:sw=4:ts=8:sts=4:tw=80
@@ -19,6 +19,10 @@ T.test_open_db = function ()
 
     -- Should error without filename in constructor table
     assert.has_error(function () sqlite3{} end)
+
+    -- A failed open leaves nothing to close when collected
+    assert.has_error(function () sqlite3{filename="/nonexistent/dir/test.db"} end)
+    collectgarbage()
 end
 
 T.test_sqlite3_exec = function ()
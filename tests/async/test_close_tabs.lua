@@ -0,0 +1,81 @@
+--- Test closing many tabs at once.
+--
+-- @copyright 2017 Aidan Holm
+
+local T = {}
+local assert = require "luassert"
+
+uris = {"about:blank"}
+require "config.rc"
+
+local window = require "window"
+local w = assert(select(2, next(window.bywidget)))
+
+-- Count the given views as they are destroyed
+local function count_destroyed(views)
+    local counter = { n = 0 }
+    for _, view in ipairs(views) do
+        view:add_signal("destroy", function () counter.n = counter.n + 1 end)
+    end
+    return counter
+end
+
+T.test_close_tabs = function ()
+    local views = {}
+    for i = 1, 5 do views[i] = w:new_tab("about:blank", false) end
+    local first = w.view
+    w.tabs:switch(w.tabs:indexof(views[2]))
+
+    local signals = {}
+    local function on_close_tabs(_, list) signals[#signals+1] = list end
+    w:add_signal("close-tabs", on_close_tabs)
+    local nclosed = #w.closed_tabs
+
+    -- Closing the current tab switches to the next remaining one
+    local closing = { views[4], views[2], views[3] }
+    local destroyed = count_destroyed(closing)
+    w:close_tabs(closing)
+    w:remove_signal("close-tabs", on_close_tabs)
+
+    assert.is_equal(1, #signals)
+    assert.is_equal(3, #signals[1])
+    assert.same({ first, views[1], views[5] }, w.tabs.children)
+    assert.is_equal(views[5], w.view)
+    assert.is_equal(nclosed + 3, #w.closed_tabs)
+
+    -- Closed views are destroyed straight away
+    assert.is_equal(3, destroyed.n)
+
+    -- Undoing the closes restores the tabs in order
+    for _ = 1, 3 do w:undo_close_tab() end
+    assert.is_equal(6, w.tabs:count())
+    for i = 3, 5 do assert.is_equal("about:blank", w.tabs[i].uri) end
+
+    -- Closing every tab leaves a blank tab
+    w:close_tabs(w.tabs.children)
+    assert.is_equal(1, w.tabs:count())
+    assert.is_equal("luakit://newtab/", w.view.uri)
+end
+
+T.test_close_tabs_benchmark = function ()
+    local ntabs = 300
+    local views = {}
+    for i = 1, ntabs do views[i] = w:new_tab(nil, false) end
+    local keep = w.tabs[1]
+    w.tabs:switch(ntabs)
+
+    local destroyed = count_destroyed(views)
+    local start = luakit.time()
+    w:close_tabs(views)
+    local elapsed = luakit.time() - start
+    assert.is_equal(1, w.tabs:count())
+    assert.is_equal(keep, w.view)
+    assert.is_equal(ntabs, destroyed.n)
+    msg.info("closing %d tabs took %.1fms", ntabs, elapsed * 1000)
+
+    assert.is_true(elapsed < 2)
+end
+
+return T
+
+-- vim: et:sw=4:ts=8:sts=4:tw=80
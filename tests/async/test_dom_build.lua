@@ -0,0 +1,66 @@
+--- Test bulk DOM subtree construction.
+--
+-- @copyright 2017 Aidan Holm
+
+local T = {}
+local test = require "tests.lib"
+local assert = require "luassert"
+
+uris = {"about:blank"}
+require "config.rc"
+
+local window = require "window"
+local w = assert(select(2, next(window.bywidget)))
+
+local wm = require_web_module("tests.async.dom_build_wm")
+
+local function call(view, name, arg)
+    wm:call(view, name, arg, {}, function (ok, ...)
+        assert(ok, ...)
+        test.continue(...)
+    end)
+    return test.wait()
+end
+
+local function count(view, selector)
+    view:eval_js("document.querySelectorAll('" .. selector .. "').length",
+        { callback = test.continue })
+    return test.wait()
+end
+
+T.test_dom_build_nested_spec = function ()
+    w:new_tab(test.http_server() .. "hello_world.html")
+    local view = w.view
+    test.wait_for_view(view)
+
+    assert.is_equal("first bold ${name}second", call(view, "build_nested"))
+    assert.is_equal(2, count(view, "#nested_root > li"))
+    assert.is_equal(1, count(view, "#nested_root > li > b"))
+
+    -- Restore to initial state
+    w:close_tab()
+    assert.is_equal(1, w.tabs:current())
+end
+
+T.test_dom_build_benchmark = function ()
+    w:new_tab(test.http_server() .. "hello_world.html")
+    local view = w.view
+    test.wait_for_view(view)
+
+    local n = 5000
+    local create = call(view, "create", n)
+    local build = call(view, "build", n)
+    msg.info("%d overlays: create_element %.3fs, build %.3fs", n, create, build)
+
+    assert.is_equal(2*n, count(view, "#create_root > span"))
+    assert.is_equal(2*n, count(view, "#build_root > span"))
+    assert.is_equal(n, count(view, "#build_root > span.label"))
+
+    -- Restore to initial state
+    w:close_tab()
+    assert.is_equal(1, w.tabs:current())
+end
+
+return T
+
+-- vim: et:sw=4:ts=8:sts=4:tw=80
@@ -0,0 +1,112 @@
+--- Test DOM mutation watchers.
+--
+-- @copyright 2017 Aidan Holm
+
+local T = {}
+local test = require "tests.lib"
+local assert = require "luassert"
+
+uris = {"about:blank"}
+require "config.rc"
+
+local window = require "window"
+local w = assert(select(2, next(window.bywidget)))
+
+local wm = require_web_module("tests.async.dom_mutations_wm")
+
+local function call(view, name, arg)
+    wm:call(view, name, arg, {}, function (ok, ...)
+        assert(ok, ...)
+        test.continue(...)
+    end)
+    return test.wait()
+end
+
+-- Run some JavaScript, and get the mutations seen by the watcher after
+-- they have been delivered
+local function mutate(view, js)
+    local start = os.clock()
+    view:eval_js(js, { callback = test.continue })
+    test.wait()
+    test.delay(200)
+    local stats = call(view, "stats")
+    msg.info("%d added, %d removed, %d changed in %d batches: %.3fs UI CPU",
+        stats.added, stats.removed, stats.changed, stats.batches,
+        os.clock() - start)
+    return stats
+end
+
+T.test_dom_mutations_are_batched = function ()
+    w:new_tab(test.http_server() .. "hello_world.html")
+    local view = w.view
+    test.wait_for_view(view)
+
+    assert.is_true(call(view, "watch", "div.item"))
+
+    -- 10k matching elements, added in a single subtree and one by one;
+    -- non-matching elements are filtered out
+    local stats = mutate(view, [=[
+        var root = document.createElement("div");
+        root.id = "root";
+        for (var i = 0; i < 5000; i++) {
+            var div = document.createElement("div");
+            div.className = "item";
+            root.appendChild(div);
+            root.appendChild(document.createElement("span"));
+        }
+        document.body.appendChild(root);
+        for (var i = 0; i < 5000; i++) {
+            var div = document.createElement("div");
+            div.className = "item";
+            root.appendChild(div);
+        }
+        true;
+    ]=])
+    assert.is_equal(10000, stats.added)
+    assert.is_equal(0, stats.removed)
+    assert.is_true(stats.batches <= 3)
+
+    -- Attribute changes
+    stats = mutate(view, [=[
+        var items = document.querySelectorAll("div.item");
+        for (var i = 0; i < 100; i++)
+            items[i].setAttribute("data-n", i);
+        true;
+    ]=])
+    assert.is_equal(0, stats.added)
+    assert.is_equal(100, stats.changed)
+
+    -- Elements added and removed within a batch are not reported
+    stats = mutate(view, [=[
+        var div = document.createElement("div");
+        div.className = "item";
+        document.body.appendChild(div);
+        document.body.removeChild(div);
+        true;
+    ]=])
+    assert.is_equal(0, stats.batches)
+
+    -- Removing the subtree reports all matching elements in it
+    stats = mutate(view, [=[
+        document.body.removeChild(document.getElementById("root"));
+        true;
+    ]=])
+    assert.is_equal(10000, stats.removed)
+    assert.is_equal(0, stats.added)
+
+    -- No more batches once unwatched
+    assert.is_true(call(view, "unwatch"))
+    stats = mutate(view, [=[
+        document.body.appendChild(document.createElement("div"));
+        true;
+    ]=])
+    assert.is_equal(0, stats.batches)
+
+    -- Restore to initial state
+    w:close_tab()
+    assert.is_equal(1, w.tabs:current())
+end
+
+return T
+
+-- vim: et:sw=4:ts=8:sts=4:tw=80
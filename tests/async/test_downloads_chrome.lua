@@ -0,0 +1,51 @@
+--- Test downloads chrome page updates.
+--
+-- @copyright 2017 Aidan Holm
+
+local T = {}
+local test = require "tests.lib"
+local assert = require "luassert"
+
+uris = {"about:blank"}
+require "config.rc"
+
+local window = require "window"
+local downloads = require "downloads"
+local w = assert(select(2, next(window.bywidget)))
+
+-- Count every call crossing between the page and Lua, in either direction
+local count_calls_js = [=[
+    window.ipc_calls = 0;
+    ["apply_diffs", "downloads_get_all", "download_get"].forEach(function (name) {
+        var f = window[name];
+        window[name] = function () {
+            window.ipc_calls++;
+            return f.apply(this, arguments);
+        };
+    });
+]=]
+
+T.test_idle_downloads_page_causes_no_ipc_traffic = function ()
+    w:new_tab("luakit://downloads/")
+    local view = w.view
+    test.wait_for_view(view)
+
+    view:eval_js(count_calls_js, { no_return = true })
+
+    -- Status ticks with nothing running must not reach the page
+    for _ = 1, 5 do
+        downloads.emit_signal("status-tick", 0)
+    end
+    test.delay(1500)
+
+    view:eval_js("window.ipc_calls", { callback = test.continue })
+    assert.is_equal(0, test.wait())
+
+    -- Restore to initial state
+    w:close_tab()
+    assert.is_equal(1, w.tabs:current())
+end
+
+return T
+
+-- vim: et:sw=4:ts=8:sts=4:tw=80
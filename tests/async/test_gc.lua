@@ -0,0 +1,121 @@
+--- Test idle-time garbage collection scheduling.
+--
+-- @copyright 2017 Aidan Holm
+
+local T = {}
+local test = require "tests.lib"
+local assert = require "luassert"
+
+T.test_gc_options = function ()
+    local defaults = luakit.gc_options()
+    assert.is_equal(250, defaults.burst_ms)
+    assert.is_equal(2, defaults.budget_ms)
+
+    local opts = luakit.gc_options({ burst_ms = 300, step_kb = 32 })
+    assert.is_equal(300, opts.burst_ms)
+    assert.is_equal(32, opts.step_kb)
+    assert.is_equal(defaults.threshold, opts.threshold)
+
+    assert.has_error(function () luakit.gc_options({ budget_ms = 0 }) end)
+    assert.has_error(function () luakit.gc_options("foo") end)
+    luakit.gc_options(defaults)
+    assert.same(defaults, luakit.gc_options())
+end
+
+T.test_stop_is_capped = function ()
+    local defaults = luakit.gc_options()
+    -- Collection work is always due
+    luakit.gc_options({ threshold = 0, max_stop_ms = 100 })
+    local win = widget{type="window"}
+    win:show()
+    test.delay(defaults.burst_ms + 50)
+
+    local pad = {}
+    for i = 1, 1000 do pad[i] = {} end
+    assert.is_equal(1000, #pad)
+    win:send_key({}, "a")
+    assert.is_true(luakit.gc_stats().stopped)
+
+    -- Keep the burst going for longer than max_stop_ms
+    local start = luakit.time()
+    repeat
+        test.delay(20)
+        win:send_key({}, "a")
+    until luakit.time() - start > 0.2
+    local stats = luakit.gc_stats()
+    assert.is_true(stats.in_burst)
+    assert.is_false(stats.stopped)
+
+    win:destroy()
+    luakit.gc_options(defaults)
+end
+
+T.test_user_stop_is_kept = function ()
+    local win = widget{type="window"}
+    win:show()
+    collectgarbage("stop")
+    for _ = 1, 10 do win:send_key({}, "a") end
+    test.delay(luakit.gc_options().burst_ms + 50)
+    assert.is_false(luakit.gc_stats().in_burst)
+
+    -- Nothing is collected while the collector is stopped
+    local before = collectgarbage("count")
+    local t = {}
+    for i = 1, 1000000 do t[i % 100] = tostring(i) .. "x" end
+    assert.is_string(t[1])
+    assert.is_true(collectgarbage("count") - before > 20000)
+
+    collectgarbage("restart")
+    win:destroy()
+end
+
+T.test_key_latency_with_large_heap = function ()
+    -- Build a long-lived heap of about 200MB
+    local heap, n = {}, 0
+    while collectgarbage("count") < 200 * 1024 do
+        n = n + 1
+        heap[n] = { string.rep("x", 1024) .. n, {} }
+    end
+
+    local win = widget{type="window"}
+    win:show()
+    -- Each key press allocates some garbage, as binding handlers do
+    win:add_signal("key-press", function ()
+        local t = {}
+        for i = 1, 100 do t[i] = { i, tostring(i) } end
+        return true
+    end)
+
+    -- Bursts of typing, separated by idle time
+    local latencies = {}
+    for _ = 1, 10 do
+        for _ = 1, 50 do
+            local start = luakit.time()
+            win:send_key({}, "a")
+            latencies[#latencies+1] = luakit.time() - start
+        end
+        test.delay(300)
+    end
+
+    table.sort(latencies)
+    local p50 = latencies[math.ceil(#latencies * 0.5)]
+    local p99 = latencies[math.ceil(#latencies * 0.99)]
+    local stats = luakit.gc_stats()
+    msg.info("key latency p50 %.2fms, p99 %.2fms, max %.2fms; heap %dMB",
+        p50 * 1000, p99 * 1000, latencies[#latencies] * 1000, stats.heap_kb / 1024)
+    msg.info("idle gc: %d frames, %d cycles, %.1fms total, %.2fms max per frame",
+        stats.frames, stats.cycles, stats.total_ms, stats.max_frame_ms)
+
+    assert.is_true(stats.bursts >= 10)
+    assert.is_true(stats.frames > 0)
+    assert.is_true(stats.max_frame_ms < 50)
+    assert.is_true(p99 < 0.05)
+
+    win:destroy()
+    heap = nil -- luacheck: ignore heap
+    collectgarbage()
+end
+
+return T
+
+-- vim: et:sw=4:ts=8:sts=4:tw=80
@@ -0,0 +1,135 @@
+--- Test IPC channel messaging.
+--
+-- @copyright 2017 Aidan Holm
+
+local T = {}
+local test = require "tests.lib"
+local assert = require "luassert"
+
+uris = {"about:blank"}
+require "config.rc"
+
+local window = require "window"
+local w = assert(select(2, next(window.bywidget)))
+
+local bench = require_web_module("tests.async.ipc_bench_wm")
+
+-- Send `count` hint filtering messages and wait for all replies
+local function round_trips(view, count)
+    local received, in_order = 0, true
+    local function matches(_, page_id, i, n)
+        received = received + 1
+        in_order = in_order and i == received and n == #tostring(i)
+            and page_id == view.id
+        if received == count then test.continue() end
+    end
+    bench:add_signal("matches", matches)
+    for i = 1, count do
+        bench:emit_signal(view, "changed", i, tostring(i))
+    end
+    test.wait(20000)
+    bench:remove_signal("matches", matches)
+    return received, in_order
+end
+
+T.test_ipc_small_messages_arrive_in_order = function ()
+    w:new_tab(test.http_server() .. "hello_world.html")
+    local view = w.view
+    test.wait_for_view(view)
+
+    -- The first messages on a connection intern the channel and signal
+    -- names; later ones send only their ids
+    local received, in_order = round_trips(view, 10)
+    assert.is_equal(10, received)
+    assert.is_true(in_order)
+
+    -- Measure Lua memory allocated in the UI process, with the collector
+    -- stopped so that nothing is freed during the run
+    local count = 20000
+    collectgarbage()
+    collectgarbage("stop")
+    local mem = collectgarbage("count")
+    local start = os.clock()
+    received, in_order = round_trips(view, count)
+    local elapsed = os.clock() - start
+    local kb = collectgarbage("count") - mem
+    collectgarbage("restart")
+    assert.is_equal(count, received)
+    assert.is_true(in_order)
+
+    msg.info("%d IPC round trips: %.3fs UI process CPU (%.1fus each), "
+        .. "%.1f bytes allocated each", count, elapsed, elapsed / count * 1e6,
+        kb * 1024 / count)
+    assert.is_true(elapsed < 20)
+    -- Received names are resolved without creating Lua strings; what is
+    -- left is the handler arguments and the test's own bookkeeping
+    assert.is_true(kb * 1024 / count < 1024)
+
+    -- Restore to initial state
+    w:close_tab()
+    assert.is_equal(1, w.tabs:current())
+end
+
+T.test_ipc_call = function ()
+    w:new_tab(test.http_server() .. "hello_world.html")
+    local view = w.view
+    test.wait_for_view(view)
+
+    -- Results are passed to the callback
+    bench:call(view, "echo", "a", 2, {}, {}, function (...)
+        test.continue(...)
+    end)
+    local ok, page_id, a, b, c = test.wait()
+    assert.is_true(ok)
+    assert.is_equal(view.id, page_id)
+    assert.is_equal("a", a)
+    assert.is_equal(2, b)
+    assert.is_same({}, c)
+
+    -- Calls without a handler fail
+    bench:call(view, "no_such_handler", nil, test.continue)
+    local err
+    ok, err = test.wait()
+    assert.is_false(ok)
+    assert.is_string(err)
+
+    -- Calls time out if the reply doesn't arrive in time; late replies
+    -- are dropped
+    local calls = 0
+    bench:call(view, "sleep", 0.5, { timeout = 50 }, function (...)
+        calls = calls + 1
+        test.continue(...)
+    end)
+    ok, err = test.wait()
+    assert.is_false(ok)
+    assert.is_equal("timed out", err)
+    test.delay(1000)
+    assert.is_equal(1, calls)
+
+    -- Batched calls are answered in order
+    local replies = {}
+    for i = 1, 100 do
+        bench:call(view, "echo", i, { batch = true }, function (_, _, n)
+            replies[#replies+1] = n
+            if #replies == 100 then test.continue() end
+        end)
+    end
+    test.wait()
+    for i = 1, 100 do assert.is_equal(i, replies[i]) end
+
+    -- Cancelled calls never call back
+    local id = bench:call(view, "echo", {}, function () calls = calls + 1 end)
+    assert.is_true(bench:cancel(id))
+    assert.is_false(bench:cancel(id))
+
+    -- Calls are cancelled when their view is destroyed
+    bench:call(view, "sleep", 0.2, {}, function () calls = calls + 1 end)
+    w:close_tab()
+    test.delay(500)
+    assert.is_equal(1, calls)
+    assert.is_equal(1, w.tabs:current())
+end
+
+return T
+
+-- vim: et:sw=4:ts=8:sts=4:tw=80
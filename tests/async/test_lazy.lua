@@ -0,0 +1,75 @@
+--- Test lazy module loading.
+--
+-- @copyright 2017 Aidan Holm
+
+local T = {}
+local test = require "tests.lib"
+local assert = require "luassert"
+
+uris = {"about:blank"}
+require "config.rc"
+
+local window = require "window"
+local lazy = require "lazy"
+local w = assert(select(2, next(window.bywidget)))
+
+local function close_tab()
+    w:close_tab()
+    assert.is_equal(1, w.tabs:current())
+end
+
+T.test_lazy_modules_load_on_first_use = function ()
+    for name in pairs(lazy.manifest) do
+        assert.is_nil(package.loaded[name], name .. " loaded at startup")
+    end
+    assert.is_nil(package.loaded.markdown)
+
+    -- Chrome page
+    w:new_tab("luakit://history/")
+    test.wait_for_view(w.view)
+    assert.is_not_nil(package.loaded.history_chrome)
+    assert.is_equal("luakit://history/", w.view.uri)
+
+    -- The page's exported functions reach the already running web process
+    w.view:eval_js("typeof history_search({ query: '' })", { callback = test.continue })
+    local ret, err = test.wait(1000)
+    assert.is_nil(err)
+    assert.is_equal("object", ret)
+    close_tab()
+
+    -- Binding; the stub calls the real binding once loaded
+    local ntabs = w.tabs:count()
+    w:hit({}, "g")
+    w:hit({}, "D")
+    assert.is_not_nil(package.loaded.downloads_chrome)
+    assert.is_equal(ntabs + 1, w.tabs:count())
+    test.wait_for_view(w.view)
+    assert.is_equal("luakit://downloads/", w.view.uri)
+    close_tab()
+
+    -- Stubs are replaced by the real bindings
+    for _, b in ipairs(require("modes").get_mode("normal").binds) do
+        if b.type == "buffer" and b.pattern == "^gD$" then
+            assert.is_not_nil(b.desc)
+        end
+    end
+
+    -- Command
+    w:run_cmd(":bookmarks")
+    assert.is_not_nil(package.loaded.bookmarks_chrome)
+    test.wait_for_view(w.view)
+    assert.is_equal("luakit://bookmarks/", w.view.uri)
+    close_tab()
+
+    -- Time that loading the remaining deferred modules at startup would take
+    local start = os.clock()
+    lazy.load_all()
+    msg.info("remaining deferred modules: %.1fms", (os.clock() - start) * 1000)
+    for name in pairs(lazy.manifest) do
+        assert.is_not_nil(package.loaded[name])
+    end
+end
+
+return T
+
+-- vim: et:sw=4:ts=8:sts=4:tw=80
@@ -0,0 +1,68 @@
+--- Test load-status snapshots.
+--
+-- @copyright 2017 Aidan Holm
+
+local T = {}
+local test = require "tests.lib"
+local assert = require "luassert"
+
+uris = {"about:blank"}
+require "config.rc"
+
+local window = require "window"
+local domain_props = require "domain_props"
+local w = assert(select(2, next(window.bywidget)))
+
+local iterations = 500
+
+T.test_load_status_snapshot = function ()
+    local view = w:new_tab()
+    local loads = {}
+    view:add_signal("load-status", function (_, status, load)
+        if status ~= "failed" then loads[status] = load end
+    end)
+    local uri = test.http_server() .. "hello_world.html"
+    view.uri = uri
+    test.wait_for_view(view)
+
+    -- Eagerly filled fields
+    local load = assert(loads.committed)
+    assert.is_equal(view, rawget(load, "view"))
+    assert.is_equal("committed", rawget(load, "status"))
+    assert.is_equal(uri, rawget(load, "uri"))
+
+    -- Lazily computed fields are cached after the first access
+    assert.is_nil(rawget(load, "history_index"))
+    assert.is_equal(view.history.index, load.history_index)
+    assert.is_equal(view.history.index, rawget(load, "history_index"))
+    assert.is_equal(view:can_go_back(), load.can_go_back)
+    assert.is_nil(load.ssl_trusted)
+    assert.is_nil(load.certificate)
+    assert.is_equal(#view.history.items, #load.history.items)
+    assert.is_nil(load.no_such_field)
+
+    -- Benchmark the load-status handlers of the default config. Private
+    -- browsing keeps the synthetic loads out of the history database, and
+    -- domain_props resolves no properties, so they aren't applied each time
+    local meta = getmetatable(load)
+    local resolve = domain_props.resolve
+    domain_props.resolve = function () return {} end
+    view.enable_private_browsing = true
+    local elapsed = test.bench("load-status 'committed' handlers", iterations, function ()
+        local fresh = setmetatable({ view = view, status = "committed",
+            uri = load.uri, title = load.title }, meta)
+        view:emit_signal("load-status", "committed", fresh)
+    end)
+    domain_props.resolve = resolve
+    local us = elapsed / iterations * 1e6
+    msg.info("load-status 'committed' handlers: %.1f µs per transition", us)
+    assert.is_true(us < 5000)
+
+    -- Restore to initial state
+    w:close_tab(view)
+    assert.is_equal(1, w.tabs:current())
+end
+
+return T
+
+-- vim: et:sw=4:ts=8:sts=4:tw=80
@@ -0,0 +1,63 @@
+--- Test memory usage statistics.
+--
+-- @copyright 2017 Aidan Holm
+
+local T = {}
+local test = require "tests.lib"
+local assert = require "luassert"
+
+T.test_memory_stats = function ()
+    local db = sqlite3{filename=":memory:"}
+    db:exec("CREATE TABLE t (x INTEGER)")
+    local view = widget{type="webview"}
+    view.uri = "about:blank"
+    test.wait_for_view(view)
+
+    local stats = luakit.memory_stats()
+    assert.is_true(stats.ui.pid > 0)
+    assert.is_true(stats.ui.rss_kb > 0)
+    assert.is_true(stats.ui.lua_kb > 0)
+    assert.is_true(stats.tables.registry > 0)
+    assert.is_true(stats.tables.modules > 0)
+    assert.is_number(stats.tables.registry_tables["luakit.registry.ipc_channel"])
+    assert.is_true(stats.sqlite.memory_used_kb >= 0)
+    local handle
+    for _, h in ipairs(stats.sqlite.handles) do
+        if h.filename == ":memory:" then handle = h end
+    end
+    assert.is_table(handle)
+    assert.is_number(handle.cache_kb)
+
+    -- The webview is listed under its web process
+    local found
+    for _, p in ipairs(stats.web_processes) do
+        for _, v in ipairs(p.views) do
+            if v == view then found = p end
+        end
+    end
+    assert.is_table(found)
+    assert.is_equal(view.web_process_id, found.pid)
+    assert.is_true(found.rss_kb > 0)
+
+    -- Web process Lua heap sizes are reported on the next sample
+    test.delay(100)
+    stats = luakit.memory_stats()
+    for _, p in ipairs(stats.web_processes) do
+        if p.pid == found.pid then found = p end
+    end
+    assert.is_true(found.lua_kb > 0)
+
+    -- Sampling is cheap
+    local start = luakit.time()
+    for _ = 1, 20 do luakit.memory_stats() end
+    local elapsed = (luakit.time() - start) / 20
+    msg.info("memory_stats() takes %.2fms", elapsed * 1000)
+    assert.is_true(elapsed < 0.05)
+
+    view:destroy()
+    db:close()
+end
+
+return T
+
+-- vim: et:sw=4:ts=8:sts=4:tw=80
@@ -0,0 +1,90 @@
+--- Test notebook page bookkeeping.
+--
+-- @copyright 2017 Aidan Holm
+
+local test = require "tests.lib"
+local assert = require "luassert"
+local taborder = require "taborder"
+
+local T = {}
+
+local ntabs = 1000
+
+local function new_notebook(n)
+    local nb = widget{type="notebook"}
+    local pages = {}
+    for i = 1, n do
+        pages[i] = widget{type="label"}
+        nb:insert(pages[i])
+    end
+    return nb, pages
+end
+
+T.test_notebook_index_cache = function ()
+    local nb, pages = new_notebook(5)
+    assert.is_equal(5, nb:count())
+    assert.is_equal(5, #nb.children)
+    for i, page in ipairs(pages) do
+        assert.is_equal(i, nb:indexof(page))
+        assert.is_equal(page, nb:nth(i))
+        assert.is_equal(page, nb[i])
+    end
+    assert.is_equal(pages[5], nb:nth(-1))
+    assert.is_nil(nb:nth(6))
+    assert.is_nil(nb:indexof(widget{type="label"}))
+
+    -- Cache follows reorders and removals
+    nb:reorder(pages[5], 1)
+    assert.is_equal(1, nb:indexof(pages[5]))
+    assert.is_equal(2, nb:indexof(pages[1]))
+    nb:remove(pages[1])
+    assert.is_equal(4, nb:count())
+    assert.is_nil(nb:indexof(pages[1]))
+    assert.is_equal(pages[2], nb:nth(2))
+    nb:insert(1, pages[1])
+    assert.is_equal(1, nb:indexof(pages[1]))
+    assert.is_equal(pages[5], nb.children[2])
+end
+
+T.test_notebook_1000_tabs = function ()
+    local nb, pages = new_notebook(ntabs)
+    assert.is_equal(ntabs, nb:count())
+
+    local elapsed = test.bench("indexof", 100000, function (i)
+        local page = pages[i % ntabs + 1]
+        assert(nb:indexof(page) == i % ntabs + 1)
+    end)
+    elapsed = elapsed + test.bench("nth", 100000, function (i)
+        assert(nb:nth(i % ntabs + 1) == pages[i % ntabs + 1])
+    end)
+    elapsed = elapsed + test.bench("count", 100000, function ()
+        assert(nb:count() == ntabs)
+    end)
+    -- Lookups are constant time; a linear scan per call would take minutes
+    assert.is_true(elapsed < 5, "notebook lookups too slow")
+end
+
+T.test_by_origin_1000_tabs = function ()
+    local nb, pages = new_notebook(ntabs)
+    local w = { tabs = nb, view = pages[1] }
+
+    -- Every new tab follows the previous descendants of the current tab
+    local kids = taborder.kidsof
+    kids[pages[1]] = {}
+    for i = 2, ntabs do table.insert(kids[pages[1]], pages[i]) end
+
+    local elapsed = test.bench("by_origin", 100, function ()
+        assert(taborder.after_descendants(w, pages[1]) == ntabs + 1)
+    end)
+    assert.is_true(elapsed < 5, "by_origin too slow")
+
+    -- A non-descendant ends the chain
+    kids[pages[1]] = { pages[2], pages[3] }
+    kids[pages[3]] = { pages[4] }
+    assert.is_equal(5, taborder.after_descendants(w, pages[1]))
+    kids[pages[1]], kids[pages[3]] = nil, nil
+end
+
+return T
+
+-- vim: et:sw=4:ts=8:sts=4:tw=80
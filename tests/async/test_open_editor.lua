@@ -0,0 +1,96 @@
+--- Test external editor sessions.
+--
+-- @copyright 2017 Aidan Holm
+
+local T = {}
+local test = require "tests.lib"
+local assert = require "luassert"
+
+uris = {"about:blank"}
+require "config.rc"
+
+local open_editor = require "open_editor"
+local window = require "window"
+local w = assert(select(2, next(window.bywidget)))
+
+local function eval(js)
+    w.view:eval_js(js, { callback = function (ret, err)
+        test.continue(ret, err)
+    end })
+    local ret, err = test.wait(1000)
+    assert.is_nil(err)
+    return ret
+end
+
+T.test_watch_file = function ()
+    local dir = luakit.cache_dir .. "/test-watch-file"
+    os.execute("mkdir -p " .. dir)
+    local events = {}
+    local id = luakit.watch_file(dir, function (event, path)
+        events[#events+1] = { event, path }
+        if #events == 1 then test.continue() end
+    end)
+    assert.is_number(id)
+
+    local f = io.open(dir .. "/a.txt", "w")
+    f:write("a")
+    f:close()
+    test.wait(2000)
+    assert.is_equal(dir .. "/a.txt", events[1][2])
+
+    assert.is_true(luakit.unwatch_file(id))
+    assert.is_false(luakit.unwatch_file(id))
+    os.remove(dir .. "/a.txt")
+    os.remove(dir)
+
+    assert.has_error(function () luakit.watch_file(dir, nil) end)
+end
+
+T.test_edit_session = function ()
+    w.view:load_string("<textarea id=t>old text</textarea>", "about:blank")
+    test.wait_for_view(w.view)
+    eval("document.getElementById('t').focus()")
+
+    -- The editor command exits straight away, as xdg-open does; its
+    -- change to the file is copied to the input
+    local src = luakit.cache_dir .. "/test-open-editor.txt"
+    local f = io.open(src, "w")
+    f:write("new text\n")
+    f:close()
+    local old_cmd = open_editor.editor_cmd
+    open_editor.editor_cmd = "cp " .. src .. " {file}"
+    open_editor.edit_externally(w)
+
+    local js = "var t = document.getElementById('t'); t.value + ':' + t.readOnly"
+    test.wait_until(function () return eval(js) == "new text:true" end, 50, 5000)
+
+    -- The editor leaves no lock file, so editing the input again ends the
+    -- session
+    open_editor.edit_externally(w)
+    test.wait_until(function () return eval(js) == "new text:false" end, 50, 5000)
+    open_editor.edit_externally(w)
+    test.wait_until(function () return eval(js) == "new text:true" end, 50, 5000)
+
+    -- Navigating away ends the session
+    w.view:load_string("<textarea id=t>old text</textarea>", "about:blank")
+    test.wait_for_view(w.view)
+    eval("document.getElementById('t').focus()")
+
+    -- If the editor command doesn't hand the file to another process, the
+    -- session ends when it exits
+    f = io.open(src, "w")
+    f:write("final text\n")
+    f:close()
+    local old_threshold = open_editor.fork_threshold
+    open_editor.fork_threshold = 0
+    open_editor.edit_externally(w)
+    test.wait_until(function () return eval(js) == "final text:false" end, 50, 5000)
+
+    open_editor.editor_cmd = old_cmd
+    open_editor.fork_threshold = old_threshold
+    os.remove(src)
+end
+
+return T
+
+-- vim: et:sw=4:ts=8:sts=4:tw=80
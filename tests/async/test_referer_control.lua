@@ -0,0 +1,72 @@
+--- Test native Referer header filtering.
+--
+-- @copyright 2017 Aidan Holm
+
+local T = {}
+local test = require "tests.lib"
+local assert = require "luassert"
+
+uris = {"about:blank"}
+require "config.rc"
+
+local window = require "window"
+local referer_control = require "referer_control"
+local w = assert(select(2, next(window.bywidget)))
+
+local page_uri = test.http_server() .. "hello_world.html"
+local same_origin = "http://127.0.0.1:8888/echo-headers"
+local cross_origin = "http://localhost:8888/echo-headers"
+
+-- Fetch the echoed Referer header of a request made by the page
+local function referer_for(view, target)
+    view:eval_js(string.format([=[
+        var xhr = new XMLHttpRequest();
+        xhr.open("GET", "%s?" + Math.random(), false);
+        xhr.send();
+        var m = xhr.responseText.match(/^Referer: (.*)$/mi);
+        m ? m[1] : "";
+    ]=], target), { callback = test.continue })
+    local referer = test.wait()
+    return referer ~= "" and referer or nil
+end
+
+-- Set a policy and reload the page so it is picked up
+local function with_policy(policy, domain)
+    referer_control.set_policy(policy, domain)
+    test.delay(100)
+    w.view.uri = page_uri
+    test.wait_for_view(w.view)
+end
+
+T.test_referer_policies = function ()
+    w:new_tab(page_uri)
+    local view = w.view
+    test.wait_for_view(view)
+
+    with_policy("same-origin")
+    assert.is_equal(page_uri, referer_for(view, same_origin))
+    assert.is_nil(referer_for(view, cross_origin))
+
+    with_policy("origin-only")
+    assert.is_equal(test.http_server(), referer_for(view, same_origin))
+    assert.is_equal(test.http_server(), referer_for(view, cross_origin))
+
+    with_policy("none")
+    assert.is_nil(referer_for(view, same_origin))
+    assert.is_nil(referer_for(view, cross_origin))
+
+    -- Domain overrides take precedence over the default policy
+    with_policy("origin-only", "127.0.0.1")
+    assert.is_equal(test.http_server(), referer_for(view, cross_origin))
+    with_policy(nil, "127.0.0.1")
+    assert.is_nil(referer_for(view, cross_origin))
+
+    -- Restore to initial state
+    referer_control.set_policy("same-origin")
+    w:close_tab()
+    assert.is_equal(1, w.tabs:current())
+end
+
+return T
+
+-- vim: et:sw=4:ts=8:sts=4:tw=80
@@ -0,0 +1,68 @@
+--- Test installation of functions registered with luakit.register_function().
+--
+-- @copyright 2017 Aidan Holm
+
+local T = {}
+local test = require "tests.lib"
+local assert = require "luassert"
+
+uris = {"about:blank"}
+require "config.rc"
+
+local lousy = require "lousy"
+local window = require "window"
+local w = assert(select(2, next(window.bywidget)))
+
+local nframes = 200
+local page_uri = test.http_server() .. "iframes.html"
+local page_pattern = "^" .. lousy.util.lua_escape(test.http_server())
+
+-- Functions must be registered before the web process starts
+local function noop() end
+for i = 1, 100 do
+    luakit.register_function("^http://other" .. i .. "%.test/", "other_" .. i, noop)
+end
+luakit.register_function("^http://[^/]*other%.test/", "other_find", noop)
+luakit.register_function(page_pattern, "test_main_only", noop)
+luakit.register_function(page_pattern, "test_all_frames", noop, { all_frames = true })
+
+local function eval(view, js)
+    view:eval_js(js, { callback = test.continue })
+    return test.wait()
+end
+
+T.test_register_function_frames = function ()
+    local iframes = {}
+    for i = 1, nframes do
+        iframes[i] = string.format('<iframe srcdoc="<p>%d</p>"></iframe>', i)
+    end
+    local html = "<html><body>" .. table.concat(iframes) .. "</body></html>"
+
+    local view = w:new_tab()
+    local start = luakit.time()
+    view:load_string(html, page_uri)
+    test.wait_for_view(view)
+    msg.info("page with %d iframes loaded in %.1f ms", nframes,
+        (luakit.time() - start) * 1000)
+
+    assert.is_equal(nframes, eval(view, "frames.length"))
+
+    -- Functions are installed in the main frame if the pattern matches
+    assert.is_equal("function", eval(view, "typeof test_main_only"))
+    assert.is_equal("function", eval(view, "typeof test_all_frames"))
+    assert.is_equal("undefined", eval(view, "typeof other_1"))
+    assert.is_equal("undefined", eval(view, "typeof other_find"))
+
+    -- Only registrations that ask for it are installed in subframes
+    assert.is_equal("undefined", eval(view, "typeof frames[0].test_main_only"))
+    assert.is_equal("function", eval(view, "typeof frames[0].test_all_frames"))
+    assert.is_equal("function", eval(view, "typeof frames[" .. (nframes-1) .. "].test_all_frames"))
+
+    -- Restore to initial state
+    w:close_tab(view)
+    assert.is_equal(1, w.tabs:current())
+end
+
+return T
+
+-- vim: et:sw=4:ts=8:sts=4:tw=80
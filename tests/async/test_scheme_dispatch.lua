@@ -0,0 +1,66 @@
+--- Test native dispatch of custom URI scheme requests.
+--
+-- @copyright 2017 Aidan Holm
+
+local T = {}
+local test = require "tests.lib"
+local assert = require "luassert"
+
+local function body_text(view)
+    view:eval_js("document.body.textContent", { callback = function (ret, err)
+        test.continue(ret, err)
+    end })
+    local ret, err = test.wait(1000)
+    assert.is_nil(err)
+    return ret
+end
+
+T.test_scheme_dispatch = function ()
+    assert.has_error(function () luakit.register_scheme_page("no-such-scheme", "a", print) end)
+    assert.has_error(function () luakit.register_scheme_asset("no-such-scheme", "a/b", "") end)
+
+    local calls = {}
+    luakit.register_scheme("test-dispatch", function (_, uri, request, page, path)
+        calls[#calls+1] = { "default", uri, page, path }
+        request:finish("<body>default</body>")
+    end)
+    luakit.register_scheme_page("test-dispatch", "hello", function (v, uri, request, page, path)
+        assert.is_equal("webview", v.type)
+        calls[#calls+1] = { "hello", uri, page, path }
+        request:finish("<body>hello " .. path .. "</body>")
+    end)
+    luakit.register_scheme_asset("test-dispatch", "hello/asset.txt", "static asset", "text/plain")
+    assert.has_error(function () luakit.register_scheme_asset("test-dispatch", "noslash", "") end)
+
+    local view = widget{type="webview"}
+
+    -- Page handlers are called with the page and path
+    view.uri = "test-dispatch://hello/world"
+    test.wait_for_view(view)
+    assert.same({ "hello", "test-dispatch://hello/world", "hello", "world" }, calls[1])
+    assert.is_equal("hello world", body_text(view))
+
+    -- Assets are served without calling any handler
+    view.uri = "test-dispatch://hello/asset.txt?v=2"
+    test.wait_for_view(view)
+    assert.is_equal(1, #calls)
+    assert.is_equal("static asset", body_text(view))
+
+    -- Pages without a handler go to the default handler
+    view.uri = "test-dispatch://other"
+    test.wait_for_view(view)
+    assert.same({ "default", "test-dispatch://other", "other", "" }, calls[2])
+
+    -- Removed pages and assets fall back to the default handler too
+    luakit.register_scheme_page("test-dispatch", "hello", nil)
+    luakit.register_scheme_asset("test-dispatch", "hello/asset.txt", nil)
+    view.uri = "test-dispatch://hello/asset.txt"
+    test.wait_for_view(view)
+    assert.same({ "default", "test-dispatch://hello/asset.txt", "hello", "asset.txt" }, calls[3])
+
+    view:destroy()
+end
+
+return T
+
+-- vim: et:sw=4:ts=8:sts=4:tw=80
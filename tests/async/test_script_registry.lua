@@ -0,0 +1,75 @@
+--- Test evaluation of large scripts registered by content hash.
+--
+-- @copyright 2017 Aidan Holm
+
+local T = {}
+local test = require "tests.lib"
+local assert = require "luassert"
+
+uris = {"about:blank"}
+require "config.rc"
+
+local function eval(view, js)
+    view:eval_js(js, { callback = function (ret, err)
+        test.continue(ret, err)
+    end })
+    return test.wait(2000)
+end
+
+-- A script long enough to be registered, that returns its argument
+local function large_script(value)
+    return string.rep("// padding\n", 200) .. "(function () { return " .. value .. "; })()"
+end
+
+T.test_registered_scripts = function ()
+    local a, b = widget{type="webview"}, widget{type="webview"}
+    for _, view in ipairs({a, b}) do
+        view.uri = "about:blank"
+        test.wait_for_view(view)
+    end
+
+    local js = large_script("document.title + 42")
+    assert.is_true(#js >= 1024)
+
+    -- The same script can be evaluated repeatedly, on any view
+    assert.is_equal("42", eval(a, js))
+    assert.is_equal("42", eval(a, js))
+    assert.is_equal("42", eval(b, js))
+    assert.is_equal(7, eval(b, large_script("7")))
+
+    -- Short scripts are sent in full
+    assert.is_equal(3, eval(a, "1 + 2"))
+
+    -- Errors are reported as before
+    local ret, err = eval(a, large_script("undefined_variable"))
+    assert.is_nil(ret)
+    assert.truthy(err:find("undefined_variable"))
+
+    a:destroy()
+    b:destroy()
+end
+
+T.test_chrome_pages_benchmark = function ()
+    local npages = 50
+    local views = {}
+    local start = luakit.time()
+    for i = 1, npages do
+        views[i] = widget{type="webview"}
+        views[i].uri = "luakit://downloads/"
+    end
+    for i = 1, npages do
+        test.wait_for_view(views[i])
+        -- Wait for the page scripts to have run
+        repeat
+            test.delay(10)
+        until eval(views[i], "typeof $") == "function"
+    end
+    local elapsed = luakit.time() - start
+    msg.info("opening %d chrome pages took %.1fms", npages, elapsed * 1000)
+
+    for _, view in ipairs(views) do view:destroy() end
+end
+
+return T
+
+-- vim: et:sw=4:ts=8:sts=4:tw=80
@@ -0,0 +1,126 @@
+--- Test time-sliced tasks.
+--
+-- @copyright 2017 Aidan Holm
+
+local T = {}
+local test = require "tests.lib"
+local assert = require "luassert"
+
+-- Wait for a task to end, returning the values it finished with
+local function wait_task(t, timeout)
+    if t.status == "finished" or t.status == "failed" or t.status == "cancelled" then
+        return
+    end
+    t:add_signal("finished", function (_, ...) test.continue(...) end)
+    return test.wait(timeout)
+end
+
+T.test_input_stays_responsive_during_long_task = function ()
+    local win = widget{type="window"}
+    win:show()
+    -- Each key press is queued like real input, and its latency is the time
+    -- until the main loop delivers it to the window
+    local keys, sent, max_latency = 0, nil, 0
+    win:add_signal("key-press", function ()
+        if not sent then return end
+        keys = keys + 1
+        max_latency = math.max(max_latency, luakit.time() - sent)
+        sent = nil
+        return true
+    end)
+
+    -- Each timer tick queues a key press, unless the last is still pending
+    local max_gap, last = 0, luakit.time()
+    local tmr = timer{ interval = 20 }
+    tmr:add_signal("timeout", function ()
+        local now = luakit.time()
+        max_gap = math.max(max_gap, now - last)
+        last = now
+        if not sent then
+            sent = now
+            win:send_key({}, "a", true)
+        end
+    end)
+    tmr:start()
+
+    local duration = 2
+    local t = luakit.task(function (task)
+        local start, iterations = luakit.time(), 0
+        while luakit.time() - start < duration do
+            iterations = iterations + 1
+            task.yield()
+        end
+        return iterations
+    end)
+    assert.is_equal("pending", t.status)
+    assert.is_equal("default", t.priority)
+
+    local iterations = wait_task(t, (duration + 2) * 1000)
+    tmr:stop()
+    msg.info("%d task iterations; %d key events, longest key latency %.1fms, "
+        .. "longest gap between timer ticks %.1fms", iterations, keys, max_latency * 1000, max_gap * 1000)
+
+    assert.is_equal("finished", t.status)
+    assert.is_true(iterations > 0)
+    assert.is_true(keys >= duration / 0.02 / 2)
+    assert.is_true(max_latency < 0.1)
+    assert.is_true(max_gap < 0.1)
+    win:destroy()
+end
+
+T.test_task_scheduling = function ()
+    -- Higher priority tasks run first
+    local order = {}
+    local low = luakit.task(function () order[#order+1] = "low" end, { priority = "low" })
+    local default = luakit.task(function () order[#order+1] = "default" end)
+    local high = luakit.task(function () order[#order+1] = "high" end, { priority = "high" })
+    wait_task(low, 1000)
+    wait_task(default, 1000)
+    wait_task(high, 1000)
+    assert.same({"high", "default", "low"}, order)
+
+    -- Sleeping tasks are resumed once their time is up
+    local start = luakit.time()
+    local elapsed = wait_task(luakit.task(function (task)
+        task:sleep(200)
+        return luakit.time() - start
+    end), 1000)
+    assert.is_true(elapsed >= 0.2)
+
+    -- Pending tasks can be cancelled before they run
+    local ran = false
+    local pending = luakit.task(function () ran = true end)
+    assert.is_true(pending:cancel())
+    assert.is_equal("cancelled", pending.status)
+    test.delay(50)
+    assert.is_false(ran)
+
+    -- Running tasks stop at the next yield after being cancelled
+    local steps = 0
+    local running = luakit.task(function (task)
+        while true do
+            steps = steps + 1
+            if steps == 3 then task:cancel() end
+            task:sleep(1)
+        end
+    end)
+    wait_task(running, 1000)
+    assert.is_equal("cancelled", running.status)
+    assert.is_equal(3, steps)
+
+    -- Errors are reported, and end the task
+    local failing = luakit.task(function () error("task error") end)
+    local err = wait_task(failing, 1000)
+    assert.is_equal("failed", failing.status)
+    assert.is_truthy(err:find("task error", 1, true))
+
+    -- yield() can only be called from within the task
+    assert.has_error(function () high.yield() end)
+
+    assert.has_error(function () luakit.task(function () end, { priority = "urgent" }) end)
+    assert.has_error(function () luakit.task(function () end, { budget_ms = 0 }) end)
+end
+
+return T
+
+-- vim: et:sw=4:ts=8:sts=4:tw=80
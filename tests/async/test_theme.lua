@@ -0,0 +1,103 @@
+--- Test theme stylesheet application.
+--
+-- @copyright 2017 Aidan Holm
+
+local T = {}
+local test = require "tests.lib"
+local assert = require "luassert"
+
+uris = {"about:blank"}
+require "config.rc"
+
+local lousy = require "lousy"
+local window = require "window"
+local w = assert(select(2, next(window.bywidget)))
+
+T.test_theme_compile = function ()
+    local css = lousy.theme.compile({ tab_bg = "#123", tab_fg = "#456", tab_font = "10px sans" })
+    assert.truthy(css:find(".tab { background-color: #123; }", 1, true))
+    assert.truthy(css:find(".tab label { color: #456; font: 10px sans; }", 1, true))
+    -- Rules without any theme values are left out
+    assert.falsy(css:find(".tablist", 1, true))
+
+    -- Installing the same stylesheet again is a no-op
+    lousy.theme.apply()
+    assert.is_false(luakit.set_theme_css(lousy.theme.compile()))
+    assert.has_error(function () luakit.set_theme_css("{{{") end)
+end
+
+T.test_widget_classes = function ()
+    local label = widget{type="label"}
+    assert.is_false(label:has_class("tab"))
+    label:add_class("tab")
+    label:add_class("tab")
+    assert.is_true(label:has_class("tab"))
+    label:remove_class("tab")
+    assert.is_false(label:has_class("tab"))
+    label:destroy()
+    assert.has_error(function () label:add_class("tab") end)
+end
+
+T.test_theme_update = function ()
+    local theme = lousy.theme.get()
+    local old_bg = theme.tab_bg
+    lousy.theme.update({ tab_bg = "#010203" })
+    -- References to the theme table stay valid
+    assert.is_equal(theme, lousy.theme.get())
+    assert.is_equal("#010203", theme.tab_bg)
+    assert.truthy(lousy.theme.compile():find("#010203", 1, true))
+    lousy.theme.update({ tab_bg = old_bg })
+    assert.is_equal(old_bg, theme.tab_bg)
+end
+
+T.test_tab_classes = function ()
+    local tab = require "lousy.widget.tab"
+    local view = widget{type="webview"}
+    local tl = tab(view, 1)
+    assert.is_true(tl.widget:has_class("tab"))
+    assert.is_false(tl.widget:has_class("selected"))
+    tl.current = true
+    assert.is_true(tl.widget:has_class("selected"))
+    tl.current = false
+    assert.is_false(tl.widget:has_class("selected"))
+    tl:destroy()
+    view:destroy()
+end
+
+T.test_tab_restyle_benchmark = function ()
+    local ntabs = 500
+    local views = {}
+    for i = 1, ntabs do views[i] = w:new_tab(nil, false) end
+
+    -- Wait for the new tabs to be laid out
+    test.delay(500)
+
+    -- Switching tabs toggles classes on the old and new tab only
+    local start = luakit.time()
+    for i = 1, w.tabs:count() do w.tabs:switch(i) end
+    local switch_ms = (luakit.time() - start) * 1000
+
+    -- A theme change is one stylesheet update
+    local theme = lousy.theme.get()
+    local old_bg, old_selected_bg = theme.tab_bg, theme.tab_selected_bg
+    start = luakit.time()
+    lousy.theme.update({ tab_bg = "#111", tab_selected_bg = "#333" })
+    local theme_ms = (luakit.time() - start) * 1000
+
+    -- Include the time taken to restyle and redraw the tablist
+    start = luakit.time()
+    test.delay(0)
+    local redraw_ms = (luakit.time() - start) * 1000
+
+    msg.info("%d tabs: switching through all tabs took %.1fms; "
+        .. "theme change took %.1fms, then %.1fms until idle",
+        w.tabs:count(), switch_ms, theme_ms, redraw_ms)
+
+    lousy.theme.update({ tab_bg = old_bg, tab_selected_bg = old_selected_bg })
+    w:close_tabs(views)
+    assert.is_true(theme_ms < 100)
+end
+
+return T
+
+-- vim: et:sw=4:ts=8:sts=4:tw=80
@@ -0,0 +1,76 @@
+--- Test startup tracing.
+--
+-- @copyright 2017 Aidan Holm
+
+local T = {}
+local test = require "tests.lib"
+local assert = require "luassert"
+
+uris = {"about:blank"}
+require "config.rc"
+
+local window = require "window"
+local w = assert(select(2, next(window.bywidget)))
+
+-- Validate the trace in JavaScript, and return some statistics
+local check_js = [=[
+    (function (trace) {
+        var pids = {}, spans = {}, bad = 0;
+        trace.traceEvents.forEach(function (e) {
+            if (typeof e.pid !== "number" || typeof e.name !== "string")
+                bad++;
+            if (e.ph === "M")
+                return;
+            if (typeof e.ts !== "number" || (e.ph === "X" && typeof e.dur !== "number"))
+                bad++;
+            pids[e.pid] = true;
+            spans[e.cat] = (spans[e.cat] || 0) + 1;
+        });
+        return [trace.traceEvents.length, Object.keys(pids).length,
+            spans.require || 0, spans.startup || 0, spans.ipc || 0, bad];
+    })(JSON.parse("%s"))
+]=]
+
+-- Quote a string for use inside a double-quoted JavaScript string literal
+local function js_quote(str)
+    return (string.gsub(str, '[%c\\"]', function (c)
+        return string.format("\\u%04x", string.byte(c))
+    end))
+end
+
+T.test_startup_trace_is_well_formed = function ()
+    local file = os.tmpname()
+    local cmd = string.format("./luakit -U --log=error --trace=%s -c tests/async/trace_startup.lua %s",
+        file, test.http_server() .. "hello_world.html")
+    local start = os.time()
+    -- Spawn asynchronously, so this instance's main loop keeps running
+    luakit.spawn(cmd, function (reason, status) test.continue(reason, status) end)
+    local reason, status = test.wait(60000)
+    assert.is_equal("exit", reason)
+    assert.is_equal(0, status)
+    msg.info("traced startup finished in about %ds", os.time() - start)
+
+    local f = assert(io.open(file, "r"))
+    local trace = f:read("*a")
+    f:close()
+    os.remove(file)
+    assert.is_true(#trace > 0)
+
+    -- JSON.parse() throws if the trace isn't valid JSON
+    w.view:eval_js(string.format(check_js, js_quote(trace)), { callback = test.continue })
+    local stats, err = test.wait()
+    assert.is_nil(err)
+
+    local events, pids, require_spans, startup_spans, ipc_spans, bad = unpack(stats)
+    msg.info("%d events from %d processes: %d require, %d startup, %d ipc",
+        events, pids, require_spans, startup_spans, ipc_spans)
+    assert.is_equal(0, bad)
+    assert.is_true(pids >= 2, "no events from the web process")
+    assert.is_true(require_spans > 0)
+    assert.is_true(startup_spans > 0)
+    assert.is_true(ipc_spans > 0)
+end
+
+return T
+
+-- vim: et:sw=4:ts=8:sts=4:tw=80
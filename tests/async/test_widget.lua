@@ -2,6 +2,7 @@
 --
 -- @copyright 2017 Aidan Holm
 
+local test = require "tests.lib"
 local assert = require "luassert"
 
 local T = {}
@@ -25,6 +26,73 @@ T.test_bin_widget_set_child = function ()
     assert.is_nil(bin.child)
 end
 
+T.test_property_access_throughput = function ()
+    local label = widget{type="label"}
+    local view = widget{type="webview"}
+    local n = 100000
+
+    local elapsed = test.bench("widget get", n, function ()
+        local _ = label.text
+    end)
+    elapsed = elapsed + test.bench("widget set", n, function (i)
+        label.text = i % 2 == 0 and "a" or "b"
+    end)
+    elapsed = elapsed + test.bench("webview get", n, function ()
+        local _ = view.zoom_level
+    end)
+    elapsed = elapsed + test.bench("webview set", n, function (i)
+        view.zoom_level = i % 2 == 0 and 1 or 1.5
+    end)
+    elapsed = elapsed + test.bench("method lookup", n, function ()
+        local _ = view.add_signal
+    end)
+
+    assert.is_true(elapsed < 30, "property access too slow")
+    view:destroy()
+    label:destroy()
+end
+
+T.test_key_event_marshalling = function ()
+    local win = widget{type="window"}
+    win:show()
+
+    local keys = {"a", "Return", "Z", "Escape"}
+    local mods = {{}, {"Control"}, {"Shift"}, {"Control", "Mod1"}}
+    local seen_mods, seen_key = {}, {}
+    win:add_signal("key-press", function (_, m, k)
+        seen_mods[#seen_mods+1], seen_key[#seen_key+1] = m, k
+        return true
+    end)
+
+    -- Modifier tables are shared between events with the same modifiers
+    for i = 1, 2 do
+        assert.is_true(win:send_key(mods[2], keys[1]))
+        assert.is_equal(keys[1], seen_key[i])
+    end
+    assert.is_equal(seen_mods[1], seen_mods[2])
+    assert.same({"Control"}, seen_mods[1])
+    assert.has_error(function () win:send_key({"Hyper"}, "a") end)
+
+    local n = 100000
+    local handler = function () return true end
+    win:remove_signals("key-press")
+    win:add_signal("key-press", handler)
+
+    collectgarbage()
+    collectgarbage("stop")
+    local mem = collectgarbage("count")
+    local elapsed = test.bench("key events", n, function (i)
+        win:send_key(mods[i % 4 + 1], keys[i % 4 + 1])
+    end)
+    local kb = collectgarbage("count") - mem
+    collectgarbage("restart")
+    msg.info("key events: %.2f bytes allocated per event, %.2fus per event",
+        kb * 1024 / n, elapsed * 1e6 / n)
+
+    assert.is_true(elapsed < 30, "key event marshalling too slow")
+    win:destroy()
+end
+
 return T
 
 -- vim: et:sw=4:ts=8:sts=4:tw=80
@@ -0,0 +1,67 @@
+--- Test the shared status bar model.
+--
+-- @copyright 2017 Aidan Holm
+
+local T = {}
+local test = require "tests.lib"
+local assert = require "luassert"
+
+uris = {"about:blank"}
+require "config.rc"
+
+local window = require "window"
+local model = require "widget.model"
+local w = assert(select(2, next(window.bywidget)))
+
+local ntabs = 200
+
+T.test_handlers_only_fire_for_current_view = function ()
+    local calls = {}
+    local function count(_, field)
+        calls[field] = (calls[field] or 0) + 1
+    end
+    model.subscribe({"view", "tabs", "uri", "progress"}, count)
+
+    -- Opening many background tabs results in a single update
+    local views = {}
+    for i = 1, ntabs do
+        views[i] = w:new_tab(nil, false)
+    end
+    test.delay(100)
+    assert.is_equal(1, calls.tabs)
+    assert.is_nil(calls.view)
+
+    -- Changes to background views are not dispatched at all
+    calls = {}
+    for _, view in ipairs(views) do
+        view:emit_signal("property::uri")
+        view:emit_signal("property::progress")
+    end
+    assert.is_nil(calls.uri)
+    assert.is_nil(calls.progress)
+
+    -- Changes to the current view are dispatched once per subscriber
+    w.view:emit_signal("property::uri")
+    assert.is_equal(1, calls.uri)
+
+    -- Switching tabs rebinds the dispatcher to the new view
+    w.tabs:switch(w.tabs:indexof(views[1]))
+    test.delay(100)
+    assert.is_equal(1, calls.view)
+    calls = {}
+    views[1]:emit_signal("property::uri")
+    views[2]:emit_signal("property::uri")
+    assert.is_equal(1, calls.uri)
+
+    model.unsubscribe({"view", "tabs", "uri", "progress"}, count)
+
+    -- Restore to initial state
+    for _, view in ipairs(views) do
+        w:close_tab(view)
+    end
+    assert.is_equal(1, w.tabs:count())
+end
+
+return T
+
+-- vim: et:sw=4:ts=8:sts=4:tw=80
@@ -0,0 +1,62 @@
+--- Test wrap_js() function caching.
+--
+-- @copyright 2017 Aidan Holm
+
+local T = {}
+local test = require "tests.lib"
+local assert = require "luassert"
+
+uris = {"about:blank"}
+require "config.rc"
+
+local window = require "window"
+local w = assert(select(2, next(window.bywidget)))
+
+local wm = require_web_module("tests.async.wrap_js_wm")
+
+local function call(view, name, ...)
+    wm:call(view, name, ..., {}, function (ok, ...)
+        assert(ok, ...)
+        test.continue(...)
+    end)
+    return test.wait()
+end
+
+T.test_wrap_js_cache = function ()
+    w:new_tab(test.http_server() .. "hello_world.html")
+    local view = w.view
+    test.wait_for_view(view)
+
+    local count = 100000
+    local us, same, result, distinct = call(view, "bench", count)
+    msg.info("%d repeated wrap_js() calls: %.2fus each", count, us)
+    assert.is_true(same)
+    assert.is_equal(3, result)
+    assert.is_true(distinct)
+    assert.is_true(us < 100)
+
+    -- Errors from eval_js() without a source name report the caller
+    local ok, err = call(view, "eval_error")
+    assert.is_nil(ok)
+    assert.is_truthy(err:find("wrap_js_wm.lua", 1, true))
+    assert.is_truthy(err:find("boom", 1, true))
+
+    local released, value = call(view, "collect")
+    assert.is_true(released)
+    assert.is_equal(42, value)
+
+    -- Navigation invalidates the cache
+    local before = call(view, "identity")
+    assert.is_equal(before, call(view, "identity"))
+    view:reload()
+    test.wait_for_view(view)
+    assert.are_not_equal(before, call(view, "identity"))
+
+    -- Restore to initial state
+    w:close_tab()
+    assert.is_equal(1, w.tabs:current())
+end
+
+return T
+
+-- vim: et:sw=4:ts=8:sts=4:tw=80
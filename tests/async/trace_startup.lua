@@ -0,0 +1,18 @@
+--- Startup trace test - configuration of the traced luakit instance.
+--
+-- Loads the default configuration, and quits once the first page has
+-- finished loading, which is when the trace file is written.
+--
+-- @copyright 2017 Aidan Holm
+
+require "config.rc"
+
+local window = require "window"
+
+for _, w in pairs(window.bywidget) do
+    w.view:add_signal("load-status", function (_, status)
+        if status == "finished" then luakit.quit() end
+    end)
+end
+
+-- vim: et:sw=4:ts=8:sts=4:tw=80
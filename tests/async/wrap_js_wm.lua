@@ -0,0 +1,54 @@
+--- Test wrap_js() function caching - web module.
+--
+-- @copyright 2017 Aidan Holm
+
+local ui = ipc_channel("tests.async.wrap_js_wm")
+
+local script = "return a + b;"
+
+ui:add_signal("bench", function (_, page, count)
+    local first = page:wrap_js(script, {"a", "b"})
+    local start = os.clock()
+    local same = true
+    for _ = 1, count do
+        same = same and page:wrap_js(script, {"a", "b"}) == first
+    end
+    local elapsed = os.clock() - start
+    -- Different argument names give a different function
+    local other = page:wrap_js(script, {"b", "a"})
+    return elapsed / count * 1e6, same, first(1, 2), other ~= first
+end)
+
+-- Keep functions alive, so their addresses aren't reused
+local kept = {}
+
+ui:add_signal("identity", function (_, page)
+    local func = page:wrap_js(script, {"a", "b"})
+    kept[#kept+1] = func
+    return tostring(func)
+end)
+
+ui:add_signal("eval_error", function (_, page)
+    local ok, err = page:eval_js("throw new Error('boom');")
+    return ok, err
+end)
+
+-- Wrap functions without keeping them, in a separate stack frame so that
+-- no temporary references are left behind
+local function wrap_unreferenced(page, weak)
+    for i = 1, 100 do
+        weak[i] = page:wrap_js("return " .. i .. ";", {})
+    end
+end
+
+ui:add_signal("collect", function (_, page)
+    -- Functions that are no longer referenced are released; the cache
+    -- doesn't keep them alive
+    local weak = setmetatable({}, { __mode = "v" })
+    wrap_unreferenced(page, weak)
+    collectgarbage("collect")
+    local released = next(weak) == nil
+    return released, page:wrap_js("return 42;", {})()
+end)
+
+-- vim: et:sw=4:ts=8:sts=4:tw=80
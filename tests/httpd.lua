@@ -43,6 +43,15 @@ local function reply_with_file_contents(client, path)
     client:send("\n" .. contents)
 end
 
+local function reply_with_headers(client, headers)
+    local contents = table.concat(headers, "\n")
+    client:send("HTTP/1.0 200 OK\n")
+    client:send("Access-Control-Allow-Origin: *\n")
+    client:send(("Content-Length: %d\n"):format(#contents))
+    client:send("Content-type: text/plain\n")
+    client:send("\n" .. contents)
+end
+
 local function reply_with_404(client)
     client:send("HTTP/1.0 404 Not Found\n\n404 Not Found")
 end
@@ -51,11 +60,22 @@ local function handle_request(client)
     local line = assert(client:receive("*l"))
     local path = line:match("^GET (.*) HTTP/1%.1$")
 
+    -- Read request headers, up to the blank line
+    local headers = {}
+    repeat
+        line = client:receive("*l")
+        if line and line ~= "" then table.insert(headers, line) end
+    until not line or line == ""
+
     if not path then
         reply_with_not_implemented(client)
         return
     end
 
+    if path:match("^/echo%-headers") then
+        return reply_with_headers(client, headers)
+    end
+
     path = "tests/html" .. path
     local mode = lfs.attributes(path, "mode")
 
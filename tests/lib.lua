@@ -132,6 +132,30 @@ function _M.continue(...)
     shared_lib.resume_suspended_test(...)
 end
 
+--- Time a function, and log the result.
+--
+-- Calls `func` `iterations` times, passing it the iteration number, and
+-- logs the CPU time taken and the number of iterations per second.
+--
+-- @tparam string name The name to log the result under.
+-- @tparam number iterations The number of times to call `func`.
+-- @tparam function func The function to time.
+-- @treturn number The CPU time taken, in seconds.
+-- @return The value returned by the last call to `func`.
+function _M.bench(name, iterations, func)
+    assert(type(name) == "string", "Expected string")
+    assert(type(iterations) == "number", "Expected number")
+    assert(type(func) == "function", "Expected a function")
+
+    local result
+    local start = os.clock()
+    for i = 1, iterations do result = func(i) end
+    local elapsed = os.clock() - start
+    msg.info("%s: %d iterations in %.3fs (%.0f/s)", name, iterations,
+        elapsed, iterations / math.max(elapsed, 1e-6))
+    return elapsed, result
+end
+
 --- Get the URI prefix for the test HTTP server.
 --
 -- The port the test server listens on may not always be the same. This function
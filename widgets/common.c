@@ -19,9 +19,11 @@
  */
 
 #include <gtk/gtk.h>
+#include <string.h>
 
 #include "luah.h"
 #include "globalconf.h"
+#include "common/clib/gc.h"
 #include "common/luaobject.h"
 #include "common/lualib.h"
 #include "widgets/common.h"
@@ -30,6 +32,7 @@ gboolean
 key_press_cb(GtkWidget* UNUSED(win), GdkEventKey *ev, widget_t *w)
 {
     lua_State *L = globalconf.L;
+    gc_scheduler_input();
     luaH_object_push(L, w->ref);
     luaH_modifier_table_push(L, ev->state);
     luaH_keystr_push(L, ev->keyval);
@@ -44,6 +47,7 @@ button_cb(GtkWidget* UNUSED(win), GdkEventButton *ev, widget_t *w)
 {
     gint ret;
     lua_State *L = globalconf.L;
+    gc_scheduler_input();
     luaH_object_push(L, w->ref);
     luaH_modifier_table_push(L, ev->state);
     lua_pushinteger(L, ev->button);
@@ -397,4 +401,78 @@ luaH_widget_destroy(lua_State *L)
     return 0;
 }
 
+/* Synthesize a key press on the widget; mainly useful for testing. If the
+ * optional fourth argument is true, the event is put on the GDK event queue
+ * and delivered by the main loop like real input, and nothing is returned */
+gint
+luaH_widget_send_key(lua_State *L)
+{
+    widget_t *w = luaH_checkwidget(L, 1);
+    luaH_checktable(L, 2);
+    const gchar *key = luaL_checkstring(L, 3);
+    gboolean queue = lua_toboolean(L, 4);
+
+    static const struct {
+        const gchar *name;
+        GdkModifierType mask;
+    } modifiers[] = {
+        { "Shift",   GDK_SHIFT_MASK },
+        { "Lock",    GDK_LOCK_MASK },
+        { "Control", GDK_CONTROL_MASK },
+        { "Mod1",    GDK_MOD1_MASK },
+        { "Mod2",    GDK_MOD2_MASK },
+        { "Mod3",    GDK_MOD3_MASK },
+        { "Mod4",    GDK_MOD4_MASK },
+        { "Mod5",    GDK_MOD5_MASK },
+    };
+
+    guint state = 0;
+    gint n = lua_objlen(L, 2);
+    for (gint i = 1; i <= n; i++) {
+        lua_rawgeti(L, 2, i);
+        const gchar *mod = luaL_checkstring(L, -1);
+        guint m;
+        for (m = 0; m < LENGTH(modifiers); m++)
+            if (!strcmp(mod, modifiers[m].name))
+                break;
+        if (m == LENGTH(modifiers))
+            return luaL_error(L, "unknown modifier '%s'", mod);
+        state |= modifiers[m].mask;
+        lua_pop(L, 1);
+    }
+
+    guint keyval = g_utf8_strlen(key, -1) == 1
+        ? gdk_unicode_to_keyval(g_utf8_get_char(key))
+        : gdk_keyval_from_name(key);
+    if (keyval == GDK_KEY_VoidSymbol)
+        return luaL_argerror(L, 3, "unknown key");
+
+    GdkWindow *window = gtk_widget_get_window(w->widget);
+    if (!window)
+        return luaL_error(L, "cannot send key to unrealized widget");
+
+    GdkEvent *ev = gdk_event_new(GDK_KEY_PRESS);
+    ev->key.window = g_object_ref(window);
+    ev->key.send_event = TRUE;
+    ev->key.time = GDK_CURRENT_TIME;
+    ev->key.state = state;
+    ev->key.keyval = keyval;
+#if GTK_CHECK_VERSION(3,20,0)
+    GdkSeat *seat = gdk_display_get_default_seat(gdk_window_get_display(window));
+    gdk_event_set_device(ev, gdk_seat_get_keyboard(seat));
+#endif
+
+    if (queue) {
+        gdk_event_put(ev);
+        gdk_event_free(ev);
+        return 0;
+    }
+
+    gboolean handled = gtk_widget_event(w->widget, ev);
+    gdk_event_free(ev);
+
+    lua_pushboolean(L, handled);
+    return 1;
+}
+
 // vim: ft=c:et:sw=4:ts=8:sts=4:tw=80
@@ -49,6 +49,9 @@
       return 1;                                       \
     case L_TK_DESTROY:                                \
       lua_pushcfunction(L, luaH_widget_destroy);      \
+      return 1;                                       \
+    case L_TK_SEND_KEY:                               \
+      lua_pushcfunction(L, luaH_widget_send_key);     \
       return 1;
 
 #define LUAKIT_WIDGET_NEWINDEX_COMMON(widget)         \
@@ -91,6 +94,7 @@ gboolean true_cb();
 
 gint luaH_widget_destroy(lua_State*);
 gint luaH_widget_focus(lua_State*);
+gint luaH_widget_send_key(lua_State*);
 gint luaH_widget_get_child(lua_State*, widget_t*);
 gint luaH_widget_get_children(lua_State*, widget_t*);
 gint luaH_widget_hide(lua_State*);
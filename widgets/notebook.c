@@ -21,11 +21,61 @@
 #include "luah.h"
 #include "widgets/common.h"
 
+typedef struct {
+    /* Cached page order and page index map; rebuilt lazily */
+    GPtrArray *pages;
+    GHashTable *index;
+    /* Bumped whenever pages are added, removed or reordered */
+    guint version;
+    /* Version the cache was last built for */
+    guint cached_version;
+} notebook_data_t;
+
+static void
+notebook_invalidate(widget_t *w)
+{
+    notebook_data_t *d = w->data;
+    /* Pages are still removed after the destructor has run */
+    if (d)
+        d->version++;
+}
+
+/* Make sure the cached page order is up to date */
+static notebook_data_t *
+notebook_pages(widget_t *w)
+{
+    notebook_data_t *d = w->data;
+    if (d->cached_version == d->version)
+        return d;
+
+    g_ptr_array_set_size(d->pages, 0);
+    g_hash_table_remove_all(d->index);
+
+    GList *children = gtk_container_get_children(GTK_CONTAINER(w->widget));
+    for (GList *iter = children; iter; iter = iter->next) {
+        widget_t *child = GOBJECT_TO_LUAKIT_WIDGET(iter->data);
+        g_ptr_array_add(d->pages, child);
+        g_hash_table_insert(d->index, child, GUINT_TO_POINTER(d->pages->len));
+    }
+    g_list_free(children);
+
+    d->cached_version = d->version;
+    return d;
+}
+
+/* Returns the 1-based index of a child, or 0 if not in the notebook */
+static guint
+notebook_page_num(widget_t *w, widget_t *child)
+{
+    notebook_data_t *d = notebook_pages(w);
+    return GPOINTER_TO_UINT(g_hash_table_lookup(d->index, child));
+}
+
 static gint
 luaH_notebook_current(lua_State *L)
 {
     widget_t *w = luaH_checkwidget(L, 1);
-    gint n = gtk_notebook_get_n_pages(GTK_NOTEBOOK(w->widget));
+    guint n = notebook_pages(w)->pages->len;
     if (n == 1)
         lua_pushnumber(L, 1);
     else
@@ -37,36 +87,56 @@ luaH_notebook_current(lua_State *L)
 static gint
 luaH_notebook_atindex(lua_State *L, widget_t *w, gint idx)
 {
-    /* correct index */
-    if (idx != -1) idx--;
+    GPtrArray *pages = notebook_pages(w)->pages;
 
-    GtkWidget *widget = gtk_notebook_get_nth_page(GTK_NOTEBOOK(w->widget), idx);
-    if (!widget)
+    /* -1 is the last page */
+    if (idx == -1) idx = pages->len;
+    if (idx < 1 || (guint)idx > pages->len)
         return 0;
 
-    widget_t *child = GOBJECT_TO_LUAKIT_WIDGET(widget);
+    widget_t *child = g_ptr_array_index(pages, idx - 1);
     luaH_object_push(L, child->ref);
     return 1;
 }
 
+static gint
+luaH_notebook_nth(lua_State *L)
+{
+    widget_t *w = luaH_checkwidget(L, 1);
+    return luaH_notebook_atindex(L, w, luaL_checknumber(L, 2));
+}
+
 static gint
 luaH_notebook_indexof(lua_State *L)
 {
     widget_t *w = luaH_checkwidget(L, 1);
     widget_t *child = luaH_checkwidget(L, 2);
-    gint i = gtk_notebook_page_num(GTK_NOTEBOOK(w->widget), child->widget);
+    guint i = notebook_page_num(w, child);
     /* return index or nil */
-    if (!++i) return 0;
+    if (!i) return 0;
     lua_pushnumber(L, i);
     return 1;
 }
 
+static gint
+luaH_notebook_get_children(lua_State *L, widget_t *w)
+{
+    GPtrArray *pages = notebook_pages(w)->pages;
+
+    lua_createtable(L, pages->len, 0);
+    for (guint i = 0; i < pages->len; i++) {
+        luaH_object_push(L, ((widget_t*)g_ptr_array_index(pages, i))->ref);
+        lua_rawseti(L, -2, i + 1);
+    }
+    return 1;
+}
+
 static gint
 luaH_notebook_remove(lua_State *L)
 {
     widget_t *w = luaH_checkwidget(L, 1);
     widget_t *child = luaH_checkwidget(L, 2);
-    gint i = gtk_notebook_page_num(GTK_NOTEBOOK(w->widget), child->widget);
+    gint i = (gint)notebook_page_num(w, child) - 1;
 
     if (i == -1)
         luaL_argerror(L, 2, "child not in notebook");
@@ -107,7 +177,7 @@ static gint
 luaH_notebook_count(lua_State *L)
 {
     widget_t *w = luaH_checkwidget(L, 1);
-    lua_pushnumber(L, gtk_notebook_get_n_pages(GTK_NOTEBOOK(w->widget)));
+    lua_pushnumber(L, notebook_pages(w)->pages->len);
     return 1;
 }
 
@@ -157,7 +227,7 @@ luaH_notebook_reorder(lua_State *L)
     /* correct lua index */
     if (i != -1) i--;
     gtk_notebook_reorder_child(GTK_NOTEBOOK(w->widget), child->widget, i);
-    lua_pushnumber(L, gtk_notebook_page_num(GTK_NOTEBOOK(w->widget), child->widget));
+    lua_pushnumber(L, (gint)notebook_page_num(w, child) - 1);
     return 1;
 }
 
@@ -178,13 +248,14 @@ luaH_notebook_index(lua_State *L, widget_t *w, luakit_token_t token)
       PF_CASE(GET_TITLE,    luaH_notebook_get_title)
       PF_CASE(INDEXOF,      luaH_notebook_indexof)
       PF_CASE(INSERT,       luaH_notebook_insert)
+      PF_CASE(NTH,          luaH_notebook_nth)
       PF_CASE(REMOVE,       luaH_notebook_remove)
       PF_CASE(SET_TITLE,    luaH_notebook_set_title)
       PF_CASE(SWITCH,       luaH_notebook_switch)
       PF_CASE(REORDER,      luaH_notebook_reorder)
 
       case L_TK_CHILDREN:
-        return luaH_widget_get_children(L, w);
+        return luaH_notebook_get_children(L, w);
 
       /* push boolean properties */
       PB_CASE(SHOW_TABS,    gtk_notebook_get_show_tabs(GTK_NOTEBOOK(w->widget)))
@@ -222,6 +293,7 @@ page_added_cb(GtkNotebook* UNUSED(n), GtkWidget *widget, guint i, widget_t *w)
 {
     widget_t *child = GOBJECT_TO_LUAKIT_WIDGET(widget);
     lua_State *L = globalconf.L;
+    notebook_invalidate(w);
     luaH_object_push(L, w->ref);
     luaH_object_push(L, child->ref);
     lua_pushnumber(L, i + 1);
@@ -235,6 +307,7 @@ page_removed_cb(GtkNotebook* UNUSED(n), GtkWidget *widget, guint UNUSED(i),
 {
     widget_t *child = GOBJECT_TO_LUAKIT_WIDGET(widget);
     lua_State *L = globalconf.L;
+    notebook_invalidate(w);
     luaH_object_push(L, w->ref);
     luaH_object_push(L, child->ref);
     luaH_object_emit_signal(L, -2, "page-removed", 1, 0);
@@ -259,6 +332,7 @@ reorder_cb(GtkNotebook* UNUSED(n), GtkWidget *widget, guint i, widget_t *w)
 {
     widget_t *child = GOBJECT_TO_LUAKIT_WIDGET(widget);
     lua_State *L = globalconf.L;
+    notebook_invalidate(w);
     luaH_object_push(L, w->ref);
     luaH_object_push(L, child->ref);
     lua_pushnumber(L, i + 1);
@@ -266,11 +340,29 @@ reorder_cb(GtkNotebook* UNUSED(n), GtkWidget *widget, guint i, widget_t *w)
     lua_pop(L, 1);
 }
 
+static void
+notebook_destructor(widget_t *w)
+{
+    notebook_data_t *d = w->data;
+    g_ptr_array_free(d->pages, TRUE);
+    g_hash_table_destroy(d->index);
+    g_slice_free(notebook_data_t, d);
+    w->data = NULL;
+}
+
 widget_t *
 widget_notebook(widget_t *w, luakit_token_t UNUSED(token))
 {
     w->index = luaH_notebook_index;
     w->newindex = luaH_notebook_newindex;
+    w->destructor = notebook_destructor;
+
+    notebook_data_t *d = g_slice_new0(notebook_data_t);
+    d->pages = g_ptr_array_new();
+    d->index = g_hash_table_new(g_direct_hash, g_direct_equal);
+    /* Force a build of the page cache on first use */
+    d->version = 1;
+    w->data = d;
 
     /* create and setup notebook widget */
     w->widget = gtk_notebook_new();
@@ -28,9 +28,13 @@
 #include "luah.h"
 #include "clib/widget.h"
 #include "clib/request.h"
+#include "clib/luakit.h"
 #include "common/signal.h"
 #include "web_context.h"
 #include "common/ipc.h"
+#include "common/clib/ipc.h"
+#include "common/trace.h"
+#include "common/clib/gc.h"
 
 typedef struct {
     /** The parent widget_t struct */
@@ -173,6 +177,8 @@ webview_get_by_id(guint64 view_id)
 }
 
 static void update_uri(widget_t *w, const gchar *uri);
+static int luaH_webview_push_certificate_flags(lua_State *L, GTlsCertificateFlags errors);
+static gint luaH_webview_push_certificate(lua_State *L, widget_t *w);
 
 #include "widgets/webview/javascript.c"
 #include "widgets/webview/downloads.c"
@@ -182,6 +188,7 @@ static void update_uri(widget_t *w, const gchar *uri);
 #include "widgets/webview/find_controller.c"
 #include "widgets/webview/stylesheets.c"
 #include "widgets/webview/auth.c"
+#include "widgets/webview/load.c"
 
 static gint
 luaH_webview_load_string(lua_State *L)
@@ -401,10 +408,16 @@ load_changed_cb(WebKitWebView* UNUSED(v), WebKitLoadEvent e, widget_t *w)
     if (e == WEBKIT_LOAD_FINISHED && ((webview_data_t*) w->data)->is_failed)
         return;
 
+    /* Handlers share a single snapshot of the new load state */
     luaH_object_push(L, w->ref);
     lua_pushstring(L, name);
-    luaH_object_emit_signal(L, -2, "load-status", 1, 0);
+    luaH_webview_push_load(L, -2, d, name);
+    luaH_object_emit_signal(L, -3, "load-status", 2, 0);
     lua_pop(L, 1);
+
+    /* The first finished page load marks the end of startup */
+    if (e == WEBKIT_LOAD_FINISHED)
+        trace_finish();
 }
 
 
@@ -683,6 +696,69 @@ webview_translate_old_token(luakit_token_t token)
     }
 }
 
+/* Check whether the value at vidx equals a webview's current gobject
+ * property value. Properties that aren't gobject properties never match. */
+static gboolean
+webview_property_unchanged(lua_State *L, webview_data_t *d,
+        luakit_token_t token, gint vidx)
+{
+    gint n = luaH_gobject_index(L, webview_properties, token, G_OBJECT(d->view));
+    if (!n)
+        n = luaH_gobject_index(L, webview_settings_properties, token,
+                G_OBJECT(webkit_web_view_get_settings(d->view)));
+    if (!n)
+        return FALSE;
+    gboolean same = lua_rawequal(L, vidx, -1);
+    lua_pop(L, n);
+    return same;
+}
+
+/* Set several webview properties at once, skipping values equal to the
+ * current ones. Properties that aren't gobject properties fall back to the
+ * normal __newindex path. Returns the number of properties changed. */
+static gint
+luaH_webview_set_properties(lua_State *L)
+{
+    webview_data_t *d = luaH_checkwvdata(L, 1);
+    luaH_checktable(L, 2);
+
+    GObject *settings = G_OBJECT(webkit_web_view_get_settings(d->view));
+    gint changed = 0;
+
+    lua_pushnil(L);
+    while (lua_next(L, 2)) {
+        gint vidx = lua_gettop(L);
+        if (lua_type(L, -2) != LUA_TSTRING) {
+            lua_pop(L, 1);
+            continue;
+        }
+        luakit_token_t token = webview_translate_old_token(
+                l_tokenize(lua_tostring(L, -2)));
+
+        if (webview_property_unchanged(L, d, token, vidx)) {
+            lua_pop(L, 1);
+            continue;
+        }
+
+        if (luaH_gobject_newindex(L, webview_properties, token, vidx, G_OBJECT(d->view))
+                || luaH_gobject_newindex(L, webview_settings_properties, token, vidx, settings))
+            luaH_object_property_signal(L, 1, token);
+        else {
+            /* Not a gobject property; use the regular property setter */
+            lua_pushvalue(L, 1);
+            lua_pushvalue(L, -3);
+            lua_pushvalue(L, vidx);
+            lua_settable(L, -3);
+            lua_pop(L, 1);
+        }
+        changed++;
+        lua_pop(L, 1);
+    }
+
+    lua_pushinteger(L, changed);
+    return 1;
+}
+
 static int
 luaH_webview_push_favicon(lua_State *L, WebKitWebView *view)
 {
@@ -773,6 +849,7 @@ luaH_webview_index(lua_State *L, widget_t *w, luakit_token_t token)
       PF_CASE(SSL_TRUSTED,          luaH_webview_ssl_trusted)
       PF_CASE(STOP,                 luaH_webview_stop)
       PF_CASE(CRASH,                luaH_webview_crash)
+      PF_CASE(SET_PROPERTIES,       luaH_webview_set_properties)
       /* push inspector webview methods */
       PF_CASE(SHOW_INSPECTOR,       luaH_webview_show_inspector)
       PF_CASE(CLOSE_INSPECTOR,      luaH_webview_close_inspector)
@@ -970,6 +1047,7 @@ webview_button_cb(GtkWidget *view, GdkEventButton *ev, widget_t *w)
 {
     gint ret;
     lua_State *L = globalconf.L;
+    gc_scheduler_input();
     luaH_object_push(L, w->ref);
     luaH_modifier_table_push(L, ev->state);
     lua_pushinteger(L, ev->button);
@@ -1162,6 +1240,9 @@ webview_destructor(widget_t *w)
 
     g_idle_remove_by_data(w);
 
+    /* Drop calls made for this view that are still waiting for a reply */
+    ipc_channel_cancel_calls(webkit_web_view_get_page_id(WEBKIT_WEB_VIEW(w->widget)));
+
     g_assert(d->ipc);
     ipc_endpoint_decref(d->ipc);
     d->ipc = NULL;
@@ -1177,8 +1258,30 @@ webview_destructor(widget_t *w)
     g_slice_free(webview_data_t, d);
 }
 
+static void
+webview_finish_scheme_asset(WebKitURISchemeRequest *request, luakit_scheme_asset_t *asset)
+{
+    GInputStream *stream = g_memory_input_stream_new_from_bytes(asset->data);
+    gsize length = g_bytes_get_size(asset->data);
+#if WEBKIT_CHECK_VERSION(2,36,0)
+    WebKitURISchemeResponse *response = webkit_uri_scheme_response_new(stream, length);
+    webkit_uri_scheme_response_set_content_type(response, asset->mime);
+    SoupMessageHeaders *headers = soup_message_headers_new(SOUP_MESSAGE_HEADERS_RESPONSE);
+    soup_message_headers_append(headers, "Cache-Control", "max-age=86400");
+    webkit_uri_scheme_response_set_http_headers(response, headers);
+    webkit_uri_scheme_request_finish_with_response(request, response);
+    g_object_unref(response);
+#else
+    webkit_uri_scheme_request_finish(request, stream, length, asset->mime);
+#endif
+    g_object_unref(stream);
+}
+
+/* Requests are dispatched, in order of preference, to a static asset, the
+ * handler of the requested page, the default handler of the scheme, or the
+ * scheme-request signal of the webview. */
 void
-luakit_uri_scheme_request_cb(WebKitURISchemeRequest *request, const gchar *scheme)
+luakit_uri_scheme_request_cb(WebKitURISchemeRequest *request, luakit_scheme_t *scheme)
 {
     const gchar *uri = webkit_uri_scheme_request_get_uri(request);
 
@@ -1190,7 +1293,40 @@ luakit_uri_scheme_request_cb(WebKitURISchemeRequest *request, const gchar *schem
     lua_State *L = globalconf.L;
 
     g_assert(scheme);
-    gchar *sig = g_strconcat("scheme-request::", scheme, NULL);
+
+    /* Split "scheme://page/path" */
+    const gchar *page = uri + strlen(scheme->name) + 1;
+    while (*page == '/')
+        page++;
+    const gchar *slash = strchr(page, '/');
+    gsize page_len = slash ? (gsize)(slash - page) : strlen(page);
+    const gchar *path = slash ? slash + 1 : "";
+
+    /* Strip any query or fragment from asset lookups */
+    gchar *key = g_strndup(page, strcspn(page, "?#"));
+    luakit_scheme_asset_t *asset = g_hash_table_lookup(scheme->assets, key);
+    g_free(key);
+    if (asset) {
+        webview_finish_scheme_asset(request, asset);
+        return;
+    }
+
+    gchar *page_name = g_strndup(page, page_len);
+    gpointer ref = g_hash_table_lookup(scheme->pages, page_name) ?: scheme->default_ref;
+    if (ref) {
+        luaH_object_push(L, w->ref);
+        lua_pushstring(L, uri);
+        luaH_request_push_uri_scheme_request(L, request);
+        lua_pushstring(L, page_name);
+        lua_pushstring(L, path);
+        luaH_object_push(L, ref);
+        luaH_dofunction(L, 5, 0);
+        g_free(page_name);
+        return;
+    }
+    g_free(page_name);
+
+    gchar *sig = g_strconcat("scheme-request::", scheme->name, NULL);
     luaH_object_push(L, w->ref);
     lua_pushstring(L, uri);
     luaH_request_push_uri_scheme_request(L, request);
@@ -1259,6 +1395,13 @@ webview_set_web_process_id(widget_t *w, pid_t pid)
     d->web_process_id = pid;
 }
 
+pid_t
+webview_get_web_process_id(widget_t *w)
+{
+    webview_data_t *d = w->data;
+    return d->web_process_id;
+}
+
 widget_t *
 widget_webview(widget_t *w, luakit_token_t UNUSED(token))
 {
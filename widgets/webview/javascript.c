@@ -50,12 +50,17 @@ run_javascript_finished(const guint8 *msg, guint length)
     lua_settop(L, top);
 }
 
+/* Scripts at least this long are sent to each web process once, and are
+ * then referred to by content hash */
+#define SCRIPT_REGISTER_MIN_LEN 1024
+
 static gint
 luaH_webview_eval_js(lua_State *L)
 {
     gpointer cb = NULL;
     webview_data_t *d = luaH_checkwvdata(L, 1);
-    const gchar *script = luaL_checkstring(L, 2);
+    size_t len;
+    const gchar *script = luaL_checklstring(L, 2, &len);
     const gchar *usr_source = NULL;
     gchar *source = NULL;
     bool no_return = false;
@@ -80,13 +85,27 @@ luaH_webview_eval_js(lua_State *L)
     if (!usr_source)
         source = luaH_callerinfo(L);
 
+    gchar *hash = NULL;
+    if (len >= SCRIPT_REGISTER_MIN_LEN) {
+        hash = g_compute_checksum_for_data(G_CHECKSUM_SHA256, (const guchar *)script, len);
+        if (!ipc_send_script(d->ipc, hash, script, len)) {
+            g_free(hash);
+            hash = NULL;
+        }
+    }
+
     lua_pushboolean(L, no_return);
     lua_pushinteger(L, webkit_web_view_get_page_id(d->view));
-    lua_pushstring(L, script);
+    if (hash)
+        lua_pushstring(L, hash);
+    else
+        lua_pushlstring(L, script, len);
+    lua_pushboolean(L, hash != NULL);
     lua_pushstring(L, usr_source ? g_strdup(usr_source) : source);
     lua_pushlightuserdata(L, cb);
-    ipc_send_lua(d->ipc, IPC_TYPE_eval_js, L, -5, -1);
-    lua_pop(L, 5);
+    ipc_send_lua(d->ipc, IPC_TYPE_eval_js, L, -6, -1);
+    lua_pop(L, 6);
+    g_free(hash);
 
     return FALSE;
 }
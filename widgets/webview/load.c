@@ -0,0 +1,128 @@
+/*
+ * widgets/webview/load.c - webkit webview load status snapshots
+ *
+ * Copyright © 2017 Aidan Holm <aidanholm@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* A load snapshot is a table shared by all handlers of one load-status
+ * transition. The status, uri and title are filled in when the snapshot is
+ * created; all other fields are computed by the metatable the first time
+ * they are read, and are then stored in the table. */
+#define LOAD_META_REG_KEY "luakit.registry.webview_load_meta"
+
+static gint
+luaH_webview_load_index(lua_State *L)
+{
+    const gchar *prop = luaL_checkstring(L, 2);
+    luakit_token_t token = l_tokenize(prop);
+
+    lua_pushliteral(L, "view");
+    lua_rawget(L, 1);
+    webview_data_t *d = luaH_checkwvdata(L, -1);
+    lua_pop(L, 1);
+
+    GTlsCertificate *cert;
+    GTlsCertificateFlags cert_errors;
+    gboolean has_tls;
+
+    switch (token) {
+      case L_TK_HISTORY:
+        luaH_webview_push_history(L, d->view);
+        break;
+      case L_TK_HISTORY_INDEX: {
+        WebKitBackForwardList *bflist = webkit_web_view_get_back_forward_list(d->view);
+        GList *back = webkit_back_forward_list_get_back_list(bflist);
+        lua_pushnumber(L, g_list_length(back) + 1);
+        g_list_free(back);
+        break;
+      }
+      case L_TK_CAN_GO_BACK:
+        lua_pushboolean(L, webkit_web_view_can_go_back(d->view));
+        break;
+      case L_TK_CAN_GO_FORWARD:
+        lua_pushboolean(L, webkit_web_view_can_go_forward(d->view));
+        break;
+      case L_TK_CERTIFICATE:
+        if (!luaH_webview_push_certificate(L, d->widget))
+            return 0;
+        break;
+      case L_TK_SSL_TRUSTED:
+      case L_TK_TLS_ERRORS:
+        /* nil if not viewing a https uri */
+        has_tls = d->is_committed && webkit_web_view_get_tls_info(d->view,
+                &cert, &cert_errors);
+        if (!has_tls)
+            return 0;
+        if (token == L_TK_SSL_TRUSTED)
+            lua_pushboolean(L, cert_errors == 0);
+        else
+            luaH_webview_push_certificate_flags(L, cert_errors);
+        break;
+      default:
+        return 0;
+    }
+
+    /* Cache the value for other handlers of this transition */
+    lua_pushvalue(L, 2);
+    lua_pushvalue(L, -2);
+    lua_rawset(L, 1);
+    return 1;
+}
+
+/* Push the metatable of load snapshots, creating it if necessary */
+static void
+luaH_webview_load_meta_push(lua_State *L)
+{
+    lua_pushliteral(L, LOAD_META_REG_KEY);
+    lua_rawget(L, LUA_REGISTRYINDEX);
+    if (!lua_isnil(L, -1))
+        return;
+    lua_pop(L, 1);
+    lua_createtable(L, 0, 1);
+    lua_pushliteral(L, "__index");
+    lua_pushcfunction(L, luaH_webview_load_index);
+    lua_rawset(L, -3);
+    lua_pushliteral(L, LOAD_META_REG_KEY);
+    lua_pushvalue(L, -2);
+    lua_rawset(L, LUA_REGISTRYINDEX);
+}
+
+/* Push a new load snapshot for the webview at index vidx */
+static void
+luaH_webview_push_load(lua_State *L, gint vidx, webview_data_t *d, const gchar *status)
+{
+    vidx = luaH_absindex(L, vidx);
+    lua_createtable(L, 0, 4);
+
+    lua_pushliteral(L, "view");
+    lua_pushvalue(L, vidx);
+    lua_rawset(L, -3);
+    lua_pushliteral(L, "status");
+    lua_pushstring(L, status);
+    lua_rawset(L, -3);
+    lua_pushliteral(L, "uri");
+    lua_pushstring(L, d->uri);
+    lua_rawset(L, -3);
+    lua_pushliteral(L, "title");
+    lua_pushstring(L, webkit_web_view_get_title(d->view));
+    lua_rawset(L, -3);
+
+    luaH_webview_load_meta_push(L);
+    lua_setmetatable(L, -2);
+}
+
+// vim: ft=c:et:sw=4:ts=8:sts=4:tw=80